@@ -22,83 +22,41 @@
 #include "esp32-hal-ledc.h"
 #include "sdkconfig.h"
 #include "camera_index.h"
-#define EI_CAMERA_RAW_FRAME_BUFFER_COLS           320
-#define EI_CAMERA_RAW_FRAME_BUFFER_ROWS           240
-#define EI_CAMERA_FRAME_BYTE_SIZE                 3
+#include "app_httpd.h"
+#include "capture_mode.h"
+#include "frame_stats.h"
+#include "stream_broadcast.h"
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
 #endif
 
-// Enable LED FLASH setting
+// Enable LED FLASH setting (override with a build flag, the sketch's defines do not reach the library)
+#ifndef CONFIG_LED_ILLUMINATOR_ENABLED
 #define CONFIG_LED_ILLUMINATOR_ENABLED 1
+#endif
+
+// Longest a snapshot waits for the first broadcast frame after a stream client joined
+#define SNAPSHOT_WAIT_MS 500
 
 // LED FLASH setup
 #if CONFIG_LED_ILLUMINATOR_ENABLED
 
+#ifndef LED_LEDC_GPIO
 #define LED_LEDC_GPIO            4  //configure LED pin
+#endif
 #define CONFIG_LED_MAX_INTENSITY 255
 
 int led_duty = 0;
 bool isStreaming = false;
 
 #endif
-// 1 minute in milliseconds
 
-uint8_t *snapshot_buf1; //points to the output of the capture
-extern SemaphoreHandle_t fb_mutex;
-extern QueueHandle_t frame_queue;
 typedef struct {
   httpd_req_t *req;
   size_t len;
 } jpg_chunking_t;
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
-
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t camera_httpd = NULL;
-unsigned long last_run = 0;
-const unsigned long interval = 3000; // 3 seconds
-typedef struct {
-  size_t size;   //number of values used for filtering
-  size_t index;  //current value index
-  size_t count;  //value count
-  int sum;
-  int *values;  //array to be filled with values
-} ra_filter_t;
-
-static ra_filter_t ra_filter;
-extern void publish_client(char msg[]);
-static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size) {
-  memset(filter, 0, sizeof(ra_filter_t));
-
-  filter->values = (int *)malloc(sample_size * sizeof(int));
-  if (!filter->values) {
-    return NULL;
-  }
-  memset(filter->values, 0, sample_size * sizeof(int));
-
-  filter->size = sample_size;
-  return filter;
-}
-
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-static int ra_filter_run(ra_filter_t *filter, int value) {
-  if (!filter->values) {
-    return value;
-  }
-  filter->sum -= filter->values[filter->index];
-  filter->values[filter->index] = value;
-  filter->sum += filter->values[filter->index];
-  filter->index++;
-  filter->index = filter->index % filter->size;
-  if (filter->count < filter->size) {
-    filter->count++;
-  }
-  return filter->sum / filter->count;
-}
-#endif
 
 #if CONFIG_LED_ILLUMINATOR_ENABLED
 void enable_led(bool en) {  // Turn LED On or Off
@@ -119,7 +77,17 @@ static esp_err_t bmp_handler(httpd_req_t *req) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   uint64_t fr_start = esp_timer_get_time();
 #endif
-  fb = esp_camera_fb_get();
+  // While streaming, the broadcaster's newest frame (see capture_handler)
+  shared_fb_t *shared = stream_broadcast_latest(SNAPSHOT_WAIT_MS);
+  if (shared) {
+    fb = shared->fb;
+  } else if (stream_broadcast_subscriber_count() > 0) {
+    log_e("No stream frame for the snapshot");
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  } else {
+    fb = esp_camera_fb_get();
+  }
   if (!fb) {
     log_e("Camera capture failed");
     httpd_resp_send_500(req);
@@ -137,7 +105,11 @@ static esp_err_t bmp_handler(httpd_req_t *req) {
   uint8_t *buf = NULL; 
   size_t buf_len = 0;
   bool converted = frame2bmp(fb, &buf, &buf_len);
-  esp_camera_fb_return(fb);
+  if (shared) {
+    shared_fb_release(shared);
+  } else {
+    esp_camera_fb_return(fb);
+  }
   if (!converted) {
     log_e("BMP Conversion failed");
     httpd_resp_send_500(req);
@@ -171,15 +143,45 @@ static esp_err_t capture_handler(httpd_req_t *req) {
   int64_t fr_start = esp_timer_get_time();
 #endif
 
+  // While /stream clients are attached the broadcaster owns the camera:
+  // answer with its newest pooled frame (already at stream resolution, LED
+  // lit for streaming) instead of competing for the 2 driver fbs
+  shared_fb_t *shared = stream_broadcast_latest(SNAPSHOT_WAIT_MS);
+  if (shared) {
+    fb = shared->fb;
+  } else if (stream_broadcast_subscriber_count() > 0) {
+    log_e("No stream frame for the snapshot");
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  } else {
+    // Idle: snapshot at stream resolution; skip frames captured before the switch
+    if (capture_client_begin()) {
+      framesize_t size = capture_stream_framesize();
+      for (int i = 0; i < 3; i++) {
+        fb = esp_camera_fb_get();
+        bool stale = fb && fb->width != resolution[size].width;
+        if (fb) {
+          esp_camera_fb_return(fb);
+          fb = NULL;
+        }
+        if (!stale) {
+          break;
+        }
+      }
+    }
+
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  enable_led(true);
-  vTaskDelay(150 / portTICK_PERIOD_MS);  // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
-  fb = esp_camera_fb_get();              // or it won't be visible in the frame. A better way to do this is needed.
-  enable_led(false);
+    enable_led(true);
+    vTaskDelay(150 / portTICK_PERIOD_MS);  // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
+    fb = esp_camera_fb_get();              // or it won't be visible in the frame. A better way to do this is needed.
+    enable_led(false);
 #else
-  fb = esp_camera_fb_get();
+    fb = esp_camera_fb_get();
 #endif
 
+    capture_client_end();
+  }
+
   if (!fb) {
     log_e("Camera capture failed");
     httpd_resp_send_500(req);
@@ -210,7 +212,11 @@ static esp_err_t capture_handler(httpd_req_t *req) {
     fb_len = jchunk.len;
 #endif
   }
-  esp_camera_fb_return(fb);
+  if (shared) {
+    shared_fb_release(shared);
+  } else {
+    esp_camera_fb_return(fb);
+  }
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   int64_t fr_end = esp_timer_get_time();
 #endif
@@ -218,126 +224,23 @@ static esp_err_t capture_handler(httpd_req_t *req) {
   return res;
 }
 
-static esp_err_t stream_handler(httpd_req_t *req) {
-  camera_fb_t *fb = NULL;
-  struct timeval _timestamp;
-  esp_err_t res = ESP_OK;
-  size_t _jpg_buf_len = 0;
-  uint8_t *_jpg_buf = NULL;
-  char *part_buf[128];
-
-  static int64_t last_frame = 0;
-  if (!last_frame) {
-    last_frame = esp_timer_get_time();
-  }
-
-  res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-  if (res != ESP_OK) {
-    return res;
-  }
-snapshot_buf1 = (uint8_t*)malloc(EI_CAMERA_RAW_FRAME_BUFFER_COLS * EI_CAMERA_RAW_FRAME_BUFFER_ROWS * EI_CAMERA_FRAME_BYTE_SIZE);
-
-    // check if allocation was successful
-    if(snapshot_buf1 == nullptr) {
-        log_e("ERR: Failed to allocate snapshot buffer!\n");
-       //espres = ESP_FAIL;
-    }
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_set_hdr(req, "X-Framerate", "60");
-
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = true;
-  enable_led(true);
-#endif
-
-  while (true) {
-    
-   
-    fb = esp_camera_fb_get();
-    if (!fb) {
-      log_e("Camera capture failed");
-      res = ESP_FAIL;
-    } else {
-      _timestamp.tv_sec = fb->timestamp.tv_sec;
-      _timestamp.tv_usec = fb->timestamp.tv_usec;
-    
-      if (fb->format != PIXFORMAT_JPEG) {
-        
-       // Serial.println("Resizing the frame buffer...");
-       
-        bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-      
-         if (!jpeg_converted) {
-          log_e("JPEG compression failed");
-          res = ESP_FAIL;
-        }
-      } else {
-        _jpg_buf_len = fb->len;
-        _jpg_buf = fb->buf;
-      
-      }
-      // xSemaphoreTake(fb_mutex, portMAX_DELAY);
-           
-           
-      bool converted = fmt2rgb888(fb->buf, fb->len, PIXFORMAT_JPEG, snapshot_buf1);
-      //  xSemaphoreGive(fb_mutex);
-      if (xQueueSend(frame_queue, &snapshot_buf1, 0) != pdTRUE) {
-                // Queue full, drop frame to avoid blocking
-             //   esp_camera_fb_return(fb);
-          //   Serial.println("Queue Full");
-            }
-            
-//if ((millis() - last_run) >= interval){
-
-    //last_run = millis();
-    
- // esp_camera_fb_return(fb);
-   
-       
-    }
-    if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
-    }
-    if (res == ESP_OK) {
-      size_t hlen = snprintf((char *)part_buf, 128, _STREAM_PART, _jpg_buf_len, _timestamp.tv_sec, _timestamp.tv_usec);
-      res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
-    }
-    if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
-    }
-    if (fb) {
-      esp_camera_fb_return(fb);
-      fb = NULL;
-      _jpg_buf = NULL;
-    } else if (_jpg_buf) {
-      free(_jpg_buf);
-      _jpg_buf = NULL;
-    }
-    if (res != ESP_OK) {
-      log_e("Send frame failed");
-      break;
-    }
-    int64_t fr_end = esp_timer_get_time();
-
-    int64_t frame_time = fr_end - last_frame;
-    last_frame = fr_end;
-
-    frame_time /= 1000;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    uint32_t avg_frame_time = ra_filter_run(&ra_filter, frame_time);
-#endif
-    log_i(
-      "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps)", (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time,
-      1000.0 / avg_frame_time
-    );
-  }free(snapshot_buf1);
-
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = false;
-  enable_led(false);
+static void stream_led(bool streaming) {
+  isStreaming = streaming;
+  enable_led(streaming);
+}
 #endif
 
-  return res;
+// Every /stream client shares one capture; the broadcaster answers the
+// request from its own sender task after this handler returns
+static esp_err_t stream_handler(httpd_req_t *req) {
+  if (stream_broadcast_subscribe(req) != ESP_OK) {
+    log_e("Stream rejected, %d clients already streaming", STREAM_MAX_SUBSCRIBERS);
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_sendstr(req, "Too many stream clients");
+  }
+  return ESP_OK;
 }
 
 static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
@@ -383,7 +286,7 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
 
   if (!strcmp(variable, "framesize")) {
     if (s->pixformat == PIXFORMAT_JPEG) {
-      res = s->set_framesize(s, (framesize_t)val);
+      res = capture_set_stream_framesize((framesize_t)val);
     }
   } else if (!strcmp(variable, "quality")) {
     res = s->set_quality(s, val);
@@ -495,7 +398,7 @@ static esp_err_t status_handler(httpd_req_t *req) {
 
   p += sprintf(p, "\"xclk\":%u,", s->xclk_freq_hz / 1000000);
   p += sprintf(p, "\"pixformat\":%u,", s->pixformat);
-  p += sprintf(p, "\"framesize\":%u,", s->status.framesize);
+  p += sprintf(p, "\"framesize\":%u,", capture_stream_framesize());
   p += sprintf(p, "\"quality\":%u,", s->status.quality);
   p += sprintf(p, "\"brightness\":%d,", s->status.brightness);
   p += sprintf(p, "\"contrast\":%d,", s->status.contrast);
@@ -531,6 +434,17 @@ static esp_err_t status_handler(httpd_req_t *req) {
   return httpd_resp_send(req, json_response, strlen(json_response));
 }
 
+static esp_err_t stats_handler(httpd_req_t *req) {
+  static char json_response[1024];
+
+  if (frame_stats_json(json_response, sizeof(json_response)) < 0) {
+    return httpd_resp_send_500(req);
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, json_response, strlen(json_response));
+}
+
 static esp_err_t xclk_handler(httpd_req_t *req) {
   char *buf = NULL;
   char _xclk[32];
@@ -708,12 +622,7 @@ static esp_err_t index_handler(httpd_req_t *req) {
     return httpd_resp_send_500(req);
   }
 }
-const char *ssid1 = "natarajanv";
-const char *password1 = "prasanna@05";
-
 void startCameraServer() {
-
-
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.max_uri_handlers = 16;
 
@@ -743,6 +652,19 @@ void startCameraServer() {
 #endif
   };
 
+  httpd_uri_t stats_uri = {
+    .uri = "/stats",
+    .method = HTTP_GET,
+    .handler = stats_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
   httpd_uri_t cmd_uri = {
     .uri = "/control",
     .method = HTTP_GET,
@@ -860,13 +782,12 @@ void startCameraServer() {
 #endif
   };
 
-  ra_filter_init(&ra_filter, 20);
-
   log_i("Starting web server on port: '%d'", config.server_port);
   if (httpd_start(&camera_httpd, &config) == ESP_OK) {
     httpd_register_uri_handler(camera_httpd, &index_uri);
     httpd_register_uri_handler(camera_httpd, &cmd_uri);
     httpd_register_uri_handler(camera_httpd, &status_uri);
+    httpd_register_uri_handler(camera_httpd, &stats_uri);
     httpd_register_uri_handler(camera_httpd, &capture_uri);
     httpd_register_uri_handler(camera_httpd, &bmp_uri);
 
@@ -877,6 +798,12 @@ void startCameraServer() {
     httpd_register_uri_handler(camera_httpd, &win_uri);
   }
 
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+  stream_broadcast_init(stream_led);
+#else
+  stream_broadcast_init(NULL);
+#endif
+
   config.server_port += 1;
   config.ctrl_port += 1;
   log_i("Starting stream server on port: '%d'", config.server_port);
@@ -0,0 +1,20 @@
+/*
+ * Camera HTTP server
+ *
+ * Port 80: web UI (/), /status, /control, /capture, /bmp, /stats and the
+ * sensor register endpoints. Port 81: /stream (MJPEG, up to
+ * STREAM_MAX_SUBSCRIBERS clients fed from one capture, see stream_broadcast.h).
+ */
+
+#ifndef APP_HTTPD_H
+#define APP_HTTPD_H
+
+#include <Arduino.h>
+
+// Call after camera_node_begin() and once every frame consumer is subscribed
+void startCameraServer();
+
+// Attach the flash LED (LED_GPIO_NUM from camera_pins.h)
+void setupLedFlash(int pin);
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * Camera node core implementation
+ */
+
+#include "camera_node.h"
+
+void camera_node_begin(framesize_t inference_size, framesize_t stream_size) {
+  frame_stats_init();
+  frame_broker_init();
+  capture_mode_init(inference_size, stream_size);
+}
@@ -0,0 +1,32 @@
+/*
+ * Camera node core
+ *
+ * Everything the camera sketches share: the HTTP server, dual-resolution
+ * capture, the multi-client stream broadcaster, the frame broker, scaled
+ * classifier decode and stream timing stats. A sketch selects its CAMERA_MODEL_*, includes this and
+ * camera_pins.h, initialises the camera, then:
+ *
+ *   camera_node_begin(inference_size, stream_size);
+ *   feed = frame_broker_subscribe("classifier", 1000, true);
+ *   startCameraServer();
+ *
+ * and pulls frames with frame_broker_receive(feed) from its own tasks.
+ */
+
+#ifndef CAMERA_NODE_H
+#define CAMERA_NODE_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "shared_fb.h"
+#include "capture_mode.h"
+#include "frame_broker.h"
+#include "frame_decode.h"
+#include "frame_stats.h"
+#include "stream_broadcast.h"
+#include "app_httpd.h"
+
+// Capture at inference_size until a stream client attaches (camera must be initialised)
+void camera_node_begin(framesize_t inference_size, framesize_t stream_size);
+
+#endif
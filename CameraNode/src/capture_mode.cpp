@@ -0,0 +1,87 @@
+/*
+ * Dual-resolution capture implementation
+ */
+
+#include "capture_mode.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static SemaphoreHandle_t mode_lock = NULL;
+static framesize_t inference_framesize = FRAMESIZE_QVGA;
+static framesize_t stream_framesize = FRAMESIZE_VGA;
+static int active_clients = 0;
+static bool stream_resolution = false;  // Sensor currently at stream_framesize
+static unsigned long last_client_time = 0;
+
+static int apply_framesize(framesize_t size) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s || s->pixformat != PIXFORMAT_JPEG) {
+    return 0;
+  }
+  return s->set_framesize(s, size);
+}
+
+void capture_mode_init(framesize_t inference_size, framesize_t stream_size) {
+  mode_lock = xSemaphoreCreateMutex();
+  inference_framesize = inference_size;
+  stream_framesize = stream_size;
+  stream_resolution = false;
+  apply_framesize(inference_framesize);
+  log_i("Capture: inference %ux%u, stream %ux%u", resolution[inference_size].width, resolution[inference_size].height,
+        resolution[stream_size].width, resolution[stream_size].height);
+}
+
+bool capture_client_begin() {
+  xSemaphoreTake(mode_lock, portMAX_DELAY);
+  active_clients++;
+  last_client_time = millis();
+  bool switched = !stream_resolution;
+  if (switched) {
+    apply_framesize(stream_framesize);
+    stream_resolution = true;
+  }
+  xSemaphoreGive(mode_lock);
+  return switched;
+}
+
+void capture_client_end() {
+  xSemaphoreTake(mode_lock, portMAX_DELAY);
+  if (active_clients > 0) {
+    active_clients--;
+  }
+  last_client_time = millis();
+  xSemaphoreGive(mode_lock);
+}
+
+bool capture_idle() {
+  xSemaphoreTake(mode_lock, portMAX_DELAY);
+  bool idle = active_clients == 0;
+  if (idle && stream_resolution && millis() - last_client_time >= CAPTURE_IDLE_LINGER_MS) {
+    apply_framesize(inference_framesize);
+    stream_resolution = false;
+  }
+  xSemaphoreGive(mode_lock);
+  return idle;
+}
+
+int capture_set_stream_framesize(framesize_t size) {
+  xSemaphoreTake(mode_lock, portMAX_DELAY);
+  stream_framesize = size;
+  int res = stream_resolution ? apply_framesize(size) : 0;
+  xSemaphoreGive(mode_lock);
+  return res;
+}
+
+framesize_t capture_stream_framesize() {
+  return stream_framesize;
+}
+
+framesize_t capture_framesize_covering(int width, int height) {
+  static const framesize_t sizes[] = { FRAMESIZE_QQVGA, FRAMESIZE_QVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    if (resolution[sizes[i]].width >= width && resolution[sizes[i]].height >= height) {
+      return sizes[i];
+    }
+  }
+  return FRAMESIZE_SVGA;
+}
@@ -0,0 +1,38 @@
+/*
+ * Dual-resolution capture
+ *
+ * The sensor runs at the stream resolution only while an HTTP client is
+ * taking frames (/stream or /capture). Once clients have been gone for
+ * CAPTURE_IDLE_LINGER_MS it drops to the classifier's inference size, so
+ * idle inference decodes a small JPEG instead of a full-size one.
+ */
+
+#ifndef CAPTURE_MODE_H
+#define CAPTURE_MODE_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#define CAPTURE_IDLE_LINGER_MS 5000   // Keep stream resolution this long after the last client
+
+// Set both sizes and start at the inference size
+void capture_mode_init(framesize_t inference_size, framesize_t stream_size);
+
+// HTTP client starts/stops taking frames. begin returns true if the sensor
+// was just switched up to the stream size (frames already queued are still small).
+bool capture_client_begin();
+void capture_client_end();
+
+// True when no client is attached (the classifier must capture its own
+// frames); switches back to the inference size after the linger time
+bool capture_idle();
+
+// Stream resolution chosen in the web UI (applied immediately only while streaming)
+int capture_set_stream_framesize(framesize_t size);
+framesize_t capture_stream_framesize();
+
+// Smallest full field-of-view (4:3) frame size covering width x height,
+// e.g. the model input, for use as the inference size
+framesize_t capture_framesize_covering(int width, int height);
+
+#endif
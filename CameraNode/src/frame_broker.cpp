@@ -0,0 +1,108 @@
+/*
+ * Frame broker implementation
+ */
+
+#include "frame_broker.h"
+#include "capture_mode.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+struct frame_consumer {
+  const char *name;
+  QueueHandle_t queue;     // One shared_fb_t* at a time
+  int64_t interval_us;
+  int64_t last_offer;      // Time the consumer was last handed a frame (us)
+  bool capture_when_idle;
+  uint32_t delivered;
+  uint32_t dropped;        // Samples missed while busy with the previous frame
+};
+
+static frame_consumer_t consumers[FRAME_BROKER_MAX_CONSUMERS];
+static int consumer_count = 0;
+
+void frame_broker_init() {
+  consumer_count = 0;
+}
+
+frame_consumer_t *frame_broker_subscribe(const char *name, uint32_t interval_ms, bool capture_when_idle) {
+  if (consumer_count >= FRAME_BROKER_MAX_CONSUMERS) {
+    log_e("Frame broker full, consumer %s not registered", name);
+    return NULL;
+  }
+  frame_consumer_t *consumer = &consumers[consumer_count];
+  consumer->name = name;
+  consumer->queue = xQueueCreate(1, sizeof(shared_fb_t *));
+  consumer->interval_us = interval_ms * 1000LL;
+  consumer->last_offer = 0;
+  consumer->capture_when_idle = capture_when_idle;
+  consumer->delivered = 0;
+  consumer->dropped = 0;
+  __atomic_store_n(&consumer_count, consumer_count + 1, __ATOMIC_RELEASE);
+  log_i("Frame broker: %s every %ums", name, interval_ms);
+  return consumer;
+}
+
+shared_fb_t *frame_broker_receive(frame_consumer_t *consumer) {
+  shared_fb_t *sample = NULL;
+  if (xQueueReceive(consumer->queue, &sample, consumer->interval_us / 1000 / portTICK_PERIOD_MS) == pdTRUE) {
+    return sample;
+  }
+
+  // Nothing is streaming: capture at the inference resolution ourselves
+  if (!consumer->capture_when_idle || !capture_idle()) {
+    return NULL;
+  }
+  camera_fb_t *fb = esp_camera_fb_get();
+  if (!fb) {
+    return NULL;
+  }
+  sample = shared_fb_create(fb);
+  if (!sample) {
+    esp_camera_fb_return(fb);
+    return NULL;
+  }
+  consumer->delivered++;
+  return sample;
+}
+
+void frame_broker_offer(shared_fb_t *shared) {
+  int64_t now = esp_timer_get_time();
+  int count = __atomic_load_n(&consumer_count, __ATOMIC_ACQUIRE);
+  for (int i = 0; i < count; i++) {
+    frame_consumer_t *consumer = &consumers[i];
+    if (now - consumer->last_offer < consumer->interval_us) {
+      continue;
+    }
+    // Still busy with the previous frame: this sample is lost
+    if (uxQueueSpacesAvailable(consumer->queue) == 0) {
+      consumer->last_offer = now;
+      consumer->dropped++;
+      continue;
+    }
+    shared_fb_retain(shared);
+    if (xQueueSend(consumer->queue, &shared, 0) == pdTRUE) {
+      consumer->last_offer = now;
+      consumer->delivered++;
+    } else {
+      shared_fb_release(shared);
+      consumer->dropped++;
+    }
+  }
+}
+
+int frame_broker_consumer_count() {
+  return __atomic_load_n(&consumer_count, __ATOMIC_ACQUIRE);
+}
+
+const char *frame_broker_consumer_name(int index) {
+  return consumers[index].name;
+}
+
+uint32_t frame_broker_delivered(int index) {
+  return consumers[index].delivered;
+}
+
+uint32_t frame_broker_dropped(int index) {
+  return consumers[index].dropped;
+}
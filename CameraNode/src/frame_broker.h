@@ -0,0 +1,44 @@
+/*
+ * Frame broker
+ *
+ * Hands camera frames to any number of consumers (classifier, recorder,
+ * ...) at each consumer's own sampling rate. The stream broadcaster
+ * offers every frame it sends; a consumer whose interval has elapsed and
+ * whose one-slot queue is empty gets a reference to the same shared_fb_t,
+ * so no frame is decoded or copied again on the stream path. While no HTTP client is streaming,
+ * a consumer that asked for it captures its own frames at the inference
+ * resolution instead.
+ */
+
+#ifndef FRAME_BROKER_H
+#define FRAME_BROKER_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "shared_fb.h"
+
+#define FRAME_BROKER_MAX_CONSUMERS 4
+
+typedef struct frame_consumer frame_consumer_t;
+
+void frame_broker_init();
+
+// Register a consumer taking at most one frame per interval_ms. Call from
+// setup() before startCameraServer(); returns NULL when the table is full.
+frame_consumer_t *frame_broker_subscribe(const char *name, uint32_t interval_ms, bool capture_when_idle);
+
+// Wait up to one interval for a frame (NULL on timeout). The caller owns
+// one reference and must shared_fb_release() it.
+shared_fb_t *frame_broker_receive(frame_consumer_t *consumer);
+
+// Producer side: hand every due consumer its own reference to shared.
+// The caller keeps (and later releases) its reference.
+void frame_broker_offer(shared_fb_t *shared);
+
+// Per-consumer counters for /stats
+int frame_broker_consumer_count();
+const char *frame_broker_consumer_name(int index);
+uint32_t frame_broker_delivered(int index);
+uint32_t frame_broker_dropped(int index);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Scaled RGB888 decode implementation
+ */
+
+#include "frame_decode.h"
+#include "img_converters.h"
+#include "esp_jpg_decode.h"
+
+typedef struct {
+  const uint8_t *input;
+  decoded_frame_t *frame;
+} scaled_decode_t;
+
+static size_t scaled_jpg_read(void *arg, size_t index, uint8_t *buf, size_t len) {
+  scaled_decode_t *job = (scaled_decode_t *)arg;
+  if (buf) {
+    memcpy(buf, job->input + index, len);
+  }
+  return len;
+}
+
+// Same BGR byte order as fmt2rgb888, which the classifiers' get_data expects
+static bool scaled_jpg_write(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+  decoded_frame_t *frame = ((scaled_decode_t *)arg)->frame;
+  if (!data) {
+    if (x == 0 && y == 0) {
+      frame->cols = w;
+      frame->rows = h;
+    }
+    return true;
+  }
+
+  size_t stride = frame->cols * 3;
+  for (uint16_t row = 0; row < h; row++) {
+    uint8_t *o = frame->pixels + (y + row) * stride + x * 3;
+    for (uint16_t col = 0; col < w; col++) {
+      o[0] = data[2];
+      o[1] = data[1];
+      o[2] = data[0];
+      o += 3;
+      data += 3;
+    }
+  }
+  return true;
+}
+
+bool frame_decode_rgb888(camera_fb_t *fb, int min_width, int min_height, decoded_frame_t *frame) {
+  const size_t capacity = frame->capacity;
+  if (fb->format != PIXFORMAT_JPEG) {
+    if (fb->width * fb->height > capacity) {
+      return false;
+    }
+    frame->cols = fb->width;
+    frame->rows = fb->height;
+    return fmt2rgb888(fb->buf, fb->len, fb->format, frame->pixels);
+  }
+
+  int scale = JPG_SCALE_NONE;
+  while (scale < JPG_SCALE_8X
+         && (int)(fb->width >> (scale + 1)) >= min_width
+         && (int)(fb->height >> (scale + 1)) >= min_height) {
+    scale++;
+  }
+  while (scale < JPG_SCALE_8X && (fb->width >> scale) * (fb->height >> scale) > capacity) {
+    scale++;
+  }
+  if ((fb->width >> scale) * (fb->height >> scale) > capacity) {
+    return false;
+  }
+
+  scaled_decode_t job = { fb->buf, frame };
+  return esp_jpg_decode(fb->len, (jpg_scale_t)scale, scaled_jpg_read, scaled_jpg_write, &job) == ESP_OK;
+}
@@ -0,0 +1,26 @@
+/*
+ * Scaled RGB888 decode for classifier input
+ *
+ * Decodes a camera fb into a caller-owned RGB888 buffer, using the JPEG
+ * decoder's 1/2-1/8 scaling so a high-resolution stream frame lands at
+ * (or just above) model size instead of being decoded in full.
+ */
+
+#ifndef FRAME_DECODE_H
+#define FRAME_DECODE_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+typedef struct {
+  uint8_t *pixels;  // RGB888 (BGR byte order, as fmt2rgb888)
+  int capacity;     // Pixels the buffer holds
+  int cols;         // Decoded size
+  int rows;
+} decoded_frame_t;
+
+// Decode fb at the largest scale-down that stays at least min_width x
+// min_height and fits frame->capacity. False if it cannot fit or fails.
+bool frame_decode_rgb888(camera_fb_t *fb, int min_width, int min_height, decoded_frame_t *frame);
+
+#endif
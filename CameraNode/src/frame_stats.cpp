@@ -0,0 +1,88 @@
+/*
+ * Stream timing stats implementation
+ */
+
+#include "frame_stats.h"
+#include "frame_broker.h"
+#include "jpeg_pool.h"
+#include "stream_broadcast.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+  uint32_t values[FRAME_STATS_WINDOW];
+  uint32_t index;
+  uint32_t count;
+  uint32_t sum;
+  uint32_t peak;
+  uint32_t total;   // Samples recorded since boot
+} stage_stats_t;
+
+static const char *stage_names[FRAME_STAGE_COUNT] = { "capture", "copy", "send", "frame" };
+static stage_stats_t stages[FRAME_STAGE_COUNT];
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void frame_stats_init() {
+  memset(stages, 0, sizeof(stages));
+}
+
+void frame_stats_record(frame_stage_t stage, uint32_t us) {
+  stage_stats_t *s = &stages[stage];
+  portENTER_CRITICAL(&stats_mux);
+  s->sum -= s->values[s->index];
+  s->values[s->index] = us;
+  s->sum += us;
+  s->index = (s->index + 1) % FRAME_STATS_WINDOW;
+  if (s->count < FRAME_STATS_WINDOW) {
+    s->count++;
+  }
+  if (us > s->peak) {
+    s->peak = us;
+  }
+  s->total++;
+  portEXIT_CRITICAL(&stats_mux);
+}
+
+uint32_t frame_stats_average(frame_stage_t stage) {
+  portENTER_CRITICAL(&stats_mux);
+  const stage_stats_t *s = &stages[stage];
+  uint32_t avg = s->count ? s->sum / s->count : 0;
+  portEXIT_CRITICAL(&stats_mux);
+  return avg;
+}
+
+int frame_stats_json(char *buf, size_t len) {
+  stage_stats_t snapshot[FRAME_STAGE_COUNT];
+  portENTER_CRITICAL(&stats_mux);
+  memcpy(snapshot, stages, sizeof(snapshot));
+  portEXIT_CRITICAL(&stats_mux);
+
+  uint32_t frame_avg = snapshot[FRAME_STAGE_FRAME].count ? snapshot[FRAME_STAGE_FRAME].sum / snapshot[FRAME_STAGE_FRAME].count : 0;
+  int n = snprintf(buf, len, "{\"frames\":%u,\"fps\":%.1f", snapshot[FRAME_STAGE_FRAME].total, frame_avg ? 1000000.0 / frame_avg : 0.0);
+  for (int i = 0; i < FRAME_STAGE_COUNT && n < (int)len; i++) {
+    const stage_stats_t *s = &snapshot[i];
+    n += snprintf(buf + n, len - n, ",\"%s\":{\"avg_us\":%u,\"max_us\":%u}", stage_names[i], s->count ? s->sum / s->count : 0, s->peak);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, ",\"pool_in_use\":%d,\"pool_misses\":%u,\"subscribers\":[", jpeg_pool_in_use(), stream_broadcast_pool_misses());
+  }
+  bool first = true;
+  for (int i = 0; i < STREAM_MAX_SUBSCRIBERS && n < (int)len; i++) {
+    uint32_t sent, dropped;
+    if (stream_broadcast_subscriber(i, &sent, &dropped)) {
+      n += snprintf(buf + n, len - n, "%s{\"sent\":%u,\"dropped\":%u}", first ? "" : ",", sent, dropped);
+      first = false;
+    }
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "],\"consumers\":[");
+  }
+  int consumers = frame_broker_consumer_count();
+  for (int i = 0; i < consumers && n < (int)len; i++) {
+    n += snprintf(buf + n, len - n, "%s{\"name\":\"%s\",\"delivered\":%u,\"dropped\":%u}", i ? "," : "", frame_broker_consumer_name(i),
+                  frame_broker_delivered(i), frame_broker_dropped(i));
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "]}");
+  }
+  return n < (int)len ? n : -1;
+}
@@ -0,0 +1,33 @@
+/*
+ * Stream timing stats
+ *
+ * Running averages (over the last FRAME_STATS_WINDOW frames) and peaks
+ * for each stage of the stream path, shared by every stream subscriber
+ * and served as JSON on /stats. Replaces the per-sketch ra_filter.
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <Arduino.h>
+
+#define FRAME_STATS_WINDOW 20
+
+typedef enum {
+  FRAME_STAGE_CAPTURE,   // esp_camera_fb_get()
+  FRAME_STAGE_COPY,      // jpeg_pool_copy() (JPEG-encodes non-JPEG sensors)
+  FRAME_STAGE_SEND,      // One subscriber's boundary, part header and JPEG chunks
+  FRAME_STAGE_FRAME,     // One broadcaster iteration (1 / capture fps)
+  FRAME_STAGE_COUNT
+} frame_stage_t;
+
+void frame_stats_init();
+void frame_stats_record(frame_stage_t stage, uint32_t us);
+
+// Running average of the stage in microseconds (0 before the first sample)
+uint32_t frame_stats_average(frame_stage_t stage);
+
+// Write {"frames":..,"fps":..,"capture":{..},...,"subscribers":[..],"consumers":[..]} into buf
+int frame_stats_json(char *buf, size_t len);
+
+#endif
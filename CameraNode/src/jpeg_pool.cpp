@@ -0,0 +1,97 @@
+/*
+ * Pooled JPEG frame copies implementation
+ */
+
+#include "jpeg_pool.h"
+#include "img_converters.h"
+
+typedef struct {
+  shared_fb_t shared;   // refs == 0: free
+  camera_fb_t fb;
+  size_t capacity;      // Bytes allocated at fb.buf
+} jpeg_slot_t;
+
+static jpeg_slot_t slots[JPEG_POOL_MAX_SLOTS];
+static int slot_count = 0;
+
+void jpeg_pool_init(int count) {
+  slot_count = min(count, JPEG_POOL_MAX_SLOTS);
+  for (int i = 0; i < slot_count; i++) {
+    jpeg_slot_t *slot = &slots[i];
+    slot->shared.fb = &slot->fb;
+    slot->shared.refs = 0;
+    slot->shared.pooled = true;
+    slot->fb.buf = NULL;
+    slot->capacity = 0;
+  }
+}
+
+static bool reserve(jpeg_slot_t *slot, size_t len) {
+  if (len <= slot->capacity) {
+    return true;
+  }
+  // Headroom so a frame slightly larger than the last does not realloc again
+  size_t capacity = len + len / 4;
+  uint8_t *buf = psramFound() ? (uint8_t *)ps_realloc(slot->fb.buf, capacity) : (uint8_t *)realloc(slot->fb.buf, capacity);
+  if (!buf) {
+    return false;
+  }
+  slot->fb.buf = buf;
+  slot->capacity = capacity;
+  return true;
+}
+
+shared_fb_t *jpeg_pool_copy(camera_fb_t *fb) {
+  jpeg_slot_t *slot = NULL;
+  for (int i = 0; i < slot_count && !slot; i++) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&slots[i].shared.refs, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      slot = &slots[i];
+    }
+  }
+  if (!slot) {
+    return NULL;
+  }
+
+  bool copied = false;
+  if (fb->format == PIXFORMAT_JPEG) {
+    copied = reserve(slot, fb->len);
+    if (copied) {
+      memcpy(slot->fb.buf, fb->buf, fb->len);
+      slot->fb.len = fb->len;
+    }
+  } else {
+    uint8_t *jpg = NULL;
+    size_t jpg_len = 0;
+    if (frame2jpg(fb, 80, &jpg, &jpg_len)) {
+      copied = reserve(slot, jpg_len);
+      if (copied) {
+        memcpy(slot->fb.buf, jpg, jpg_len);
+        slot->fb.len = jpg_len;
+      }
+      free(jpg);
+    } else {
+      log_e("JPEG compression failed");
+    }
+  }
+  if (!copied) {
+    __atomic_store_n(&slot->shared.refs, 0, __ATOMIC_RELEASE);
+    return NULL;
+  }
+
+  slot->fb.width = fb->width;
+  slot->fb.height = fb->height;
+  slot->fb.format = PIXFORMAT_JPEG;
+  slot->fb.timestamp = fb->timestamp;
+  return &slot->shared;
+}
+
+int jpeg_pool_in_use() {
+  int used = 0;
+  for (int i = 0; i < slot_count; i++) {
+    if (__atomic_load_n(&slots[i].shared.refs, __ATOMIC_RELAXED) > 0) {
+      used++;
+    }
+  }
+  return used;
+}
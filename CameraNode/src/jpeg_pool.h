@@ -0,0 +1,32 @@
+/*
+ * Pooled JPEG frame copies
+ *
+ * The camera driver has only fb_count (2) buffers, so a slow stream
+ * subscriber holding a driver fb would stall capture for everyone. The
+ * broadcaster copies each frame into one of these slots instead and
+ * returns the fb at once. Slot buffers live in PSRAM, grow to the largest
+ * frame seen and are never freed, so steady-state streaming does not
+ * allocate.
+ */
+
+#ifndef JPEG_POOL_H
+#define JPEG_POOL_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "shared_fb.h"
+
+#define JPEG_POOL_MAX_SLOTS 16
+
+// Create up to JPEG_POOL_MAX_SLOTS empty slots (buffers are allocated on first use)
+void jpeg_pool_init(int slots);
+
+// Copy fb (JPEG-encoding non-JPEG frames) into a free slot, returned with
+// one reference held by the caller. NULL when every slot is held or the
+// buffer cannot grow; the caller still owns and returns fb either way.
+shared_fb_t *jpeg_pool_copy(camera_fb_t *fb);
+
+// Slots currently held by at least one subscriber or consumer
+int jpeg_pool_in_use();
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Refcounted camera frame buffer
+ *
+ * Lets the stream broadcaster hand one frame to every stream subscriber
+ * and frame broker consumer without decoding or copying it per holder.
+ * A driver fb goes back to the driver when the last holder releases it;
+ * a pooled copy (jpeg_pool) just becomes free for the next frame.
+ */
+
+#ifndef SHARED_FB_H
+#define SHARED_FB_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+typedef struct {
+  camera_fb_t *fb;
+  int refs;
+  bool pooled;   // fb is a jpeg_pool copy, reused once refs drops to 0
+} shared_fb_t;
+
+// Wrap fb with one reference held by the caller (NULL if out of memory)
+static inline shared_fb_t *shared_fb_create(camera_fb_t *fb) {
+  shared_fb_t *shared = (shared_fb_t *)malloc(sizeof(shared_fb_t));
+  if (shared) {
+    shared->fb = fb;
+    shared->refs = 1;
+    shared->pooled = false;
+  }
+  return shared;
+}
+
+static inline void shared_fb_retain(shared_fb_t *shared) {
+  __atomic_add_fetch(&shared->refs, 1, __ATOMIC_RELAXED);
+}
+
+// Drop one reference; the last one returns the fb to the camera driver
+// (or, for a pooled copy, frees its slot)
+static inline void shared_fb_release(shared_fb_t *shared) {
+  if (__atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) == 0 && !shared->pooled) {
+    esp_camera_fb_return(shared->fb);
+    free(shared);
+  }
+}
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * MJPEG stream broadcaster implementation
+ */
+
+#include "stream_broadcast.h"
+#include "capture_mode.h"
+#include "frame_broker.h"
+#include "frame_stats.h"
+#include "jpeg_pool.h"
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define PART_BOUNDARY "123456789000000000000987654321"
+static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
+
+typedef struct {
+  httpd_req_t *req;       // Async copy of the /stream request, NULL when the slot is free
+  QueueHandle_t frames;   // Newest frame not yet sent (one slot)
+  uint32_t sent;
+  uint32_t dropped;       // Replaced by a newer frame before it was sent
+} subscriber_t;
+
+static subscriber_t subscribers[STREAM_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+static SemaphoreHandle_t subscriber_lock = NULL;   // Slot claims, releases and frame distribution
+static SemaphoreHandle_t wake = NULL;              // Given when the first subscriber arrives
+static shared_fb_t *latest = NULL;                 // Newest frame, retained for snapshots while streaming
+static void (*on_streaming_changed)(bool) = NULL;
+static uint32_t pool_misses = 0;
+
+static void unsubscribe(subscriber_t *sub) {
+  xSemaphoreTake(subscriber_lock, portMAX_DELAY);
+  shared_fb_t *frame = NULL;
+  while (xQueueReceive(sub->frames, &frame, 0) == pdTRUE) {
+    shared_fb_release(frame);
+  }
+  httpd_req_async_handler_complete(sub->req);
+  sub->req = NULL;
+  int remaining = __atomic_sub_fetch(&subscriber_count, 1, __ATOMIC_RELEASE);
+  if (remaining == 0) {
+    // Snapshots capture directly again; free the retained slot
+    if (latest) {
+      shared_fb_release(latest);
+      latest = NULL;
+    }
+    if (on_streaming_changed) {
+      on_streaming_changed(false);
+    }
+  }
+  xSemaphoreGive(subscriber_lock);
+
+  capture_client_end();
+  log_i("Stream client left (%u sent, %u dropped), %d remaining", sub->sent, sub->dropped, remaining);
+}
+
+// Sends whatever frame is newest in the mailbox, one subscriber per task
+static void sender_task(void *pvParameters) {
+  subscriber_t *sub = (subscriber_t *)pvParameters;
+  char part_buf[128];
+
+  while (true) {
+    shared_fb_t *frame = NULL;
+    if (xQueueReceive(sub->frames, &frame, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    camera_fb_t *fb = frame->fb;
+    int64_t send_start = esp_timer_get_time();
+    esp_err_t res = httpd_resp_send_chunk(sub->req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+    if (res == ESP_OK) {
+      size_t hlen = snprintf(part_buf, sizeof(part_buf), _STREAM_PART, (uint32_t)fb->len, (int)fb->timestamp.tv_sec, (int)fb->timestamp.tv_usec);
+      res = httpd_resp_send_chunk(sub->req, part_buf, hlen);
+    }
+    if (res == ESP_OK) {
+      res = httpd_resp_send_chunk(sub->req, (const char *)fb->buf, fb->len);
+    }
+    shared_fb_release(frame);
+
+    if (res != ESP_OK) {
+      log_e("Send frame failed");
+      unsubscribe(sub);
+      continue;
+    }
+    frame_stats_record(FRAME_STAGE_SEND, (uint32_t)(esp_timer_get_time() - send_start));
+    sub->sent++;
+  }
+}
+
+// Captures once per frame for every subscriber; sleeps while there are none
+static void broadcast_task(void *pvParameters) {
+  int64_t last_frame = 0;
+
+  while (true) {
+    if (__atomic_load_n(&subscriber_count, __ATOMIC_ACQUIRE) == 0) {
+      xSemaphoreTake(wake, portMAX_DELAY);
+      last_frame = 0;
+      continue;
+    }
+
+    int64_t fr_start = esp_timer_get_time();
+    camera_fb_t *fb = esp_camera_fb_get();
+    int64_t fr_captured = esp_timer_get_time();
+    if (!fb) {
+      log_e("Camera capture failed");
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+      continue;
+    }
+    frame_stats_record(FRAME_STAGE_CAPTURE, (uint32_t)(fr_captured - fr_start));
+
+    // The driver fb goes straight back; subscribers hold the pooled copy
+    shared_fb_t *frame = jpeg_pool_copy(fb);
+    esp_camera_fb_return(fb);
+    if (!frame) {
+      pool_misses++;
+      continue;
+    }
+    frame_stats_record(FRAME_STAGE_COPY, (uint32_t)(esp_timer_get_time() - fr_captured));
+
+    // The classifier and other consumers sample the same copy
+    frame_broker_offer(frame);
+
+    xSemaphoreTake(subscriber_lock, portMAX_DELAY);
+    if (subscriber_count > 0) {
+      shared_fb_retain(frame);
+      if (latest) {
+        shared_fb_release(latest);
+      }
+      latest = frame;
+    }
+    for (int i = 0; i < STREAM_MAX_SUBSCRIBERS; i++) {
+      subscriber_t *sub = &subscribers[i];
+      if (!sub->req) {
+        continue;
+      }
+      shared_fb_t *stale = NULL;
+      if (xQueueReceive(sub->frames, &stale, 0) == pdTRUE) {
+        shared_fb_release(stale);
+        sub->dropped++;
+      }
+      shared_fb_retain(frame);
+      if (xQueueSend(sub->frames, &frame, 0) != pdTRUE) {
+        shared_fb_release(frame);
+      }
+    }
+    xSemaphoreGive(subscriber_lock);
+    size_t frame_len = frame->fb->len;
+    shared_fb_release(frame);
+
+    int64_t fr_end = esp_timer_get_time();
+    if (last_frame) {
+      int64_t frame_time = fr_end - last_frame;
+      frame_stats_record(FRAME_STAGE_FRAME, (uint32_t)frame_time);
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+      uint32_t avg_frame_time = frame_stats_average(FRAME_STAGE_FRAME) / 1000;
+#endif
+      log_i(
+        "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps), %d clients", (uint32_t)frame_len, (uint32_t)(frame_time / 1000),
+        1000000.0 / frame_time, avg_frame_time, 1000.0 / avg_frame_time, stream_broadcast_subscriber_count()
+      );
+    }
+    last_frame = fr_end;
+  }
+}
+
+void stream_broadcast_init(void (*streaming_changed)(bool streaming)) {
+  on_streaming_changed = streaming_changed;
+  subscriber_lock = xSemaphoreCreateMutex();
+  wake = xSemaphoreCreateBinary();
+
+  // Every subscriber holds up to two frames (sending + pending), every
+  // consumer up to two (queued + decoding), plus the one being filled, the
+  // retained newest frame and one snapshot still being sent from an older one
+  jpeg_pool_init(STREAM_MAX_SUBSCRIBERS * 2 + frame_broker_consumer_count() * 2 + 3);
+
+  for (int i = 0; i < STREAM_MAX_SUBSCRIBERS; i++) {
+    subscriber_t *sub = &subscribers[i];
+    sub->req = NULL;
+    sub->frames = xQueueCreate(1, sizeof(shared_fb_t *));
+    sub->sent = 0;
+    sub->dropped = 0;
+    xTaskCreatePinnedToCore(sender_task, "StreamSend", STREAM_TASK_STACK_SIZE, sub, STREAM_TASK_PRIORITY, NULL, tskNO_AFFINITY);
+  }
+  xTaskCreatePinnedToCore(broadcast_task, "StreamCapture", STREAM_TASK_STACK_SIZE, NULL, STREAM_TASK_PRIORITY, NULL, tskNO_AFFINITY);
+}
+
+esp_err_t stream_broadcast_subscribe(httpd_req_t *req) {
+  xSemaphoreTake(subscriber_lock, portMAX_DELAY);
+  subscriber_t *sub = NULL;
+  for (int i = 0; i < STREAM_MAX_SUBSCRIBERS && !sub; i++) {
+    if (!subscribers[i].req) {
+      sub = &subscribers[i];
+    }
+  }
+  httpd_req_t *async_req = NULL;
+  if (!sub || httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+    xSemaphoreGive(subscriber_lock);
+    return ESP_FAIL;
+  }
+
+  httpd_resp_set_type(async_req, _STREAM_CONTENT_TYPE);
+  httpd_resp_set_hdr(async_req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(async_req, "X-Framerate", "60");
+  sub->req = async_req;
+  sub->sent = 0;
+  sub->dropped = 0;
+  bool first = __atomic_add_fetch(&subscriber_count, 1, __ATOMIC_RELEASE) == 1;
+  if (first && on_streaming_changed) {
+    on_streaming_changed(true);
+  }
+  xSemaphoreGive(subscriber_lock);
+
+  capture_client_begin();
+  if (first) {
+    xSemaphoreGive(wake);
+  }
+  log_i("Stream client joined, %d streaming", stream_broadcast_subscriber_count());
+  return ESP_OK;
+}
+
+int stream_broadcast_subscriber_count() {
+  return __atomic_load_n(&subscriber_count, __ATOMIC_ACQUIRE);
+}
+
+bool stream_broadcast_subscriber(int index, uint32_t *sent, uint32_t *dropped) {
+  const subscriber_t *sub = &subscribers[index];
+  if (!sub->req) {
+    return false;
+  }
+  *sent = sub->sent;
+  *dropped = sub->dropped;
+  return true;
+}
+
+shared_fb_t *stream_broadcast_latest(uint32_t wait_ms) {
+  int64_t deadline = esp_timer_get_time() + (int64_t)wait_ms * 1000;
+  while (stream_broadcast_subscriber_count() > 0) {
+    xSemaphoreTake(subscriber_lock, portMAX_DELAY);
+    shared_fb_t *frame = latest;
+    if (frame) {
+      shared_fb_retain(frame);
+    }
+    xSemaphoreGive(subscriber_lock);
+    if (frame || esp_timer_get_time() >= deadline) {
+      return frame;
+    }
+    vTaskDelay(10 / portTICK_PERIOD_MS);   // First frame after a client joined
+  }
+  return NULL;
+}
+
+uint32_t stream_broadcast_pool_misses() {
+  return pool_misses;
+}
@@ -0,0 +1,50 @@
+/*
+ * MJPEG stream broadcaster
+ *
+ * One task captures each frame once, copies it into a jpeg_pool slot and
+ * pushes that refcounted copy to every /stream subscriber and to the frame
+ * broker. Each subscriber has its own sender task and a one-frame mailbox:
+ * a subscriber still sending when the next frame arrives has its pending
+ * frame replaced, so a slow viewer drops frames instead of slowing the
+ * camera or the other viewers down.
+ */
+
+#ifndef STREAM_BROADCAST_H
+#define STREAM_BROADCAST_H
+
+#include <Arduino.h>
+#include "esp_http_server.h"
+#include "shared_fb.h"
+
+#ifndef STREAM_MAX_SUBSCRIBERS
+#define STREAM_MAX_SUBSCRIBERS 4   // e.g. smartswitch, recorder and a person on the web UI
+#endif
+
+#define STREAM_TASK_STACK_SIZE 4096
+#define STREAM_TASK_PRIORITY   2   // Above the sketches' classifier and publisher tasks
+
+// Start the broadcaster and sender tasks. streaming_changed (may be NULL)
+// is called with true when the first subscriber arrives and false when the
+// last one leaves. Call after every frame broker consumer is subscribed.
+void stream_broadcast_init(void (*streaming_changed)(bool streaming));
+
+// Take over a /stream request; it is answered asynchronously until the
+// client goes away. ESP_FAIL when STREAM_MAX_SUBSCRIBERS are already
+// streaming (req is untouched and the caller should reply 503).
+esp_err_t stream_broadcast_subscribe(httpd_req_t *req);
+
+int stream_broadcast_subscriber_count();
+
+// Per-subscriber counters for /stats (false for a free slot)
+bool stream_broadcast_subscriber(int index, uint32_t *sent, uint32_t *dropped);
+
+// Newest broadcast frame for snapshots (/capture, /bmp), so they never
+// capture alongside the broadcaster. Waits up to wait_ms for the first
+// frame; NULL when nobody is streaming or none arrived. The caller owns
+// one reference and must shared_fb_release() it.
+shared_fb_t *stream_broadcast_latest(uint32_t wait_ms);
+
+// Frames captured but not sent to anyone because every pool slot was held
+uint32_t stream_broadcast_pool_misses();
+
+#endif
@@ -31,7 +31,8 @@
 //#define CAMERA_MODEL_DFRobot_FireBeetle2_ESP32S3 // Has PSRAM
 //#define CAMERA_MODEL_DFRobot_Romeo_ESP32S3 // Has PSRAM
 
-#include "camera_pins.h"
+#include <camera_node.h>
+#include <camera_pins.h>
 #include <PubSubClient.h>
 #include <WiFiClientSecure.h>
 #include "freertos/FreeRTOS.h"
@@ -42,6 +43,8 @@
 #define EI_CAMERA_RAW_FRAME_BUFFER_COLS           320
 #define EI_CAMERA_RAW_FRAME_BUFFER_ROWS           240
 #define EI_CAMERA_FRAME_BYTE_SIZE                 3
+#define STREAM_FRAMESIZE_DEFAULT                  FRAMESIZE_VGA
+#define CLASSIFIER_SAMPLE_INTERVAL_MS             1000   // At most one frame per period from the broker
 #define MSG_BUFFER_SIZE (500)
 #define BLYNK_TEMPLATE_ID "TMPL3TWSW8w4R"
 #define BLYNK_TEMPLATE_NAME "Smart Camera"
@@ -54,18 +57,36 @@ const char* mqtt_server = "a7cb0fef114e49ce9263c516dd6f7e61.s1.eu.hivemq.cloud";
 const char* mqtt_username = "ESP32Client"; // replace with your Username
 const char* mqtt_password = "Summathan1"; // replace with your Password
 const int mqtt_port = 8883;
-uint8_t *snapshot_buf; //points to the output of the capture
-SemaphoreHandle_t fb_mutex = NULL;
+
+// Classifier input: two decoded frames in PSRAM, owned by whichever side
+// last took them from a queue. decoder_task fills a frame taken from
+// free_frames and posts it to ready_frames; classifier_task resizes it
+// into model_input_buf and hands it straight back to free_frames.
+#define CLASSIFIER_INPUT_BUFFERS 2
+typedef decoded_frame_t classifier_frame_t;  // EI_CAMERA_RAW_FRAME_BUFFER_COLS x _ROWS capacity
+classifier_frame_t input_frames[CLASSIFIER_INPUT_BUFFERS];
+QueueHandle_t free_frames;
+QueueHandle_t ready_frames;
+uint8_t *model_input_buf;  // EI_CLASSIFIER_INPUT_WIDTH x _HEIGHT RGB888, read by run_classifier
 size_t out_len = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
-bool do_resize = false;
 static bool debug_nn = false;
-unsigned long lastDetectionTime = 0;
-bool detectionReported = false;
 const unsigned long DETECTION_TIMEOUT = 15000; 
-char msg[MSG_BUFFER_SIZE];
+
+// Detection publishing: classifier_task posts one report per inference,
+// publisher_task owns the MQTT client and publishes state changes only
+#define REPORT_QUEUE_LENGTH 8
+#define MQTT_HEARTBEAT_INTERVAL 60000   // Re-publish current state this often (ms)
+#define MQTT_RETRY_INTERVAL 5000        // Between connection attempts (ms)
+#define MQTT_KEEPALIVE_SECONDS 60
+typedef struct {
+  uint32_t timestamp;   // millis() of the inference
+  uint16_t boxes;       // Boxes with a non-zero score
+  float max_score;
+} detection_report_t;
+QueueHandle_t report_queue;
 WiFiClientSecure espClient;  
 PubSubClient client(espClient);
-QueueHandle_t frame_queue;
+frame_consumer_t *classifier_feed;  // Stream frames sampled by the broker (or captured when idle)
 
 
 // HiveMQ Cloud Let's Encrypt CA certificate
@@ -103,28 +124,78 @@ emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=
 -----END CERTIFICATE-----
 )EOF";
 
-void publish_client(char msg[]){
-  client.publish("SensePresence", msg);
+// Try to (re)connect without blocking for more than one attempt
+static bool mqtt_connect() {
+  static unsigned long last_attempt = 0;
+  if (client.connected()) {
+    return true;
+  }
+  if (last_attempt && millis() - last_attempt < MQTT_RETRY_INTERVAL) {
+    return false;
+  }
+  last_attempt = millis();
+
+  Serial.print("Attempting MQTT connection… ");
+  String clientId = "ESP32Client";
+  if (client.connect(clientId.c_str(), mqtt_username, mqtt_password)) {
+    Serial.println("connected!");
+    // Once connected, publish an announcement…
+    client.publish("online", "Sensor v1 online");
+    return true;
+  }
+  Serial.print("failed, rc = ");
+  Serial.print(client.state());
+  Serial.println(" retrying in 5 seconds");
+  return false;
+}
+
+// Compact presence message: state plus what the last inferences saw
+static bool publish_state(bool present, const detection_report_t *report) {
+  char msg[MSG_BUFFER_SIZE];
+  snprintf(msg, sizeof(msg), "{\"state\":\"%s\",\"boxes\":%u,\"score\":%.2f,\"ts\":%lu}",
+           present ? "Detected" : "Not detected", report->boxes, report->max_score,
+           (unsigned long)report->timestamp);
+  return client.publish("SensePresence", msg);
 }
 
+// Owns the MQTT client: coalesces reports, publishes on presence
+// transitions plus a periodic heartbeat, and services the connection
+void publisher_task(void *pvParameters) {
+  bool present = false;
+  bool pending = false;             // Transition not yet delivered
+  unsigned long last_detection = 0;
+  unsigned long last_publish = 0;
+  detection_report_t latest = { 0 };
+
+  while (1) {
+    detection_report_t report;
+    while (xQueueReceive(report_queue, &report, 100 / portTICK_PERIOD_MS) == pdTRUE) {
+      float max_score = max(latest.max_score, report.max_score);
+      latest = report;
+      latest.max_score = max_score;
+      if (report.boxes > 0) {
+        last_detection = report.timestamp;
+        if (!present) {
+          present = true;
+          pending = true;
+        }
+      }
+    }
+
+    if (present && millis() - last_detection > DETECTION_TIMEOUT) {
+      present = false;
+      pending = true;
+      Serial.println("No detection within timeout, reporting 'Not detected'");
+    }
 
-void reconnect() {
-  // Loop until we’re reconnected
-  while (!client.connected()) {
-    Serial.print("Attempting MQTT connection… ");
-    String clientId = "ESP32Client";
-    // Attempt to connect
-    if (client.connect(clientId.c_str(), mqtt_username, mqtt_password)) {
-      Serial.println("connected!");
-      // Once connected, publish an announcement…
-      client.publish("online", "Sensor v1 online");
-     
-    } else {
-      Serial.print("failed, rc = ");
-      Serial.print(client.state());
-      Serial.println(" try again in 5 seconds");
-      // Wait 5 seconds before retrying
-      delay(5000);
+    if (mqtt_connect()) {
+      client.loop();
+      bool heartbeat = millis() - last_publish >= MQTT_HEARTBEAT_INTERVAL;
+      if ((pending || heartbeat) && publish_state(present, &latest)) {
+        pending = false;
+        last_publish = millis();
+        latest.max_score = 0;
+      }
     }
   }
 }
@@ -140,7 +211,7 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     while (pixels_left != 0) {
         // Swap BGR to RGB here
         // due to https://github.com/espressif/esp32-camera/issues/379
-        out_ptr[out_ptr_ix] = (snapshot_buf[pixel_ix + 2] << 16) + (snapshot_buf[pixel_ix + 1] << 8) + snapshot_buf[pixel_ix];
+        out_ptr[out_ptr_ix] = (model_input_buf[pixel_ix + 2] << 16) + (model_input_buf[pixel_ix + 1] << 8) + model_input_buf[pixel_ix];
 
         // go to the next pixel
         out_ptr_ix++;
@@ -150,34 +221,66 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     // and done!
     return 0;
 }
-void startCameraServer();
-void setupLedFlash(int pin);
+static uint8_t *alloc_frame_buffer(size_t size) {
+  uint8_t *buf = psramFound() ? (uint8_t *)ps_malloc(size) : NULL;
+  if (!buf) {
+    buf = (uint8_t *)malloc(size);
+  }
+  return buf;
+}
+
+// Sampling stage: decode a broker frame into a free classifier frame.
+// With no stream running, the broker captures one at inference resolution.
+void decoder_task(void *pvParameters) {
+  while (1) {
+    shared_fb_t *sample = frame_broker_receive(classifier_feed);
+    if (!sample) {
+      continue;
+    }
+
+    // Both frames busy: drop the sample rather than hold the camera fb
+    classifier_frame_t *frame = NULL;
+    if (xQueueReceive(free_frames, &frame, 0) != pdTRUE) {
+      shared_fb_release(sample);
+      continue;
+    }
+
+    camera_fb_t *fb = sample->fb;
+    bool converted = frame_decode_rgb888(fb, EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT, frame);
+    if (!converted) {
+      log_e("Frame %dx%d could not be decoded for the classifier, skipped", fb->width, fb->height);
+    }
+    shared_fb_release(sample);
+
+    xQueueSend(converted ? ready_frames : free_frames, &frame, portMAX_DELAY);
+  }
+}
 
 void classifier_task(void *pvParameters) {
   
 
     while (1) {
-       if (xQueueReceive(frame_queue, &snapshot_buf, portMAX_DELAY) == pdTRUE) {
-    xSemaphoreTake(fb_mutex, portMAX_DELAY);
+       classifier_frame_t *frame = NULL;
+       if (xQueueReceive(ready_frames, &frame, portMAX_DELAY) == pdTRUE) {
+    // Resize into the model buffer, then give the frame back so the
+    // decoder can fill it while inference runs
+    if (frame->cols == EI_CLASSIFIER_INPUT_WIDTH && frame->rows == EI_CLASSIFIER_INPUT_HEIGHT) {
+      memcpy(model_input_buf, frame->pixels, EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT * EI_CAMERA_FRAME_BYTE_SIZE);
+    } else {
+      ei::image::processing::crop_and_interpolate_rgb888(
+        frame->pixels,
+        frame->cols,
+        frame->rows,
+        model_input_buf,
+        EI_CLASSIFIER_INPUT_WIDTH,
+        EI_CLASSIFIER_INPUT_HEIGHT);
+    }
+    xQueueSend(free_frames, &frame, portMAX_DELAY);
+
     ei::signal_t signal;
     signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
     signal.get_data = &ei_camera_get_data;
 
-   
-       if ((EI_CLASSIFIER_INPUT_WIDTH != EI_CAMERA_RAW_FRAME_BUFFER_COLS)
-           || (EI_CLASSIFIER_INPUT_HEIGHT != EI_CAMERA_RAW_FRAME_BUFFER_ROWS)) {
-           do_resize = true;
-       }
-   
-       if (do_resize) {
-           ei::image::processing::crop_and_interpolate_rgb888(
-            snapshot_buf,
-           EI_CAMERA_RAW_FRAME_BUFFER_COLS,
-           EI_CAMERA_RAW_FRAME_BUFFER_ROWS,
-           snapshot_buf,
-           EI_CLASSIFIER_INPUT_WIDTH,
-           EI_CLASSIFIER_INPUT_HEIGHT);
-       }
         ei_impulse_result_t result = { 0 };
 
     EI_IMPULSE_ERROR err = run_classifier(&signal, &result, debug_nn);
@@ -185,7 +288,6 @@ void classifier_task(void *pvParameters) {
         Serial.print(err);
         //res = ESP_FAIL;
     }
-     xSemaphoreGive(fb_mutex);
 
     // print the predictions
    log_e("Predictions (DSP: %d ms., Classification: %d ms., Anomaly: %d ms.): \n",
@@ -194,13 +296,14 @@ Serial.printf("Running on core: %d\n", xPortGetCoreID());
 
 #if EI_CLASSIFIER_OBJECT_DETECTION == 1
     Serial.print("Object detection bounding boxes:\r\n");
-    bool objectDetected = false;
+    detection_report_t report = { (uint32_t)millis(), 0, 0.0f };
     for (uint32_t i = 0; i < result.bounding_boxes_count; i++) {
         ei_impulse_result_bounding_box_t bb = result.bounding_boxes[i];
         if (bb.value == 0) {
             continue;
         }
-          objectDetected = true;
+        report.boxes++;
+        report.max_score = max(report.max_score, bb.value);
         char buffer[128];
 snprintf(buffer, sizeof(buffer), "  %s (%f) [ x: %u, y: %u, width: %u, height: %u ]",
          bb.label,
@@ -210,20 +313,9 @@ snprintf(buffer, sizeof(buffer), "  %s (%f) [ x: %u, y: %u, width: %u, height: %
          bb.width,
          bb.height);
 Serial.println(buffer);
-snprintf (msg, MSG_BUFFER_SIZE, "Detected");
-publish_client(msg);
-    }
-    if (objectDetected) {
-        lastDetectionTime = millis();
-        detectionReported = false;
-    } 
-    // Check if we need to send "Not detected" message
-    else if (!detectionReported && millis() - lastDetectionTime > DETECTION_TIMEOUT) {
-        snprintf(msg, MSG_BUFFER_SIZE, "Not detected");
-        publish_client(msg);
-        detectionReported = true; // Set flag to avoid sending repeatedly
-        Serial.println("No detection for 1 minute, sent 'Not detected' message");
     }
+    // Never blocks on the network; a full queue just loses this report
+    xQueueSend(report_queue, &report, 0);
 
     // Print the prediction results (classification)
 #else
@@ -234,7 +326,6 @@ publish_client(msg);
     }
 #endif
 //}
-   vTaskDelay(1000);     
     }}
 }
 
@@ -321,10 +412,8 @@ void setup() {
     s->set_brightness(s, 1);   // up the brightness just a bit
     s->set_saturation(s, -2);  // lower the saturation
   }
-  // drop down frame size for higher initial frame rate
-  if (config.pixel_format == PIXFORMAT_JPEG) {
-    s->set_framesize(s, FRAMESIZE_QVGA);
-  }
+  // Capture at inference size until a stream client attaches
+  camera_node_begin(capture_framesize_covering(EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT), STREAM_FRAMESIZE_DEFAULT);
 
 #if defined(CAMERA_MODEL_M5STACK_WIDE) || defined(CAMERA_MODEL_M5STACK_ESP32CAM)
   s->set_vflip(s, 1);
@@ -342,7 +431,25 @@ void setup() {
 
 
 
-   
+  // Classifier buffers are allocated once, before any stream can sample frames
+  classifier_feed = frame_broker_subscribe("classifier", CLASSIFIER_SAMPLE_INTERVAL_MS, true);
+  free_frames = xQueueCreate(CLASSIFIER_INPUT_BUFFERS, sizeof(classifier_frame_t*));
+  ready_frames = xQueueCreate(CLASSIFIER_INPUT_BUFFERS, sizeof(classifier_frame_t*));
+  model_input_buf = alloc_frame_buffer(EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT * EI_CAMERA_FRAME_BYTE_SIZE);
+  if (model_input_buf == nullptr) {
+    log_e("ERR: Failed to allocate model input buffer!\n");
+  }
+  for (int i = 0; i < CLASSIFIER_INPUT_BUFFERS; i++) {
+    classifier_frame_t *frame = &input_frames[i];
+    frame->capacity = EI_CAMERA_RAW_FRAME_BUFFER_COLS * EI_CAMERA_RAW_FRAME_BUFFER_ROWS;
+    frame->pixels = alloc_frame_buffer(frame->capacity * EI_CAMERA_FRAME_BYTE_SIZE);
+    if (frame->pixels == nullptr) {
+      log_e("ERR: Failed to allocate classifier frame %d!\n", i);
+      continue;
+    }
+    xQueueSend(free_frames, &frame, 0);
+  }
+
 startCameraServer();
 
   Serial.print("Camera Ready! Use 'http://");
@@ -351,15 +458,8 @@ startCameraServer();
   Serial.println("' to connect");
    espClient.setCACert(root_ca);
   client.setServer(mqtt_server, mqtt_port);
-  snapshot_buf = (uint8_t*)malloc(EI_CAMERA_RAW_FRAME_BUFFER_COLS * EI_CAMERA_RAW_FRAME_BUFFER_ROWS * EI_CAMERA_FRAME_BYTE_SIZE);
-
-    // check if allocation was successful
-    if(snapshot_buf == nullptr) {
-        log_e("ERR: Failed to allocate snapshot buffer!\n");
-       //espres = ESP_FAIL;
-    }
-    fb_mutex= xSemaphoreCreateMutex();
-    frame_queue = xQueueCreate(1, sizeof(uint8_t*)); 
+  client.setKeepAlive(MQTT_KEEPALIVE_SECONDS);
+  report_queue = xQueueCreate(REPORT_QUEUE_LENGTH, sizeof(detection_report_t));
 
 digitalWrite(33,LOW);
     xTaskCreatePinnedToCore(
@@ -371,18 +471,32 @@ digitalWrite(33,LOW);
     NULL,               // Task handle
     0                   // Core (0 or 1)
   );
+    xTaskCreatePinnedToCore(
+    decoder_task,       // Task function
+    "Decoder",          // Name
+    8192,               // Stack size
+    NULL,               // Parameters
+    1,                  // Priority
+    NULL,               // Task handle
+    1                   // Core (0 or 1)
+  );
+    xTaskCreatePinnedToCore(
+    publisher_task,     // Task function
+    "Publisher",        // Name
+    8192,               // Stack size (TLS handshake)
+    NULL,               // Parameters
+    1,                  // Priority
+    NULL,               // Task handle
+    1                   // Core (0 or 1)
+  );
 }
 
 
 void loop() {
-  if (!client.connected()) {
-    reconnect();
-  }
-  client.loop();
  int temp = temperatureRead();  // Convert to °C properly
   Serial.print("CPU Temperature: ");
   Serial.print(temp);
   Serial.println(" °C");
-  // Do nothing. Everything is done in another task by the web server
+  // Do nothing. Everything is done in the web server, classifier and publisher tasks
   delay(10000);
 }
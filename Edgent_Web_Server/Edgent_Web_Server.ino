@@ -39,7 +39,8 @@
 #define APP_DEBUG
 #include <WiFi.h>
 #include "BlynkEdgent.h"
-#include "camera_pins.h"
+#include <camera_node.h>
+#include <camera_pins.h>
 //#include <PubSubClient.h>
 //#include <WiFiClientSecure.h>
 #include "freertos/FreeRTOS.h"
@@ -50,6 +51,8 @@
 #define EI_CAMERA_RAW_FRAME_BUFFER_COLS           320
 #define EI_CAMERA_RAW_FRAME_BUFFER_ROWS           240
 #define EI_CAMERA_FRAME_BYTE_SIZE                 3
+#define STREAM_FRAMESIZE_DEFAULT                  FRAMESIZE_VGA
+#define CLASSIFIER_SAMPLE_INTERVAL_MS             1000   // At most one frame per period from the broker
 #define MSG_BUFFER_SIZE (500)
 #define BLYNK_TEMPLATE_ID "TMPL3TWSW8w4R"
 #define BLYNK_TEMPLATE_NAME "Smart Camera"
@@ -63,7 +66,6 @@ const char *password = "prasanna@05";
 // const char* mqtt_password = "Summathan1"; // replace with your Password
 // const int mqtt_port = 8883;
 uint8_t *snapshot_buf; //points to the output of the capture
-SemaphoreHandle_t fb_mutex = NULL;
 size_t out_len = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
 bool do_resize = false;
 static bool debug_nn = false;
@@ -74,7 +76,7 @@ int detection = 0;
 char msg[MSG_BUFFER_SIZE];
 //WiFiClientSecure espClient;  
 //PubSubClient client(espClient);
-QueueHandle_t frame_queue;
+frame_consumer_t *classifier_feed;  // Stream frames sampled by the broker (or captured when idle)
 
 
 // HiveMQ Cloud Let's Encrypt CA certificate
@@ -159,8 +161,6 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     // and done!
     return 0;
 }
-void startCameraServer();
-void setupLedFlash(int pin);
 BLYNK_WRITE(V1) { detection = param.asInt();}
 void blynk_task(void *pvParameters){
   while (1){
@@ -181,23 +181,28 @@ void classifier_task(void *pvParameters) {
     while (1) {
       Blynk.syncVirtual(V1);
       Serial.println(detection);
-       if (xQueueReceive(frame_queue, &snapshot_buf, portMAX_DELAY) == pdTRUE && detection==1) {
-    xSemaphoreTake(fb_mutex, portMAX_DELAY);
+       shared_fb_t *sample = frame_broker_receive(classifier_feed);
+       if (!sample) {
+         continue;
+       }
+       // Decode straight from the shared fb; only this task touches snapshot_buf
+       decoded_frame_t frame = { snapshot_buf, EI_CAMERA_RAW_FRAME_BUFFER_COLS * EI_CAMERA_RAW_FRAME_BUFFER_ROWS, 0, 0 };
+       bool converted = detection == 1 && snapshot_buf
+                        && frame_decode_rgb888(sample->fb, EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT, &frame);
+       shared_fb_release(sample);
+       if (converted) {
     ei::signal_t signal;
     signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
     signal.get_data = &ei_camera_get_data;
 
    
-       if ((EI_CLASSIFIER_INPUT_WIDTH != EI_CAMERA_RAW_FRAME_BUFFER_COLS)
-           || (EI_CLASSIFIER_INPUT_HEIGHT != EI_CAMERA_RAW_FRAME_BUFFER_ROWS)) {
-           do_resize = true;
-       }
+       do_resize = frame.cols != EI_CLASSIFIER_INPUT_WIDTH || frame.rows != EI_CLASSIFIER_INPUT_HEIGHT;
    
        if (do_resize) {
            ei::image::processing::crop_and_interpolate_rgb888(
             snapshot_buf,
-           EI_CAMERA_RAW_FRAME_BUFFER_COLS,
-           EI_CAMERA_RAW_FRAME_BUFFER_ROWS,
+           frame.cols,
+           frame.rows,
            snapshot_buf,
            EI_CLASSIFIER_INPUT_WIDTH,
            EI_CLASSIFIER_INPUT_HEIGHT);
@@ -209,7 +214,6 @@ void classifier_task(void *pvParameters) {
         Serial.print(err);
         //res = ESP_FAIL;
     }
-     xSemaphoreGive(fb_mutex);
 
     // print the predictions
    log_e("Predictions (DSP: %d ms., Classification: %d ms., Anomaly: %d ms.): \n",
@@ -361,6 +365,9 @@ void setup() {
   if (config.pixel_format == PIXFORMAT_JPEG) {
     s->set_framesize(s, FRAMESIZE_QVGA);
   }
+  // Capture at inference size until a stream client attaches
+  camera_node_begin(capture_framesize_covering(EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT), STREAM_FRAMESIZE_DEFAULT);
+  classifier_feed = frame_broker_subscribe("classifier", CLASSIFIER_SAMPLE_INTERVAL_MS, true);
 
 #if defined(CAMERA_MODEL_M5STACK_WIDE) || defined(CAMERA_MODEL_M5STACK_ESP32CAM)
   s->set_vflip(s, 1);
@@ -398,8 +405,6 @@ startCameraServer();
         log_e("ERR: Failed to allocate snapshot buffer!\n");
        //espres = ESP_FAIL;
     }
-    fb_mutex= xSemaphoreCreateMutex();
-    frame_queue = xQueueCreate(1, sizeof(uint8_t*)); 
 
 digitalWrite(33,LOW);
     xTaskCreatePinnedToCore(
@@ -0,0 +1,445 @@
+/**
+ * Frame Pipeline Replay Benchmark (Linux host)
+ *
+ * Feeds a recorded multipart MJPEG stream through the sketch's own
+ * MJPEGStream parser, DetectionPipeline and ZoneManager, the same way
+ * processFrame() does on the device, and reports:
+ * - replay throughput (frames/s of host CPU)
+ * - per-stage latency from the shared Metrics histograms
+ * - heap allocations per frame in steady state
+ * - zone occupancy against a ground-truth scene file
+ *
+ * See README.md for the build command and the corpus formats.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+#include "config.h"
+#include "detector.h"
+#include "frame_pool.h"
+#include "metrics.h"
+#include "mjpeg_stream.h"
+#include "motion_detector.h"
+#include "tflite_detector.h"
+#include "zone_manager.h"
+
+#define BENCH_DEFAULT_FPS 10
+#define BENCH_PERSON_MAX_PIXELS (320 * 240)   // PERSON_FRAME_MAX_PIXELS in smartswitch.ino
+#define BENCH_MOTION_SENSITIVITY 0.15         // As set in setup()
+
+/**
+ * Ground truth: zone occupied for frames first..last (inclusive, 1-based)
+ */
+struct TruthSpan {
+  int zoneId;
+  int first;
+  int last;
+};
+
+/**
+ * Per-zone agreement with the ground truth
+ */
+struct ZoneScore {
+  int zoneId;
+  int truePositive;
+  int falsePositive;
+  int falseNegative;
+  int trueNegative;
+  int switches;       // Confirmed on/off transitions (relay switching)
+  bool wasActive;
+};
+
+/**
+ * Benchmark options
+ */
+struct BenchOptions {
+  const char* capture;
+  const char* scene;
+  const char* dataDir;
+  const char* prometheus;
+  int fps;
+  int maxFrames;
+  bool verbose;
+};
+
+static FramePool framePool;
+static MJPEGStream mjpegStream;
+static MotionDetector motionDetector;
+static TFLiteDetector personDetector;
+static MotionBackend motionBackend(&motionDetector);
+static PersonBackend personBackend(&personDetector);
+static DetectionPipeline detectionPipeline;
+static ZoneManager zoneManager;
+static Config config;
+static std::vector<TruthSpan> truth;
+
+static void printUsage() {
+  fprintf(stderr,
+          "Usage: bench_replay <capture.mjpeg> [options]\n"
+          "  --scene FILE        Zones and ground-truth occupancy\n"
+          "  --pipeline NAME     motion | person | cascade | both (default cascade)\n"
+          "  --confirm N/M       Zone confirmation, N of the last M frames (default 2/3)\n"
+          "  --smoothing F       Occupancy score weight of the newest frame (default 0.3)\n"
+          "  --no-roi            Person model sees the whole frame\n"
+          "  --fps N             Capture frame rate for the virtual clock (default %d)\n"
+          "  --frames N          Stop after N frames\n"
+          "  --data DIR          Directory standing in for LittleFS (default data)\n"
+          "  --prometheus FILE   Also write the /api/metrics text export\n"
+          "  --verbose           Show the sketch's Serial output\n",
+          BENCH_DEFAULT_FPS);
+}
+
+// DetectorPipeline order (pipelineToString() lives in config.cpp, not built here)
+static const char* PIPELINE_NAMES[] = {"motion", "person", "cascade", "both"};
+
+static bool parsePipeline(const char* name, DetectorPipeline* pipeline) {
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(name, PIPELINE_NAMES[i]) == 0) {
+      *pipeline = (DetectorPipeline)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Same values as setDefaultConfig() for everything the pipeline reads
+ */
+static void setBenchConfig() {
+  config.detectionThreshold = 0.5;
+  config.globalTimeout = 30;
+  config.confirmFrames = 2;
+  config.confirmWindow = 3;
+  config.occupancySmoothing = 0.3;
+  config.pipeline = PIPELINE_CASCADE;
+  config.roiInference = true;
+  config.relayActiveHigh = true;
+  config.autoRelayControl = true;
+  config.powerSave = false;
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions* options) {
+  if (argc < 2 || argv[1][0] == '-') {
+    return false;
+  }
+  options->capture = argv[1];
+
+  for (int i = 2; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--no-roi") == 0) {
+      config.roiInference = false;
+    } else if (strcmp(arg, "--verbose") == 0) {
+      options->verbose = true;
+    } else if (!value) {
+      fprintf(stderr, "Missing value for %s\n", arg);
+      return false;
+    } else if (strcmp(arg, "--scene") == 0) {
+      options->scene = value;
+      i++;
+    } else if (strcmp(arg, "--pipeline") == 0) {
+      if (!parsePipeline(value, &config.pipeline)) {
+        fprintf(stderr, "Unknown pipeline: %s\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--confirm") == 0) {
+      if (sscanf(value, "%d/%d", &config.confirmFrames, &config.confirmWindow) != 2) {
+        fprintf(stderr, "--confirm expects N/M\n");
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--smoothing") == 0) {
+      config.occupancySmoothing = atof(value);
+      i++;
+    } else if (strcmp(arg, "--fps") == 0) {
+      options->fps = max(1, atoi(value));
+      i++;
+    } else if (strcmp(arg, "--frames") == 0) {
+      options->maxFrames = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--data") == 0) {
+      options->dataDir = value;
+      i++;
+    } else if (strcmp(arg, "--prometheus") == 0) {
+      options->prometheus = value;
+      i++;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", arg);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Scene file: "zone" and "occupied" lines, '#' starts a comment
+ *   zone <id> <x> <y> <width> <height> <timeoutSec> [relayPin ...]
+ *   occupied <zoneId> <firstFrame> <lastFrame>
+ */
+static bool loadScene(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "ERROR: Cannot open scene %s\n", path);
+    return false;
+  }
+
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char* comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+
+    char keyword[16];
+    int offset = 0;
+    if (sscanf(line, "%15s%n", keyword, &offset) != 1) {
+      continue;   // Blank line
+    }
+    const char* args = line + offset;
+
+    if (strcmp(keyword, "zone") == 0) {
+      Zone zone;
+      memset(&zone, 0, sizeof(zone));
+      int consumed = 0;
+      if (sscanf(args, "%d %d %d %d %d %d%n", &zone.id, &zone.x, &zone.y,
+                 &zone.width, &zone.height, &zone.timeout, &consumed) != 6) {
+        ok = false;
+        break;
+      }
+      snprintf(zone.name, sizeof(zone.name), "Zone %d", zone.id);
+
+      // Optional relay pins
+      args += consumed;
+      int pin;
+      while (zone.numRelays < MAX_RELAYS_PER_ZONE && sscanf(args, "%d%n", &pin, &consumed) == 1) {
+        zone.relayPins[zone.numRelays++] = pin;
+        args += consumed;
+      }
+      config.zones.push_back(zone);
+    } else if (strcmp(keyword, "occupied") == 0) {
+      TruthSpan span;
+      ok = sscanf(args, "%d %d %d", &span.zoneId, &span.first, &span.last) == 3;
+      if (ok) {
+        truth.push_back(span);
+      }
+    } else {
+      ok = false;
+    }
+  }
+  fclose(file);
+
+  if (!ok) {
+    fprintf(stderr, "ERROR: %s:%d: cannot parse scene line\n", path, lineNumber);
+  }
+  return ok;
+}
+
+static bool isOccupied(int zoneId, int frame) {
+  for (size_t i = 0; i < truth.size(); i++) {
+    if (truth[i].zoneId == zoneId && frame >= truth[i].first && frame <= truth[i].last) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void scoreFrame(std::vector<ZoneScore>& scores, int frame) {
+  for (size_t i = 0; i < scores.size(); i++) {
+    ZoneScore& s = scores[i];
+    bool active = zoneManager.isZoneActive(s.zoneId);
+    bool occupied = isOccupied(s.zoneId, frame);
+
+    if (active && occupied) {
+      s.truePositive++;
+    } else if (active) {
+      s.falsePositive++;
+    } else if (occupied) {
+      s.falseNegative++;
+    } else {
+      s.trueNegative++;
+    }
+
+    if (active != s.wasActive) {
+      s.switches++;
+      s.wasActive = active;
+    }
+  }
+}
+
+/**
+ * Histogram bucket bound at or above the given quantile
+ */
+static double quantileMs(const LatencyHistogram& h, double q) {
+  uint32_t target = (uint32_t)ceil(q * h.count);
+  uint32_t cumulative = 0;
+  for (int b = 0; b < METRIC_BUCKETS; b++) {
+    cumulative += h.buckets[b];
+    if (cumulative >= target) {
+      return Metrics::getBucketBound(b) / 1000.0;
+    }
+  }
+  return INFINITY;
+}
+
+static void printStageReport() {
+  printf("\nStage latency (ms, p50/p95 are histogram bucket bounds)\n");
+  printf("  %-14s %8s %10s %8s %8s\n", "stage", "count", "mean", "p50<=", "p95<=");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    LatencyHistogram h = metrics.getHistogram((MetricStage)s);
+    if (h.count == 0) {
+      continue;
+    }
+    printf("  %-14s %8u %10.3f %8.2f %8.2f\n", Metrics::getStageName((MetricStage)s),
+           (unsigned)h.count, h.sumUs / 1000.0 / h.count, quantileMs(h, 0.5), quantileMs(h, 0.95));
+  }
+}
+
+static void printZoneReport(const std::vector<ZoneScore>& scores) {
+  printf("\nZone occupancy vs ground truth (frames)\n");
+  printf("  %-6s %6s %6s %6s %6s %9s %7s %8s\n", "zone", "TP", "FP", "FN", "TN",
+         "accuracy", "recall", "switches");
+  for (size_t i = 0; i < scores.size(); i++) {
+    const ZoneScore& s = scores[i];
+    int total = s.truePositive + s.falsePositive + s.falseNegative + s.trueNegative;
+    int occupied = s.truePositive + s.falseNegative;
+    printf("  %-6d %6d %6d %6d %6d %8.1f%% %6.1f%% %8d\n", s.zoneId, s.truePositive,
+           s.falsePositive, s.falseNegative, s.trueNegative,
+           total ? 100.0 * (s.truePositive + s.trueNegative) / total : 0.0,
+           occupied ? 100.0 * s.truePositive / occupied : 0.0, s.switches);
+  }
+}
+
+/**
+ * Prometheus export through the sketch's own writer
+ */
+class FilePrint : public Print {
+public:
+  FilePrint(FILE* f) { file = f; }
+  size_t write(uint8_t c) override { return fputc(c, file) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* data, size_t size) override { return fwrite(data, 1, size, file); }
+
+private:
+  FILE* file;
+};
+
+static void writePrometheus(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "ERROR: Cannot write %s\n", path);
+    return;
+  }
+  FilePrint out(file);
+  metrics.writePrometheus(out);
+  fclose(file);
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options = {nullptr, nullptr, "data", nullptr, BENCH_DEFAULT_FPS, 0, false};
+  setBenchConfig();
+  if (!parseArgs(argc, argv, &options)) {
+    printUsage();
+    return 2;
+  }
+  if (options.scene && !loadScene(options.scene)) {
+    return 2;
+  }
+  hostSerialEnabled = options.verbose;
+  LittleFS.setRoot(options.dataDir);
+
+  // setup() order: pool, stream, zones, motion, optional person model, pipeline
+  if (!framePool.begin()) {
+    fprintf(stderr, "ERROR: Frame pool allocation failed\n");
+    return 1;
+  }
+  mjpegStream.setFramePool(&framePool);
+  zoneManager.begin(&config);
+  motionDetector.begin(640, 480);
+  motionDetector.setSensitivity(BENCH_MOTION_SENSITIVITY);
+  if (LittleFS.exists("/model.tflite") && personDetector.begin("/model.tflite")) {
+    personBackend.begin(BENCH_PERSON_MAX_PIXELS);
+  }
+  detectionPipeline.begin(&motionBackend, &personBackend, &zoneManager);
+
+  // Queue the recording and connect now (no reconnects: end of file ends the replay)
+  mjpegStream.begin(options.capture);
+  mjpegStream.service();
+  if (!mjpegStream.isConnected()) {
+    fprintf(stderr, "ERROR: Cannot replay %s\n", options.capture);
+    return 1;
+  }
+
+  std::vector<ZoneScore> scores;
+  for (size_t i = 0; i < config.zones.size(); i++) {
+    ZoneScore s = {config.zones[i].id, 0, 0, 0, 0, 0, false};
+    scores.push_back(s);
+  }
+
+  // Replay loop (processTask + processFrame without the mailbox and web server);
+  // detections is reused like CameraChannel::detections
+  std::vector<Detection> detections;
+  detections.reserve(ZONE_MAX_DETECTIONS);
+  unsigned long frameInterval = 1000 / options.fps;
+  int frames = 0;
+  uint64_t steadyAllocations = 0;
+  uint64_t steadyBytes = 0;
+  int64_t replayStart = esp_timer_get_time();
+
+  while (mjpegStream.isConnected() && (options.maxFrames == 0 || frames < options.maxFrames)) {
+    HostAllocations before = hostAllocations;
+
+    FrameLease frame;
+    if (!mjpegStream.fetchFrame(&frame)) {
+      continue;
+    }
+    frames++;
+    hostAdvanceClock(frameInterval);
+
+    int64_t frameStart = esp_timer_get_time();
+    detections.clear();
+    detectionPipeline.process(frame, &config, detections);
+
+    int64_t zoneStart = esp_timer_get_time();
+    zoneManager.update(detections, ZONE_CANVAS_WIDTH, ZONE_CANVAS_HEIGHT);
+    metrics.record(STAGE_ZONE_UPDATE, zoneStart);
+    metrics.count(COUNTER_FRAMES_PROCESSED);
+    metrics.record(STAGE_FRAME_TOTAL, frameStart);
+
+    scoreFrame(scores, frames);
+
+    // First frame sizes the lazily grown buffers; count the rest
+    if (frames > 1) {
+      steadyAllocations += hostAllocations.count - before.count;
+      steadyBytes += hostAllocations.bytes - before.bytes;
+    }
+  }
+
+  double seconds = (esp_timer_get_time() - replayStart) / 1e6;
+  mjpegStream.disconnect();
+
+  printf("Replayed %s: %d frames (%d dropped) in %.2f s = %.1f frames/s\n", options.capture,
+         frames, mjpegStream.getDroppedFrames(), seconds, seconds > 0 ? frames / seconds : 0.0);
+  printf("Pipeline: %s, confirm %d/%d, person model %s\n",
+         PIPELINE_NAMES[config.pipeline], config.confirmFrames, config.confirmWindow,
+         personBackend.isReady() ? (config.roiInference ? "loaded (ROI)" : "loaded") : "not loaded (motion only)");
+  printf("Gate runs %lu, person runs %lu, person skips %lu\n",
+         (unsigned long)detectionPipeline.getGateRuns(), (unsigned long)detectionPipeline.getConfirmRuns(),
+         (unsigned long)detectionPipeline.getConfirmSkips());
+  if (frames > 1) {
+    printf("Allocations per frame (steady state): %.2f (%.0f bytes)\n",
+           (double)steadyAllocations / (frames - 1), (double)steadyBytes / (frames - 1));
+  }
+
+  printStageReport();
+  if (!scores.empty() && options.scene) {
+    printZoneReport(scores);
+  }
+  if (options.prometheus) {
+    writePrometheus(options.prometheus);
+  }
+  return frames > 0 ? 0 : 1;
+}
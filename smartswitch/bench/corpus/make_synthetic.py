@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Synthetic replay fixture
+
+Writes synthetic.mjpeg: 8 s of 320x240 grayscale MJPEG at 10 fps in the
+camera's /stream format (HTTP headers included, as `curl -i` records them).
+A dark figure paces inside the left half of a textured room, leaves, then
+paces inside the right half. synthetic.scene holds the zones and the frames
+the figure is in each one. Pure Python, no dependencies:
+
+    python3 bench/corpus/make_synthetic.py bench/corpus
+"""
+
+import math
+import os
+import sys
+
+WIDTH = 320
+HEIGHT = 240
+FRAMES = 80
+BOUNDARY = "123456789000000000000987654321"
+
+# Figure path: (first frame, last frame, left edge x from, x to); 1-based frames
+FIGURE_W = 40
+FIGURE_H = 100
+FIGURE_Y = 110
+PATH = [
+    (11, 35, 30, 110),     # Left half (zone 1)
+    (46, 70, 190, 270),    # Right half (zone 2)
+]
+
+# Standard luminance quantization table (JPEG Annex K), quality 75
+BASE_QUANT = [
+    16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+]
+QUANT = [max(1, min(255, (q * 50 + 50) // 100)) for q in BASE_QUANT]
+
+ZIGZAG = [
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+]
+
+# Standard luminance Huffman tables (JPEG Annex K.3)
+DC_BITS = [0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0]
+DC_VALUES = list(range(12))
+AC_BITS = [0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D]
+AC_VALUES = [
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+]
+
+COS = [[math.cos((2 * x + 1) * u * math.pi / 16) * (math.sqrt(0.5) if u == 0 else 1.0)
+        for x in range(8)] for u in range(8)]
+
+
+def huffman_codes(bits, values):
+    codes = {}
+    code = 0
+    k = 0
+    for length in range(1, 17):
+        for _ in range(bits[length - 1]):
+            codes[values[k]] = (code, length)
+            code += 1
+            k += 1
+        code <<= 1
+    return codes
+
+
+DC_CODES = huffman_codes(DC_BITS, DC_VALUES)
+AC_CODES = huffman_codes(AC_BITS, AC_VALUES)
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value, length):
+        self.acc = (self.acc << length) | (value & ((1 << length) - 1))
+        self.count += length
+        while self.count >= 8:
+            self.count -= 8
+            byte = (self.acc >> self.count) & 0xFF
+            self.out.append(byte)
+            if byte == 0xFF:
+                self.out.append(0x00)   # Byte stuffing
+        self.acc &= (1 << self.count) - 1
+
+    def flush(self):
+        if self.count:
+            self.write(0x7F, 8 - self.count)   # Pad with 1 bits
+        return bytes(self.out)
+
+
+def magnitude(value):
+    size = abs(value).bit_length()
+    return size, value if value >= 0 else value + (1 << size) - 1
+
+
+def quantized_block(pixels):
+    """Forward DCT + quantization of 64 pixels; returns zigzag coefficients"""
+    rows = [[sum(COS[u][x] * (pixels[y * 8 + x] - 128) for x in range(8)) / 2 for u in range(8)]
+            for y in range(8)]
+    coeffs = [0] * 64
+    for v in range(8):
+        for u in range(8):
+            value = sum(COS[v][y] * rows[y][u] for y in range(8)) / 2
+            coeffs[v * 8 + u] = int(round(value / QUANT[v * 8 + u]))
+    return [coeffs[z] for z in ZIGZAG]
+
+
+def encode_jpeg(image, cache):
+    writer = BitWriter()
+    previous_dc = 0
+    for by in range(0, HEIGHT, 8):
+        for bx in range(0, WIDTH, 8):
+            pixels = tuple(image[(by + y) * WIDTH + bx + x] for y in range(8) for x in range(8))
+            block = cache.get(pixels)
+            if block is None:
+                block = cache[pixels] = quantized_block(pixels)
+
+            size, bits = magnitude(block[0] - previous_dc)
+            previous_dc = block[0]
+            writer.write(*DC_CODES[size])
+            writer.write(bits, size)
+
+            run = 0
+            last = max((i for i in range(1, 64) if block[i]), default=0)
+            for i in range(1, last + 1):
+                if block[i] == 0:
+                    run += 1
+                    continue
+                while run > 15:
+                    writer.write(*AC_CODES[0xF0])
+                    run -= 16
+                size, bits = magnitude(block[i])
+                writer.write(*AC_CODES[(run << 4) | size])
+                writer.write(bits, size)
+                run = 0
+            if last < 63:
+                writer.write(*AC_CODES[0x00])   # End of block
+    scan = writer.flush()
+
+    header = bytearray(b"\xFF\xD8")
+    header += b"\xFF\xDB\x00\x43\x00" + bytes(QUANT[z] for z in ZIGZAG)
+    header += b"\xFF\xC0\x00\x0B\x08" + HEIGHT.to_bytes(2, "big") + WIDTH.to_bytes(2, "big") + b"\x01\x01\x11\x00"
+    for table_class, bits, values in ((0x00, DC_BITS, DC_VALUES), (0x10, AC_BITS, AC_VALUES)):
+        header += b"\xFF\xC4" + (3 + 16 + len(values)).to_bytes(2, "big") + bytes([table_class])
+        header += bytes(bits) + bytes(values)
+    header += b"\xFF\xDA\x00\x08\x01\x01\x00\x00\x3F\x00"
+    return bytes(header) + scan + b"\xFF\xD9"
+
+
+def figure_x(frame):
+    for first, last, x0, x1 in PATH:
+        if first <= frame <= last:
+            # Pace back and forth between x0 and x1, two passes per span
+            phase = (frame - first) / max(last - first, 1) * 2
+            t = phase % 1.0 if int(phase) % 2 == 0 else 1.0 - phase % 1.0
+            return int(x0 + (x1 - x0) * t)
+    return None
+
+
+def render(frame):
+    # Static room: wall and floor shades with a coarse texture
+    image = bytearray(WIDTH * HEIGHT)
+    for y in range(HEIGHT):
+        base = 170 if y < 150 else 110
+        for x in range(WIDTH):
+            image[y * WIDTH + x] = base + (12 if ((x // 32) + (y // 24)) % 2 else 0)
+
+    x = figure_x(frame)
+    if x is not None:
+        for y in range(FIGURE_Y, min(FIGURE_Y + FIGURE_H, HEIGHT)):
+            for px in range(x, min(x + FIGURE_W, WIDTH)):
+                image[y * WIDTH + px] = 30
+    return image
+
+
+def main():
+    folder = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    cache = {}
+
+    stream = bytearray()
+    stream += b"HTTP/1.1 200 OK\r\n"
+    stream += ("Content-Type: multipart/x-mixed-replace;boundary=%s\r\n" % BOUNDARY).encode()
+    stream += b"\r\n"
+    for frame in range(1, FRAMES + 1):
+        jpeg = encode_jpeg(render(frame), cache)
+        seconds, micros = divmod((frame - 1) * 100000, 1000000)
+        stream += ("\r\n--%s\r\n" % BOUNDARY).encode()
+        stream += ("Content-Type: image/jpeg\r\nContent-Length: %d\r\nX-Timestamp: %d.%06d\r\n\r\n"
+                   % (len(jpeg), seconds, micros)).encode()
+        stream += jpeg
+    with open(os.path.join(folder, "synthetic.mjpeg"), "wb") as f:
+        f.write(stream)
+
+    with open(os.path.join(folder, "synthetic.scene"), "w") as f:
+        f.write("# Generated by make_synthetic.py: %d frames of %dx%d at 10 fps\n" % (FRAMES, WIDTH, HEIGHT))
+        f.write("# zone <id> <x> <y> <width> <height> <timeoutSec> [relayPin ...]\n")
+        f.write("zone 1   0 0 320 480 1 4\n")
+        f.write("zone 2 320 0 320 480 1 5\n")
+        f.write("\n# occupied <zoneId> <firstFrame> <lastFrame>\n")
+        for zone, (first, last, _, _) in enumerate(PATH, 1):
+            f.write("occupied %d %d %d\n" % (zone, first, last))
+    print("synthetic.mjpeg: %d frames, %d bytes" % (FRAMES, len(stream)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,188 @@
+/**
+ * Host Arduino Shim
+ *
+ * Just enough of the ESP32 Arduino core to build the frame pipeline
+ * (MJPEG parser, decoder, detectors, zone manager, metrics) on Linux.
+ * - millis() is a virtual clock the replay advances per frame, so zone
+ *   timeouts and hysteresis behave as at the capture frame rate
+ * - micros() / esp_timer_get_time() are the real monotonic clock, so
+ *   stage latencies are host CPU time
+ * - malloc / calloc / realloc are counted, and with them operator new and
+ *   ps_malloc() (see hostAllocations)
+ * - Serial goes to stderr and can be muted
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define PI 3.1415926535897932384626433832795
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+
+/**
+ * Arduino String (std::string backed)
+ */
+class String {
+public:
+  String() {}
+  String(const char* text) : value(text ? text : "") {}
+  String(const std::string& text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int v) : value(std::to_string(v)) {}
+  String(unsigned int v) : value(std::to_string(v)) {}
+  String(long v) : value(std::to_string(v)) {}
+  String(unsigned long v) : value(std::to_string(v)) {}
+  String(double v) : value(std::to_string(v)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+  int indexOf(char c, unsigned int from = 0) const { return toIndex(value.find(c, from)); }
+  int indexOf(const char* text, unsigned int from = 0) const { return toIndex(value.find(text, from)); }
+  int indexOf(const String& text, unsigned int from = 0) const { return toIndex(value.find(text.value, from)); }
+  bool startsWith(const char* prefix) const { return value.compare(0, strlen(prefix), prefix) == 0; }
+  bool equalsIgnoreCase(const char* other) const { return strcasecmp(value.c_str(), other) == 0; }
+  String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < value.size() && to > from ? String(value.substr(from, to - from)) : String();
+  }
+  long toInt() const { return atol(value.c_str()); }
+  void trim();
+  void toLowerCase();
+
+  String& operator+=(const String& other) { value += other.value; return *this; }
+  String& operator+=(const char* other) { value += other; return *this; }
+  String& operator+=(char c) { value += c; return *this; }
+  bool operator==(const char* other) const { return value == other; }
+  bool operator!=(const char* other) const { return value != other; }
+  bool operator==(const String& other) const { return value == other.value; }
+  char operator[](unsigned int index) const { return index < value.size() ? value[index] : 0; }
+
+private:
+  std::string value;
+  static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+/**
+ * Print / Stream
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t size);
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v) { return printf("%.2f", v); }
+  size_t println() { return write("\n"); }
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual size_t readBytes(uint8_t* buffer, size_t length);
+  size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+  void setTimeout(unsigned long timeoutMs) { (void)timeoutMs; }
+};
+
+/**
+ * Serial (stderr, muted with hostSerialEnabled = false)
+ */
+class HostSerial : public Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  using Print::write;
+};
+
+extern HostSerial Serial;
+extern bool hostSerialEnabled;
+
+/**
+ * ESP object (nominal values, the host does not model the ESP32 heap)
+ */
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200 * 1024; }
+  uint32_t getMinFreeHeap() { return 200 * 1024; }
+  uint32_t getMaxAllocHeap() { return 100 * 1024; }
+  uint32_t getHeapSize() { return 320 * 1024; }
+  uint32_t getPsramSize() { return 8 * 1024 * 1024; }
+  uint32_t getFreePsram() { return 4 * 1024 * 1024; }
+  uint32_t getMinFreePsram() { return 4 * 1024 * 1024; }
+  uint32_t getMaxAllocPsram() { return 4 * 1024 * 1024; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  void restart();
+};
+
+extern EspClass ESP;
+
+// Time (millis = virtual replay clock, micros = real clock)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void hostAdvanceClock(unsigned long ms);
+
+// GPIO (relay pins are recorded, not driven)
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Memory (PSRAM is ordinary heap on the host)
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t count, size_t size);
+
+#define MALLOC_CAP_8BIT 1
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/**
+ * Allocation counters (every malloc / calloc / realloc, see host.cpp)
+ */
+struct HostAllocations {
+  uint64_t count;
+  uint64_t bytes;
+};
+
+extern HostAllocations hostAllocations;
+
+#endif // HOST_ARDUINO_H
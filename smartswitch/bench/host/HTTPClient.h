@@ -0,0 +1,45 @@
+/**
+ * Host HTTPClient Shim
+ *
+ * "URL" is the path of a recording. A recording made with `curl -i`
+ * starts with the HTTP status line and headers; a body-only recording
+ * is accepted too, its multipart boundary is taken from the first line.
+ * A recorded snapshot-polling session is simply the concatenated
+ * responses; requests the parser writes back are discarded.
+ */
+
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED -1
+
+class HTTPClient {
+public:
+  HTTPClient();
+
+  bool begin(WiFiClient& client, const String& url);
+  int GET();
+  void end();
+
+  String header(const char* name);
+  int getSize() { return size; }
+  WiFiClient* getStreamPtr() { return stream; }
+
+  void setTimeout(uint16_t timeoutMs) { (void)timeoutMs; }
+  void setConnectTimeout(int32_t timeoutMs) { (void)timeoutMs; }
+  void collectHeaders(const char* headerKeys[], size_t count) { (void)headerKeys; (void)count; }
+  void setReuse(bool reuse) { (void)reuse; }
+
+private:
+  WiFiClient* stream;
+  String path;
+  String contentType;
+  String connection;
+  int size;       // Content-Length of the first response (-1 = unknown)
+};
+
+#endif // HOST_HTTPCLIENT_H
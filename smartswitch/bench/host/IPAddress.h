@@ -0,0 +1,22 @@
+/**
+ * Host IPAddress Shim
+ *
+ * Recordings are addressed by file path, so an "address" is just the
+ * host part of the URL carried through unchanged.
+ */
+
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  bool fromString(const String& address) { text = address; return true; }
+  String toString() const { return text; }
+
+private:
+  String text;
+};
+
+#endif // HOST_IPADDRESS_H
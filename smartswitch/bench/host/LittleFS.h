@@ -0,0 +1,45 @@
+/**
+ * Host LittleFS Shim
+ *
+ * Read-only view of a host directory (the sketch's data/ folder by
+ * default), used to load /model.tflite.
+ */
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <Arduino.h>
+
+class File {
+public:
+  File() { file = nullptr; }
+  File(FILE* f) { file = f; }
+
+  operator bool() const { return file != nullptr; }
+  size_t size();
+  size_t read(uint8_t* buffer, size_t length) { return file ? fread(buffer, 1, length, file) : 0; }
+  void close();
+
+private:
+  FILE* file;
+};
+
+class HostFS {
+public:
+  HostFS();
+
+  // Directory that stands in for the flash filesystem root
+  void setRoot(const char* dir) { root = dir; }
+
+  bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+  bool exists(const char* path);
+  File open(const char* path, const char* mode = "r");
+
+private:
+  String root;
+  String resolve(const char* path) { return root + path; }
+};
+
+extern HostFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
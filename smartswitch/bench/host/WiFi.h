@@ -0,0 +1,39 @@
+/**
+ * Host WiFi Shim
+ *
+ * The replay never associates; the station always reports disconnected.
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1
+} wifi_mode_t;
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { (void)m; return true; }
+  void begin(const char* ssid, const char* password) { (void)ssid; (void)password; }
+  wl_status_t status() { return WL_DISCONNECTED; }
+  IPAddress localIP() { return IPAddress(); }
+  int8_t RSSI() { return 0; }
+  int hostByName(const char* host, IPAddress& address) { return address.fromString(host); }
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
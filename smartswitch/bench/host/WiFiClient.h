@@ -0,0 +1,43 @@
+/**
+ * Host WiFiClient Shim
+ *
+ * Plays a recorded stream file back as a socket. Reads are handed out
+ * in TCP-segment-sized pieces so the MJPEG parser sees the same partial
+ * reads it gets from lwIP on the device.
+ */
+
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include <Arduino.h>
+
+#define HOST_SEGMENT_SIZE 1436    // Typical Wi-Fi TCP payload per read
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient();
+  ~WiFiClient();
+
+  // Open a recording (returns false if the file cannot be read)
+  bool open(const char* path);
+
+  // Read one header line of the recording (without CR/LF)
+  bool readLine(String* line);
+
+  // Stream
+  int available() override;
+  int read() override;
+  size_t readBytes(uint8_t* buffer, size_t length) override;
+  size_t write(uint8_t c) override { (void)c; return 1; }
+  using Print::write;
+
+  uint8_t connected();
+  void stop();
+  int fd() { return -1; }   // No socket to select() on; the parser falls back to delay(1)
+
+private:
+  FILE* file;
+  long remaining;
+};
+
+#endif // HOST_WIFICLIENT_H
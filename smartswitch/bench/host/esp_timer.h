@@ -0,0 +1,13 @@
+/**
+ * Host esp_timer Shim
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds on the host monotonic clock
+int64_t esp_timer_get_time();
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,19 @@
+/**
+ * Host FreeRTOS Semaphore Shim
+ *
+ * Single-threaded like the rest of the replay: mutexes are never contended.
+ */
+
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define xSemaphoreCreateMutex() ((SemaphoreHandle_t)1)
+#define xSemaphoreTake(sem, ticks) ((void)(sem), (void)(ticks), pdTRUE)
+#define xSemaphoreGive(sem) ((void)(sem), pdTRUE)
+
+#endif // HOST_SEMPHR_H
@@ -0,0 +1,404 @@
+/**
+ * Host Shim Implementation
+ */
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <time.h>
+#include <new>
+
+HostSerial Serial;
+EspClass ESP;
+HostFS LittleFS;
+WiFiClass WiFi;
+bool hostSerialEnabled = true;
+HostAllocations hostAllocations = {0, 0};
+
+static unsigned long virtualMillis = 0;
+
+// ---------------------------------------------------------------------------
+// Allocation counting: the build links with -Wl,--wrap=malloc,--wrap=calloc,
+// --wrap=realloc, so every heap call of the pipeline sources (operator new
+// and ps_malloc included, both go through malloc) lands here
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  hostAllocations.count++;
+  hostAllocations.bytes += size;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  hostAllocations.count++;
+  hostAllocations.bytes += count * size;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+  hostAllocations.count++;
+  hostAllocations.bytes += size;
+  return __real_realloc(p, size);
+}
+}
+
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t size) noexcept {
+  (void)size;
+  free(p);
+}
+
+void operator delete[](void* p, size_t size) noexcept {
+  (void)size;
+  free(p);
+}
+
+bool psramFound() {
+  return true;
+}
+
+void* ps_malloc(size_t size) {
+  return malloc(size);
+}
+
+void* ps_calloc(size_t count, size_t size) {
+  return calloc(count, size);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  (void)caps;
+  return ESP.getMaxAllocHeap();
+}
+
+// ---------------------------------------------------------------------------
+// Time
+
+int64_t esp_timer_get_time() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned long millis() {
+  return virtualMillis;
+}
+
+unsigned long micros() {
+  return (unsigned long)esp_timer_get_time();
+}
+
+void delay(unsigned long ms) {
+  virtualMillis += ms;
+}
+
+void yield() {
+}
+
+void hostAdvanceClock(unsigned long ms) {
+  virtualMillis += ms;
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart() called\n");
+  exit(1);
+}
+
+// ---------------------------------------------------------------------------
+// GPIO
+
+static uint8_t pinLevels[64];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < sizeof(pinLevels)) {
+    pinLevels[pin] = value;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+// ---------------------------------------------------------------------------
+// String / Print / Stream
+
+void String::trim() {
+  size_t start = value.find_first_not_of(" \t\r\n");
+  size_t end = value.find_last_not_of(" \t\r\n");
+  value = start == std::string::npos ? std::string() : value.substr(start, end - start + 1);
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < value.size(); i++) {
+    value[i] = tolower((unsigned char)value[i]);
+  }
+}
+
+size_t Print::write(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  while (n < size && write(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len < sizeof(stackBuffer)) {
+    return write((const uint8_t*)stackBuffer, len);
+  }
+
+  // Long lines (Prometheus export) are formatted into a heap buffer
+  char* buffer = (char*)malloc(len + 1);
+  if (!buffer) {
+    return 0;
+  }
+  va_start(args, format);
+  vsnprintf(buffer, len + 1, format, args);
+  va_end(args);
+  size_t written = write((const uint8_t*)buffer, len);
+  free(buffer);
+  return written;
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = read();
+    if (c < 0) {
+      break;
+    }
+    buffer[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
+size_t HostSerial::write(uint8_t c) {
+  if (hostSerialEnabled) {
+    fputc(c, stderr);
+  }
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t* data, size_t size) {
+  if (hostSerialEnabled) {
+    fwrite(data, 1, size, stderr);
+  }
+  return size;
+}
+
+// ---------------------------------------------------------------------------
+// WiFiClient (recording playback)
+
+WiFiClient::WiFiClient() {
+  file = nullptr;
+  remaining = 0;
+}
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+bool WiFiClient::open(const char* path) {
+  stop();
+  file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  remaining = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  return true;
+}
+
+bool WiFiClient::readLine(String* line) {
+  *line = "";
+  int c;
+  while ((c = read()) >= 0) {
+    if (c == '\n') {
+      line->trim();
+      return true;
+    }
+    *line += (char)c;
+  }
+  return false;
+}
+
+int WiFiClient::available() {
+  return (int)min(remaining, (long)HOST_SEGMENT_SIZE);
+}
+
+int WiFiClient::read() {
+  if (!file || remaining <= 0) {
+    return -1;
+  }
+  remaining--;
+  return fgetc(file);
+}
+
+size_t WiFiClient::readBytes(uint8_t* buffer, size_t length) {
+  if (!file || remaining <= 0) {
+    return 0;
+  }
+  size_t n = fread(buffer, 1, min((long)length, remaining), file);
+  remaining -= n;
+  return n;
+}
+
+uint8_t WiFiClient::connected() {
+  return file && remaining > 0;
+}
+
+void WiFiClient::stop() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+  remaining = 0;
+}
+
+// ---------------------------------------------------------------------------
+// HTTPClient
+
+HTTPClient::HTTPClient() {
+  stream = nullptr;
+  size = -1;
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+  stream = &client;
+  path = url;
+  return true;
+}
+
+int HTTPClient::GET() {
+  if (!stream || !stream->open(path.c_str())) {
+    Serial.printf("ERROR: Cannot open recording %s\n", path.c_str());
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  contentType = "";
+  connection = "";
+  size = -1;
+  
+  // First non-empty line (ESP32-CAM parts start with CRLF before the boundary)
+  String line;
+  do {
+    if (!stream->readLine(&line)) {
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+  } while (line.length() == 0);
+
+  // Body-only recording: the first line is the boundary, replay from the start
+  if (!line.startsWith("HTTP/")) {
+    contentType = line.startsWith("--") ? "multipart/x-mixed-replace;boundary=" + line.substring(2) : String("image/jpeg");
+    stream->open(path.c_str());
+    return HTTP_CODE_OK;
+  }
+
+  int code = line.substring(line.indexOf(' ') + 1).toInt();
+  while (stream->readLine(&line) && line.length() > 0) {
+    int colon = line.indexOf(':');
+    if (colon <= 0) {
+      continue;
+    }
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Content-Type")) {
+      contentType = value;
+    } else if (name.equalsIgnoreCase("Connection")) {
+      connection = value;
+    } else if (name.equalsIgnoreCase("Content-Length")) {
+      size = value.toInt();
+    }
+  }
+  return code;
+}
+
+void HTTPClient::end() {
+  stream = nullptr;
+}
+
+String HTTPClient::header(const char* name) {
+  if (strcasecmp(name, "Content-Type") == 0) {
+    return contentType;
+  }
+  return strcasecmp(name, "Connection") == 0 ? connection : String();
+}
+
+// ---------------------------------------------------------------------------
+// LittleFS (host directory)
+
+size_t File::size() {
+  if (!file) {
+    return 0;
+  }
+  long pos = ftell(file);
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, pos, SEEK_SET);
+  return size;
+}
+
+void File::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+HostFS::HostFS() {
+  root = "data";
+}
+
+bool HostFS::exists(const char* path) {
+  FILE* f = fopen(resolve(path).c_str(), "rb");
+  if (f) {
+    fclose(f);
+  }
+  return f != nullptr;
+}
+
+File HostFS::open(const char* path, const char* mode) {
+  if (strcmp(mode, "r") != 0) {
+    return File();   // Read-only
+  }
+  return File(fopen(resolve(path).c_str(), "rb"));
+}
@@ -0,0 +1,11 @@
+/**
+ * Host lwIP Shim (BSD sockets)
+ */
+
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#endif // HOST_LWIP_SOCKETS_H
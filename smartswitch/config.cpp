@@ -1,7 +1,12 @@
 /**
  * Configuration Manager Implementation
  * 
- * Handles SPIFFS storage, JSON parsing, and WiFi setup.
+ * Handles SPIFFS storage, JSON import/export, and WiFi setup.
+ * Settings and zones persist as one CRC-checked binary snapshot that is
+ * written to a temp file and renamed over the old one, so boot reads
+ * straight into the structs and a power cut mid-save never leaves a torn
+ * file. config.json/zones.json are only imported when there is no valid
+ * snapshot (first boot, fresh filesystem upload, new snapshot version).
  */
 
 #include "config.h"
@@ -12,11 +17,233 @@
 // File paths
 #define CONFIG_FILE "/config.json"
 #define ZONES_FILE "/zones.json"
+#define SNAPSHOT_FILE "/config.bin"
+#define SNAPSHOT_TEMP_FILE "/config.tmp"
+
+#define SNAPSHOT_MAGIC 0x43535A53   // "SZSC"
+#define SNAPSHOT_VERSION 1          // Bump when SnapshotSettings or Zone change
+
+#define CONFIG_JSON_SIZE (1024 + MAX_CAMERAS * 128)
+
+/**
+ * Snapshot file: header, settings record, then zoneCount Zone records.
+ * The CRC covers everything after the header; the record sizes catch a
+ * layout change without a version bump.
+ */
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t zoneCount;
+  uint16_t settingsSize;
+  uint16_t zoneSize;
+  uint32_t crc;
+};
+
+/**
+ * Config without the zone list, in fixed-size fields
+ */
+struct SnapshotSettings {
+  char wifiSSID[MAX_SSID_LENGTH];
+  char wifiPassword[MAX_PASSWORD_LENGTH];
+  CameraSource cameras[MAX_CAMERAS];
+  int32_t numCameras;
+  float detectionThreshold;
+  int32_t globalTimeout;
+  int32_t confirmFrames;
+  int32_t confirmWindow;
+  float occupancySmoothing;
+  int32_t pipeline;
+  int32_t watchdogTimeout;
+  uint8_t roiInference;
+  uint8_t relayActiveHigh;
+  uint8_t enableWatchdog;
+  uint8_t autoRelayControl;
+  uint8_t powerSave;
+};
 
 /**
- * Load configuration from SPIFFS
+ * CRC-32 (IEEE), chainable: crc32Update(crc32Update(0, a), b) covers a then b
+ */
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static void toSnapshot(const Config* config, SnapshotSettings* settings) {
+  memset(settings, 0, sizeof(SnapshotSettings));  // Deterministic padding for the CRC
+  memcpy(settings->wifiSSID, config->wifiSSID, sizeof(settings->wifiSSID));
+  memcpy(settings->wifiPassword, config->wifiPassword, sizeof(settings->wifiPassword));
+  memcpy(settings->cameras, config->cameras, sizeof(settings->cameras));
+  settings->numCameras = config->numCameras;
+  settings->detectionThreshold = config->detectionThreshold;
+  settings->globalTimeout = config->globalTimeout;
+  settings->confirmFrames = config->confirmFrames;
+  settings->confirmWindow = config->confirmWindow;
+  settings->occupancySmoothing = config->occupancySmoothing;
+  settings->pipeline = config->pipeline;
+  settings->watchdogTimeout = config->watchdogTimeout;
+  settings->roiInference = config->roiInference;
+  settings->relayActiveHigh = config->relayActiveHigh;
+  settings->enableWatchdog = config->enableWatchdog;
+  settings->autoRelayControl = config->autoRelayControl;
+  settings->powerSave = config->powerSave;
+}
+
+static void fromSnapshot(const SnapshotSettings* settings, Config* config) {
+  strlcpy(config->wifiSSID, settings->wifiSSID, MAX_SSID_LENGTH);
+  strlcpy(config->wifiPassword, settings->wifiPassword, MAX_PASSWORD_LENGTH);
+  memcpy(config->cameras, settings->cameras, sizeof(config->cameras));
+  config->numCameras = settings->numCameras;
+  config->detectionThreshold = settings->detectionThreshold;
+  config->globalTimeout = settings->globalTimeout;
+  config->confirmFrames = settings->confirmFrames;
+  config->confirmWindow = settings->confirmWindow;
+  config->occupancySmoothing = settings->occupancySmoothing;
+  config->pipeline = (DetectorPipeline)settings->pipeline;
+  config->watchdogTimeout = settings->watchdogTimeout;
+  config->roiInference = settings->roiInference;
+  config->relayActiveHigh = settings->relayActiveHigh;
+  config->enableWatchdog = settings->enableWatchdog;
+  config->autoRelayControl = settings->autoRelayControl;
+  config->powerSave = settings->powerSave;
+}
+
+/**
+ * Read one camera entry (missing fields get the single-camera defaults)
+ */
+static void loadCamera(CameraSource* camera, JsonObject obj) {
+  strlcpy(camera->ip, obj["ip"] | "192.168.4.100", MAX_IP_LENGTH);
+  camera->port = obj["port"] | 81;
+  strlcpy(camera->path, obj["path"] | "/stream", 64);
+  camera->weight = constrain(obj["weight"] | 1, 1, CAMERA_MAX_WEIGHT);
+}
+
+/**
+ * Load configuration from SPIFFS (snapshot, else JSON import)
  */
 bool loadConfigFromSPIFFS(Config* config) {
+  if (loadConfigSnapshot(config)) {
+    return true;
+  }
+  
+  // No usable snapshot: import the JSON files and keep them as a snapshot
+  if (!importConfigFromJSON(config)) {
+    return false;
+  }
+  saveConfigSnapshot(config);
+  return true;
+}
+
+/**
+ * Save configuration to SPIFFS (binary snapshot only)
+ */
+bool saveConfigToSPIFFS(const Config* config) {
+  return saveConfigSnapshot(config);
+}
+
+/**
+ * Load the binary snapshot; config is left untouched unless it is complete and valid
+ */
+bool loadConfigSnapshot(Config* config) {
+  if (!LittleFS.exists(SNAPSHOT_FILE)) {
+    return false;
+  }
+  
+  File file = LittleFS.open(SNAPSHOT_FILE, "r");
+  if (!file) {
+    Serial.println("ERROR: Failed to open config snapshot");
+    return false;
+  }
+  
+  int64_t start = esp_timer_get_time();
+  SnapshotHeader header;
+  SnapshotSettings settings;
+  std::vector<Zone> zones;
+  bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == SNAPSHOT_MAGIC && header.version == SNAPSHOT_VERSION &&
+            header.settingsSize == sizeof(SnapshotSettings) && header.zoneSize == sizeof(Zone) &&
+            header.zoneCount <= MAX_ZONES &&
+            file.read((uint8_t*)&settings, sizeof(settings)) == sizeof(settings);
+  size_t zoneBytes = ok ? header.zoneCount * sizeof(Zone) : 0;
+  if (ok && zoneBytes > 0) {
+    zones.resize(header.zoneCount);
+    ok = file.read((uint8_t*)zones.data(), zoneBytes) == zoneBytes;
+  }
+  file.close();
+  
+  ok = ok && crc32Update(crc32Update(0, (const uint8_t*)&settings, sizeof(settings)),
+                         (const uint8_t*)zones.data(), zoneBytes) == header.crc &&
+       settings.numCameras >= 1 && settings.numCameras <= MAX_CAMERAS;
+  if (!ok) {
+    Serial.println("⚠ Config snapshot invalid or from another firmware version - ignoring it");
+    return false;
+  }
+  
+  fromSnapshot(&settings, config);
+  config->zones.swap(zones);
+  Serial.printf("✓ Configuration loaded from snapshot (%d zones, %lu us)\n",
+                config->zones.size(), (unsigned long)(esp_timer_get_time() - start));
+  return true;
+}
+
+/**
+ * Write the binary snapshot to a temp file, then rename it over the old one
+ * (a power cut leaves either the previous or the new snapshot)
+ */
+bool saveConfigSnapshot(const Config* config) {
+  SnapshotSettings settings;
+  toSnapshot(config, &settings);
+  size_t zoneCount = min(config->zones.size(), (size_t)MAX_ZONES);
+  size_t zoneBytes = zoneCount * sizeof(Zone);
+  const uint8_t* zoneData = (const uint8_t*)config->zones.data();
+  
+  SnapshotHeader header;
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.zoneCount = zoneCount;
+  header.settingsSize = sizeof(SnapshotSettings);
+  header.zoneSize = sizeof(Zone);
+  header.crc = crc32Update(crc32Update(0, (const uint8_t*)&settings, sizeof(settings)), zoneData, zoneBytes);
+  
+  File file = LittleFS.open(SNAPSHOT_TEMP_FILE, "w");
+  if (!file) {
+    Serial.println("ERROR: Failed to open config snapshot for writing");
+    return false;
+  }
+  
+  size_t expected = sizeof(header) + sizeof(settings) + zoneBytes;
+  size_t written = file.write((const uint8_t*)&header, sizeof(header));
+  written += file.write((const uint8_t*)&settings, sizeof(settings));
+  if (zoneBytes > 0) {
+    written += file.write(zoneData, zoneBytes);
+  }
+  file.close();
+  
+  if (written != expected) {
+    Serial.println("ERROR: Failed to write config snapshot");
+    LittleFS.remove(SNAPSHOT_TEMP_FILE);
+    return false;
+  }
+  
+  if (!LittleFS.rename(SNAPSHOT_TEMP_FILE, SNAPSHOT_FILE)) {
+    Serial.println("ERROR: Failed to replace config snapshot");
+    return false;
+  }
+  
+  Serial.printf("✓ Configuration saved (%d zones, %d bytes)\n", zoneCount, expected);
+  return true;
+}
+
+/**
+ * Import configuration and zones from the JSON files
+ */
+bool importConfigFromJSON(Config* config) {
   if (!LittleFS.exists(CONFIG_FILE)) {
     Serial.println("Config file not found, using defaults");
     return false;
@@ -29,7 +256,7 @@ bool loadConfigFromSPIFFS(Config* config) {
   }
   
   // Parse JSON
-  StaticJsonDocument<1024> doc;
+  StaticJsonDocument<CONFIG_JSON_SIZE> doc;
   DeserializationError error = deserializeJson(doc, file);
   file.close();
   
@@ -42,52 +269,83 @@ bool loadConfigFromSPIFFS(Config* config) {
   strlcpy(config->wifiSSID, doc["wifi"]["ssid"] | "ESP32_SmartSwitch", MAX_SSID_LENGTH);
   strlcpy(config->wifiPassword, doc["wifi"]["password"] | "", MAX_PASSWORD_LENGTH);
   
-  // Load MJPEG stream settings
-  strlcpy(config->cctvIP, doc["cctv"]["ip"] | "192.168.4.100", MAX_IP_LENGTH);
-  config->cctvPort = doc["cctv"]["port"] | 81;
-  strlcpy(config->streamPath, doc["cctv"]["path"] | "/stream", 64);
+  // Load MJPEG stream settings ("cameras" array, or the single "cctv" camera)
+  JsonArray camerasArray = doc["cameras"].as<JsonArray>();
+  config->numCameras = 0;
+  if (camerasArray.isNull()) {
+    loadCamera(&config->cameras[config->numCameras++], doc["cctv"].as<JsonObject>());
+  } else {
+    for (JsonObject cameraObj : camerasArray) {
+      if (config->numCameras >= MAX_CAMERAS) {
+        Serial.printf("⚠ Config has more than %d cameras, ignoring the rest\n", MAX_CAMERAS);
+        break;
+      }
+      loadCamera(&config->cameras[config->numCameras++], cameraObj);
+    }
+    if (config->numCameras == 0) {
+      loadCamera(&config->cameras[config->numCameras++], JsonObject());
+    }
+  }
   
   // Load detection settings
   config->detectionThreshold = doc["detection"]["threshold"] | 0.5;
   config->globalTimeout = doc["detection"]["globalTimeout"] | 5;
+  config->confirmFrames = doc["detection"]["confirmFrames"] | 2;
+  config->confirmWindow = doc["detection"]["confirmWindow"] | 3;
+  config->occupancySmoothing = doc["detection"]["occupancySmoothing"] | 0.3;
+  config->pipeline = pipelineFromString(doc["detection"]["pipeline"] | "cascade");
+  config->roiInference = doc["detection"]["roiInference"] | true;
   
   // Load system settings
   config->relayActiveHigh = doc["system"]["relayActiveHigh"] | true;
   config->enableWatchdog = doc["system"]["enableWatchdog"] | true;
   config->watchdogTimeout = doc["system"]["watchdogTimeout"] | 60;
   config->autoRelayControl = doc["system"]["autoRelayControl"] | true;
+  config->powerSave = doc["system"]["powerSave"] | true;
   
-  Serial.println("✓ Configuration loaded from SPIFFS");
+  Serial.println("✓ Configuration imported from JSON");
   
   // Load zones
   return loadZonesFromJSON(config, ZONES_FILE);
 }
 
 /**
- * Save configuration to SPIFFS
+ * Export configuration and zones to the JSON files (same format as the import)
  */
-bool saveConfigToSPIFFS(const Config* config) {
+bool exportConfigToJSON(const Config* config) {
   // Create JSON document
-  StaticJsonDocument<1024> doc;
+  StaticJsonDocument<CONFIG_JSON_SIZE> doc;
   
   // WiFi settings
   doc["wifi"]["ssid"] = config->wifiSSID;
   doc["wifi"]["password"] = config->wifiPassword;
   
   // MJPEG stream settings
-  doc["cctv"]["ip"] = config->cctvIP;
-  doc["cctv"]["port"] = config->cctvPort;
-  doc["cctv"]["path"] = config->streamPath;
+  JsonArray camerasArray = doc.createNestedArray("cameras");
+  for (int i = 0; i < config->numCameras; i++) {
+    const CameraSource& camera = config->cameras[i];
+    JsonObject cameraObj = camerasArray.createNestedObject();
+    cameraObj["ip"] = camera.ip;
+    cameraObj["port"] = camera.port;
+    cameraObj["path"] = camera.path;
+    cameraObj["weight"] = camera.weight;
+  }
   
   // Detection settings
   doc["detection"]["threshold"] = config->detectionThreshold;
   doc["detection"]["globalTimeout"] = config->globalTimeout;
+  doc["detection"]["confirmFrames"] = config->confirmFrames;
+  doc["detection"]["confirmWindow"] = config->confirmWindow;
+  doc["detection"]["occupancySmoothing"] = config->occupancySmoothing;
+  doc["detection"]["pipeline"] = pipelineToString(config->pipeline);
+  doc["detection"]["roiInference"] = config->roiInference;
   
   // System settings
   doc["system"]["relayActiveHigh"] = config->relayActiveHigh;
   doc["system"]["enableWatchdog"] = config->enableWatchdog;
   doc["system"]["watchdogTimeout"] = config->watchdogTimeout;
   doc["system"]["autoRelayControl"] = config->autoRelayControl;
+  doc["system"]["powerSave"] = config->powerSave;
   
   // Write to file
   File file = LittleFS.open(CONFIG_FILE, "w");
@@ -103,7 +361,7 @@ bool saveConfigToSPIFFS(const Config* config) {
   }
   
   file.close();
-  Serial.println("✓ Configuration saved to SPIFFS");
+  Serial.println("✓ Configuration exported to JSON");
   
   // Save zones
   return saveZonesToJSON(config, ZONES_FILE);
@@ -125,7 +383,7 @@ bool loadZonesFromJSON(Config* config, const char* jsonPath) {
   }
   
   // Parse JSON
-  DynamicJsonDocument doc(4096);
+  DynamicJsonDocument doc(MAX_ZONES * ZONE_JSON_SIZE);
   DeserializationError error = deserializeJson(doc, file);
   file.close();
   
@@ -140,6 +398,11 @@ bool loadZonesFromJSON(Config* config, const char* jsonPath) {
   // Load zones array
   JsonArray zonesArray = doc["zones"].as<JsonArray>();
   for (JsonObject zoneObj : zonesArray) {
+    if (config->zones.size() >= MAX_ZONES) {
+      Serial.printf("⚠ Zones file has more than %d zones, ignoring the rest\n", MAX_ZONES);
+      break;
+    }
+    
     Zone zone;
     zone.id = zoneObj["id"] | 0;
     strlcpy(zone.name, zoneObj["name"] | "Unnamed", 32);
@@ -148,8 +411,7 @@ bool loadZonesFromJSON(Config* config, const char* jsonPath) {
     zone.width = zoneObj["width"] | 100;
     zone.height = zoneObj["height"] | 100;
     zone.timeout = zoneObj["timeout"] | config->globalTimeout;
-    zone.active = false;
-    zone.lastDetectionTime = 0;
+    zone.camera = constrain(zoneObj["camera"] | 0, 0, MAX_CAMERAS - 1);
     
     // Load relay pins
     JsonArray relaysArray = zoneObj["relayPins"].as<JsonArray>();
@@ -172,7 +434,7 @@ bool loadZonesFromJSON(Config* config, const char* jsonPath) {
  */
 bool saveZonesToJSON(const Config* config, const char* jsonPath) {
   // Create JSON document
-  DynamicJsonDocument doc(4096);
+  DynamicJsonDocument doc(MAX_ZONES * ZONE_JSON_SIZE);
   
   // Create zones array
   JsonArray zonesArray = doc.createNestedArray("zones");
@@ -186,6 +448,7 @@ bool saveZonesToJSON(const Config* config, const char* jsonPath) {
     zoneObj["width"] = zone.width;
     zoneObj["height"] = zone.height;
     zoneObj["timeout"] = zone.timeout;
+    zoneObj["camera"] = zone.camera;
     
     JsonArray relaysArray = zoneObj.createNestedArray("relayPins");
     for (int i = 0; i < zone.numRelays; i++) {
@@ -220,19 +483,27 @@ void setDefaultConfig(Config* config) {
   strlcpy(config->wifiPassword, "123456789@E", MAX_PASSWORD_LENGTH);
   
   // MJPEG stream defaults (ESP32-CAM or IP camera)
-  strlcpy(config->cctvIP, "192.168.137.206", MAX_IP_LENGTH);
-  config->cctvPort = 8080;
-  strlcpy(config->streamPath, "", 64);  // Empty for most IP cameras on port 8080
+  config->numCameras = 1;
+  strlcpy(config->cameras[0].ip, "192.168.137.206", MAX_IP_LENGTH);
+  config->cameras[0].port = 8080;
+  strlcpy(config->cameras[0].path, "", 64);  // Empty for most IP cameras on port 8080
+  config->cameras[0].weight = 1;
   
   // Detection defaults
   config->detectionThreshold = 0.5;
   config->globalTimeout = 5;
+  config->confirmFrames = 2;
+  config->confirmWindow = 3;
+  config->occupancySmoothing = 0.3;
+  config->pipeline = PIPELINE_CASCADE;  // Falls back to motion until a model is uploaded
+  config->roiInference = true;
   
   // System defaults
   config->relayActiveHigh = true;  // GPIOs will be HIGH when person detected
   config->enableWatchdog = true;
   config->watchdogTimeout = 60;
   config->autoRelayControl = true;  // Enable automatic relay control on motion
+  config->powerSave = true;
   
   // Clear zones
   config->zones.clear();
@@ -248,8 +519,7 @@ void setDefaultConfig(Config* config) {
   zone1.relayPins[0] = 12;
   zone1.numRelays = 1;
   zone1.timeout = 5;
-  zone1.active = false;
-  zone1.lastDetectionTime = 0;
+  zone1.camera = 0;
   
   Zone zone2;
   zone2.id = 2;
@@ -261,8 +531,7 @@ void setDefaultConfig(Config* config) {
   zone2.relayPins[0] = 13;
   zone2.numRelays = 1;
   zone2.timeout = 5;
-  zone2.active = false;
-  zone2.lastDetectionTime = 0;
+  zone2.camera = 0;
   
   config->zones.push_back(zone1);
   config->zones.push_back(zone2);
@@ -276,17 +545,24 @@ void setDefaultConfig(Config* config) {
 void printConfig(const Config* config) {
   Serial.println("\n=== Configuration ===");
   Serial.printf("WiFi SSID: %s\n", config->wifiSSID);
-  Serial.printf("CCTV IP: %s:%d%s\n", config->cctvIP, config->cctvPort, config->streamPath);
+  for (int i = 0; i < config->numCameras; i++) {
+    const CameraSource& camera = config->cameras[i];
+    Serial.printf("Camera %d: %s:%d%s (weight %d)\n", i + 1, camera.ip, camera.port, camera.path, camera.weight);
+  }
   Serial.printf("Detection Threshold: %.2f\n", config->detectionThreshold);
   Serial.printf("Global Timeout: %d seconds\n", config->globalTimeout);
+  Serial.printf("Zone Confirmation: %d of %d frames (smoothing %.2f)\n",
+                config->confirmFrames, config->confirmWindow, config->occupancySmoothing);
+  Serial.printf("Detector Pipeline: %s%s\n", pipelineToString(config->pipeline),
+                config->roiInference ? " (zone crops)" : "");
   Serial.printf("Relay Active High: %s\n", config->relayActiveHigh ? "Yes" : "No");
   Serial.printf("Watchdog Enabled: %s\n", config->enableWatchdog ? "Yes" : "No");
   Serial.printf("Zones: %d\n", config->zones.size());
   
   for (size_t i = 0; i < config->zones.size(); i++) {
     const Zone& zone = config->zones[i];
-    Serial.printf("  Zone %d: %s [%d,%d,%dx%d] Relays:", 
-                 zone.id, zone.name, zone.x, zone.y, zone.width, zone.height);
+    Serial.printf("  Zone %d: %s [camera %d, %d,%d,%dx%d] Relays:", 
+                 zone.id, zone.name, zone.camera + 1, zone.x, zone.y, zone.width, zone.height);
     for (int j = 0; j < zone.numRelays; j++) {
       Serial.printf(" %d", zone.relayPins[j]);
     }
@@ -295,6 +571,31 @@ void printConfig(const Config* config) {
   Serial.println("====================\n");
 }
 
+/**
+ * Detector pipeline names used in config.json and the web API
+ */
+const char* pipelineToString(DetectorPipeline pipeline) {
+  switch (pipeline) {
+    case PIPELINE_MOTION: return "motion";
+    case PIPELINE_PERSON: return "person";
+    case PIPELINE_BOTH: return "both";
+    default: return "cascade";
+  }
+}
+
+DetectorPipeline pipelineFromString(const char* name) {
+  if (strcmp(name, "motion") == 0) {
+    return PIPELINE_MOTION;
+  }
+  if (strcmp(name, "person") == 0) {
+    return PIPELINE_PERSON;
+  }
+  if (strcmp(name, "both") == 0) {
+    return PIPELINE_BOTH;
+  }
+  return PIPELINE_CASCADE;
+}
+
 /**
  * Setup WiFi connection
  */
@@ -12,14 +12,43 @@
 #include <vector>
 
 // Maximum limits
-#define MAX_ZONES 10
+#define MAX_ZONES 64
+#define MAX_RELAYS 16            // Distinct relay pins across all zones
 #define MAX_RELAYS_PER_ZONE 4
+#define ZONE_JSON_SIZE 256       // JSON document bytes reserved per zone
 #define MAX_SSID_LENGTH 32
 #define MAX_PASSWORD_LENGTH 64
 #define MAX_IP_LENGTH 16
+#define MAX_CAMERAS 4            // Camera streams on one switch
+#define CAMERA_MAX_WEIGHT 8      // Detector share of a camera (1 = equal share)
+
+// Zone coordinates are in web UI canvas pixels
+#define ZONE_CANVAS_WIDTH 640
+#define ZONE_CANVAS_HEIGHT 480
+
+/**
+ * Detector pipeline ("detection.pipeline" in config.json)
+ */
+enum DetectorPipeline {
+  PIPELINE_MOTION,    // Motion blobs only
+  PIPELINE_PERSON,    // Person model on every frame
+  PIPELINE_CASCADE,   // Motion gate, person model confirms
+  PIPELINE_BOTH       // Motion and person detections combined
+};
+
+/**
+ * Camera source ("cameras" in config.json; zones refer to it by index)
+ */
+struct CameraSource {
+  char ip[MAX_IP_LENGTH];
+  int port;
+  char path[64];
+  int weight;     // Detector passes relative to the other cameras (1-CAMERA_MAX_WEIGHT)
+};
 
 /**
- * Zone definition structure
+ * Zone definition structure (configuration only; runtime state such as
+ * activation and timeouts lives in ZoneManager)
  */
 struct Zone {
   int id;
@@ -31,8 +60,7 @@ struct Zone {
   int relayPins[MAX_RELAYS_PER_ZONE]; // GPIO pins to activate
   int numRelays;  // Number of relays assigned
   int timeout;    // Timeout in seconds
-  bool active;    // Current activation state
-  unsigned long lastDetectionTime; // For timeout tracking
+  int camera;     // Index into Config::cameras
 };
 
 /**
@@ -43,14 +71,18 @@ struct Config {
   char wifiSSID[MAX_SSID_LENGTH];
   char wifiPassword[MAX_PASSWORD_LENGTH];
   
-  // MJPEG stream settings
-  char cctvIP[MAX_IP_LENGTH];
-  int cctvPort;
-  char streamPath[64];
+  // MJPEG stream settings (cameras[0] is the single "cctv" camera of older configs)
+  CameraSource cameras[MAX_CAMERAS];
+  int numCameras;
   
   // Detection settings
   float detectionThreshold;  // Confidence threshold (0.0-1.0)
   int globalTimeout;         // Default timeout in seconds
+  int confirmFrames;         // Zone activates after N detected frames...
+  int confirmWindow;         // ...out of the last M frames
+  float occupancySmoothing;  // Weight of the newest frame in the zone occupancy score (0-1)
+  DetectorPipeline pipeline; // Which detectors run per frame
+  bool roiInference;         // Person model only sees the bounding box of the relevant zones
   
   // Zones
   std::vector<Zone> zones;
@@ -60,15 +92,22 @@ struct Config {
   bool enableWatchdog;       // Enable watchdog timer
   int watchdogTimeout;       // Watchdog timeout in seconds
   bool autoRelayControl;     // Enable automatic relay control on motion
+  bool powerSave;            // Lower CPU clock and Wi-Fi power while the room is idle
 };
 
 // Function declarations
-bool loadConfigFromSPIFFS(Config* config);
-bool saveConfigToSPIFFS(const Config* config);
+bool loadConfigFromSPIFFS(Config* config);      // Snapshot, else JSON import
+bool saveConfigToSPIFFS(const Config* config);  // Snapshot (atomic replace)
+bool loadConfigSnapshot(Config* config);
+bool saveConfigSnapshot(const Config* config);
+bool importConfigFromJSON(Config* config);
+bool exportConfigToJSON(const Config* config);
 void setDefaultConfig(Config* config);
 bool loadZonesFromJSON(Config* config, const char* jsonPath);
 bool saveZonesToJSON(const Config* config, const char* jsonPath);
 void printConfig(const Config* config);
+const char* pipelineToString(DetectorPipeline pipeline);
+DetectorPipeline pipelineFromString(const char* name);
 void setupWiFi(Config* config);
 
 #endif // CONFIG_H
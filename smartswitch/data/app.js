@@ -12,6 +12,19 @@ let drawCurrent = { x: 0, y: 0 };
 let currentZoneId = 1;
 let editingZone = null;
 let detections = [];
+let selectedCamera = 0;   // Camera shown live, drawn on and edited in Settings
+
+// Live frames arrive as binary WebSocket messages
+const WS_MSG_FRAME = 0x01;
+const WS_DETECTION_BYTES = 20;
+let frameDecoding = false;
+let lastLiveFrame = 0;
+
+// Relay, zone, statistics, camera and system state is pushed as numbered
+// {"type":"state"} deltas; polling only runs while the WebSocket is down
+let stateVersion = null;   // "v" of the last applied state message (null = waiting for full state)
+let totalDetections = 0;
+let zoneDetections = {};   // Zone id -> detection count
 
 // Canvas and context
 const canvas = document.getElementById('video-canvas');
@@ -50,27 +63,34 @@ document.addEventListener('DOMContentLoaded', () => {
     // Start drawing loop
     setInterval(drawCanvas, 50); // 20 FPS redraw
     
-    // Auto-refresh data
-    setInterval(loadRelays, 2000);
-    setInterval(loadStatistics, 5000);
-    setInterval(loadSystemInfo, 10000);
-    setInterval(checkCameraStatus, 3000); // Check camera status every 3 seconds
+    // Fallback refresh while no state is pushed
+    setInterval(() => { if (!stateLive()) loadRelays(); }, 2000);
+    setInterval(() => { if (!stateLive()) loadStatistics(); }, 5000);
+    setInterval(() => { if (!stateLive()) loadSystemInfo(); }, 10000);
+    setInterval(() => { if (!stateLive()) checkCameraStatus(); }, 3000);
 });
 
+function stateLive() {
+    return ws && ws.readyState === WebSocket.OPEN && stateVersion !== null;
+}
+
 // WebSocket connection
 function connectWebSocket() {
     const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
     const wsUrl = `${protocol}//${window.location.host}/ws`;
     
     ws = new WebSocket(wsUrl);
+    ws.binaryType = 'arraybuffer';
     
     ws.onopen = () => {
         console.log('WebSocket connected');
         updateStreamStatus(true);
+        ws.send(JSON.stringify({ camera: selectedCamera }));
     };
     
     ws.onclose = () => {
         console.log('WebSocket disconnected');
+        stateVersion = null;
         updateStreamStatus(false);
         // Attempt reconnect after 3 seconds
         setTimeout(connectWebSocket, 3000);
@@ -82,6 +102,10 @@ function connectWebSocket() {
     };
     
     ws.onmessage = (event) => {
+        if (event.data instanceof ArrayBuffer) {
+            handleFrameMessage(event.data);
+            return;
+        }
         try {
             const data = JSON.parse(event.data);
             handleWebSocketMessage(data);
@@ -93,7 +117,9 @@ function connectWebSocket() {
 
 // Handle WebSocket messages
 function handleWebSocketMessage(data) {
-    if (data.type === 'detections') {
+    if (data.type === 'state') {
+        applyStateMessage(data);
+    } else if (data.type === 'detections') {
         detections = data.detections || [];
         document.getElementById('detection-count').textContent = data.count || 0;
     } else if (data.zones) {
@@ -102,6 +128,121 @@ function handleWebSocketMessage(data) {
     }
 }
 
+// Apply a state message: the full state, or a delta on top of the previous one
+function applyStateMessage(data) {
+    if (!data.full && (stateVersion === null || data.v !== stateVersion + 1)) {
+        // Missed a delta - ask once for the full state, ignore deltas until it arrives
+        if (stateVersion !== null) {
+            stateVersion = null;
+            ws.send(JSON.stringify({ resync: true }));
+        }
+        return;
+    }
+    stateVersion = data.v;
+    
+    if (data.full) {
+        relays = [];
+        zoneDetections = {};
+    }
+    
+    if (data.relays) {
+        data.relays.forEach(change => {
+            const relay = relays.find(r => r.pin === change.pin);
+            if (relay) {
+                relay.active = change.active;
+            } else {
+                relays.push({ pin: change.pin, active: change.active });
+            }
+        });
+        renderRelays();
+    }
+    
+    if (data.relaysRemoved) {
+        relays = relays.filter(r => !data.relaysRemoved.includes(r.pin));
+        renderRelays();
+    }
+    
+    if (data.zones) {
+        data.zones.forEach(change => {
+            const zone = zones.find(z => z.id === change.id);
+            if (zone) {
+                zone.active = change.active;
+            }
+        });
+        renderZoneList();
+        document.getElementById('total-zones').textContent = zones.filter(z => z.active).length;
+    }
+    
+    if (data.stats) {
+        totalDetections = data.stats.totalDetections;
+        data.stats.zones.forEach(change => { zoneDetections[change.id] = change.detections; });
+        renderStatistics();
+    }
+    
+    if (data.cameras) {
+        data.cameras.forEach(status => {
+            if (status.camera === selectedCamera) {
+                applyCameraStatus(status);
+            }
+        });
+    }
+    
+    if (data.system) {
+        renderSystemInfo(data.system);
+    }
+}
+
+// Handle binary frame message:
+// [type:1][jpegSize:4][jpeg][numDetections:2][numDetections x 5 float32], little-endian
+function handleFrameMessage(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < 7 || view.getUint8(0) !== WS_MSG_FRAME) {
+        return;
+    }
+    
+    const jpegSize = view.getUint32(1, true);
+    let offset = 5 + jpegSize;
+    if (offset + 2 > buffer.byteLength) {
+        return;
+    }
+    
+    const count = view.getUint16(offset, true);
+    offset += 2;
+    
+    const frameDetections = [];
+    for (let i = 0; i < count && offset + WS_DETECTION_BYTES <= buffer.byteLength; i++) {
+        frameDetections.push({
+            x: view.getFloat32(offset, true),
+            y: view.getFloat32(offset + 4, true),
+            width: view.getFloat32(offset + 8, true),
+            height: view.getFloat32(offset + 12, true),
+            confidence: view.getFloat32(offset + 16, true)
+        });
+        offset += WS_DETECTION_BYTES;
+    }
+    detections = frameDetections;
+    document.getElementById('detection-count').textContent = count;
+    lastLiveFrame = Date.now();
+    
+    // Drop the image if the previous one is still decoding (overlays still update)
+    if (frameDecoding) {
+        return;
+    }
+    frameDecoding = true;
+    
+    const url = URL.createObjectURL(new Blob([new Uint8Array(buffer, 5, jpegSize)], { type: 'image/jpeg' }));
+    const done = () => {
+        URL.revokeObjectURL(url);
+        frameDecoding = false;
+    };
+    cameraSnapshot.onload = () => {
+        cameraSnapshot.style.display = 'block';
+        done();
+    };
+    cameraSnapshot.onerror = done;
+    cameraSnapshot.src = url;
+}
+
 // Canvas setup
 function setupCanvas() {
     canvas.addEventListener('mousedown', onCanvasMouseDown);
@@ -159,7 +300,7 @@ function onCanvasMouseDown(e) {
     };
     
     // Check if clicking on existing zone
-    const clickedZone = zones.find(zone => {
+    const clickedZone = cameraZones().find(zone => {
         return drawStart.x >= zone.x && drawStart.x <= zone.x + zone.width &&
                drawStart.y >= zone.y && drawStart.y <= zone.y + zone.height;
     });
@@ -220,8 +361,8 @@ function drawCanvas() {
     ctx.font = '14px Arial';
     ctx.fillText('(MJPEG stream will display here)', canvas.width / 2, canvas.height / 2 + 30);
     
-    // Draw existing zones
-    zones.forEach((zone, index) => {
+    // Draw existing zones of the selected camera
+    cameraZones().forEach((zone, index) => {
         const color = zoneColors[index % zoneColors.length];
         
         // Zone rectangle
@@ -315,10 +456,12 @@ async function loadConfig() {
     try {
         const response = await fetch('/api/config');
         config = await response.json();
+        if (!config.cameras || config.cameras.length === 0) {
+            config.cameras = [{ ip: config.cctvIP, port: config.cctvPort, path: config.streamPath, weight: 1 }];
+        }
         
-        document.getElementById('cctv-ip').value = config.cctvIP || '';
-        document.getElementById('cctv-port').value = config.cctvPort || 8080;
-        document.getElementById('stream-path').value = config.streamPath || '';
+        renderCameraSelect();
+        showCameraSettings();
         document.getElementById('detection-threshold').value = config.detectionThreshold || 0.5;
         document.getElementById('threshold-value').textContent = (config.detectionThreshold || 0.5).toFixed(2);
         document.getElementById('global-timeout').value = config.globalTimeout || 5;
@@ -331,7 +474,57 @@ async function loadConfig() {
     }
 }
 
-// Update camera snapshot (refreshes every minute)
+// Cameras: the selector lists configured cameras plus an entry to add one
+function cameraZones() {
+    return zones.filter(zone => (zone.camera || 0) === selectedCamera);
+}
+
+function renderCameraSelect() {
+    const select = document.getElementById('camera-select');
+    select.innerHTML = '';
+    config.cameras.forEach((camera, index) => {
+        const option = document.createElement('option');
+        option.value = index;
+        option.textContent = `Camera ${index + 1} (${camera.ip || 'not set'})`;
+        select.appendChild(option);
+    });
+    if (config.cameras.length < (config.maxCameras || 1)) {
+        const option = document.createElement('option');
+        option.value = config.cameras.length;
+        option.textContent = '➕ Add camera';
+        select.appendChild(option);
+    }
+    select.value = selectedCamera;
+    document.getElementById('camera-select-group').style.display = (config.maxCameras || 1) > 1 ? 'block' : 'none';
+}
+
+function showCameraSettings() {
+    const camera = config.cameras[selectedCamera];
+    document.getElementById('cctv-ip').value = camera.ip || '';
+    document.getElementById('cctv-port').value = camera.port || 8080;
+    document.getElementById('stream-path').value = camera.path || '';
+    document.getElementById('camera-weight').value = camera.weight || 1;
+}
+
+function selectCamera(value) {
+    selectedCamera = parseInt(value);
+    if (selectedCamera >= config.cameras.length) {
+        // New camera: saved with the settings, streams after a restart
+        config.cameras.push({ ip: '', port: 81, path: '/stream', weight: 1 });
+        renderCameraSelect();
+    }
+    showCameraSettings();
+    detections = [];
+    lastLiveFrame = 0;
+    if (ws && ws.readyState === WebSocket.OPEN) {
+        ws.send(JSON.stringify({ camera: selectedCamera }));
+    }
+    renderZoneList();
+    checkCameraStatus();
+    updateCameraSnapshot();
+}
+
+// Update camera snapshot (refreshes every minute, only while no live frames arrive)
 let snapshotInterval;
 
 function updateCameraSnapshot() {
@@ -342,12 +535,16 @@ function updateCameraSnapshot() {
         clearInterval(snapshotInterval);
     }
     
-    if (config.cctvIP && config.cctvPort) {
+    const camera = config.cameras[selectedCamera];
+    if (camera && camera.ip && camera.port) {
         // Function to fetch and display snapshot
         const fetchSnapshot = async () => {
+            if (Date.now() - lastLiveFrame < 5000) {
+                return;
+            }
             try {
                 const timestamp = new Date().getTime();
-                const snapshotUrl = `/api/camera/snapshot?t=${timestamp}`;
+                const snapshotUrl = `/api/camera/snapshot?camera=${selectedCamera}&t=${timestamp}`;
                 console.log('Fetching camera snapshot...');
                 
                 // Test if the image loads
@@ -384,9 +581,16 @@ function updateCameraSnapshot() {
 // API: Save configuration
 async function saveSettings() {
     try {
-        config.cctvIP = document.getElementById('cctv-ip').value;
-        config.cctvPort = parseInt(document.getElementById('cctv-port').value);
-        config.streamPath = document.getElementById('stream-path').value;
+        config.cameras[selectedCamera] = {
+            ip: document.getElementById('cctv-ip').value,
+            port: parseInt(document.getElementById('cctv-port').value),
+            path: document.getElementById('stream-path').value,
+            weight: parseInt(document.getElementById('camera-weight').value) || 1
+        };
+        // The cameras list replaces the single-camera fields
+        delete config.cctvIP;
+        delete config.cctvPort;
+        delete config.streamPath;
         config.detectionThreshold = parseFloat(document.getElementById('detection-threshold').value);
         config.globalTimeout = parseInt(document.getElementById('global-timeout').value);
         config.autoRelayControl = document.getElementById('auto-relay-control').checked;
@@ -398,7 +602,10 @@ async function saveSettings() {
         });
         
         if (response.ok) {
-            alert('✓ Settings saved successfully!');
+            const result = await response.json();
+            alert(result.restartRequired ? '✓ Settings saved - restart the switch to start the new camera' :
+                                           '✓ Settings saved successfully!');
+            renderCameraSelect();
             // Update camera snapshot with new settings
             updateCameraSnapshot();
         } else {
@@ -438,13 +645,14 @@ function renderZoneList() {
         item.className = `zone-item ${zone.active ? 'active' : ''}`;
         
         const relayText = zone.relayPins.join(', ');
+        const cameraText = config.cameras && config.cameras.length > 1 ? ` | Camera ${(zone.camera || 0) + 1}` : '';
         
         item.innerHTML = `
             <div class="zone-info">
                 <div class="zone-name">${zone.name}</div>
                 <div class="zone-details">
                     Position: ${zone.x},${zone.y} | Size: ${zone.width}x${zone.height}<br>
-                    Relays: GPIO ${relayText} | Timeout: ${zone.timeout}s
+                    Relays: GPIO ${relayText} | Timeout: ${zone.timeout}s${cameraText}
                 </div>
             </div>
             <div class="zone-actions">
@@ -463,30 +671,35 @@ async function loadRelays() {
         const response = await fetch('/api/relays');
         const data = await response.json();
         relays = data.relays || [];
-        renderRelayGrid();
-        
-        // Update active relay count
-        const activeCount = relays.filter(r => r.active).length;
-        document.getElementById('relay-count').textContent = activeCount;
-        
-        // Update GPIO summary
-        const gpioSummary = document.getElementById('gpio-summary');
-        if (activeCount === 0) {
-            gpioSummary.textContent = 'All LOW';
-            gpioSummary.style.color = '#6b7280';
-        } else if (activeCount === relays.length) {
-            gpioSummary.textContent = 'All HIGH';
-            gpioSummary.style.color = '#ef4444';
-        } else {
-            const highPins = relays.filter(r => r.active).map(r => r.pin).join(', ');
-            gpioSummary.textContent = `${highPins} HIGH`;
-            gpioSummary.style.color = '#f59e0b';
-        }
+        renderRelays();
     } catch (error) {
         console.error('Failed to load relays:', error);
     }
 }
 
+// Render relay grid and summary
+function renderRelays() {
+    renderRelayGrid();
+    
+    // Update active relay count
+    const activeCount = relays.filter(r => r.active).length;
+    document.getElementById('relay-count').textContent = activeCount;
+    
+    // Update GPIO summary
+    const gpioSummary = document.getElementById('gpio-summary');
+    if (activeCount === 0) {
+        gpioSummary.textContent = 'All LOW';
+        gpioSummary.style.color = '#6b7280';
+    } else if (activeCount === relays.length) {
+        gpioSummary.textContent = 'All HIGH';
+        gpioSummary.style.color = '#ef4444';
+    } else {
+        const highPins = relays.filter(r => r.active).map(r => r.pin).join(', ');
+        gpioSummary.textContent = `${highPins} HIGH`;
+        gpioSummary.style.color = '#f59e0b';
+    }
+}
+
 // Render relay grid
 function renderRelayGrid() {
     const grid = document.getElementById('relay-grid');
@@ -573,31 +786,39 @@ async function loadStatistics() {
         const response = await fetch('/api/statistics');
         const data = await response.json();
         
-        document.getElementById('total-detections').textContent = data.totalDetections || 0;
-        document.getElementById('total-zones').textContent = zones.filter(z => z.active).length;
-        
-        // Zone statistics
-        const statsDiv = document.getElementById('zone-stats');
-        statsDiv.innerHTML = '';
-        
-        if (data.zones && data.zones.length > 0) {
-            data.zones.forEach(zone => {
-                const item = document.createElement('div');
-                item.style.cssText = 'display: flex; justify-content: space-between; padding: 0.5rem 0; border-bottom: 1px solid #e5e5e5;';
-                item.innerHTML = `
-                    <span>${zone.name}</span>
-                    <strong>${zone.detections} detections</strong>
-                `;
-                statsDiv.appendChild(item);
-            });
-        } else {
-            statsDiv.innerHTML = '<p style="text-align: center; color: #666;">No statistics yet</p>';
-        }
+        totalDetections = data.totalDetections || 0;
+        zoneDetections = {};
+        (data.zones || []).forEach(zone => { zoneDetections[zone.id] = zone.detections; });
+        renderStatistics();
     } catch (error) {
         console.error('Failed to load statistics:', error);
     }
 }
 
+// Render statistics (zone names from the zone list)
+function renderStatistics() {
+    document.getElementById('total-detections').textContent = totalDetections;
+    document.getElementById('total-zones').textContent = zones.filter(z => z.active).length;
+    
+    // Zone statistics
+    const statsDiv = document.getElementById('zone-stats');
+    statsDiv.innerHTML = '';
+    
+    if (zones.length > 0) {
+        zones.forEach(zone => {
+            const item = document.createElement('div');
+            item.style.cssText = 'display: flex; justify-content: space-between; padding: 0.5rem 0; border-bottom: 1px solid #e5e5e5;';
+            item.innerHTML = `
+                <span>${zone.name}</span>
+                <strong>${zoneDetections[zone.id] || 0} detections</strong>
+            `;
+            statsDiv.appendChild(item);
+        });
+    } else {
+        statsDiv.innerHTML = '<p style="text-align: center; color: #666;">No statistics yet</p>';
+    }
+}
+
 // API: Reset statistics
 async function resetStatistics() {
     if (!confirm('Reset all statistics?')) {
@@ -625,14 +846,23 @@ async function loadSystemInfo() {
         const data = await response.json();
         
         document.getElementById('sys-ip').textContent = data.ipAddress || '-';
-        document.getElementById('sys-heap').textContent = `${(data.freeHeap / 1024).toFixed(1)} KB`;
-        document.getElementById('sys-wifi').textContent = data.wifiRSSI || '-';
         document.getElementById('sys-model').textContent = data.modelInfo || '-';
+        renderSystemInfo(data);
     } catch (error) {
         console.error('Failed to load system info:', error);
     }
 }
 
+// Render the changing system fields (pushed deltas only carry some of them)
+function renderSystemInfo(info) {
+    if (info.freeHeap !== undefined) {
+        document.getElementById('sys-heap').textContent = `${(info.freeHeap / 1024).toFixed(1)} KB`;
+    }
+    if (info.wifiRSSI !== undefined) {
+        document.getElementById('sys-wifi').textContent = info.wifiRSSI || '-';
+    }
+}
+
 // API: Test CCTV connection
 async function testConnection() {
     try {
@@ -642,10 +872,20 @@ async function testConnection() {
         statusDiv.style.color = '#92400e';
         statusDiv.textContent = '⏳ Testing connection...';
         
-        const response = await fetch('/api/test-connection');
-        const data = await response.json();
+        // The test runs in the background on the device; poll until it finishes
+        let data;
+        for (let attempt = 0; attempt < 30; attempt++) {
+            const response = await fetch(`/api/test-connection?camera=${selectedCamera}`);
+            data = await response.json();
+            if (!data.pending) break;
+            await new Promise(resolve => setTimeout(resolve, 500));
+        }
         
-        if (data.success) {
+        if (data.pending) {
+            statusDiv.style.background = '#fee2e2';
+            statusDiv.style.color = '#991b1b';
+            statusDiv.textContent = '✗ Connection test timed out';
+        } else if (data.success) {
             statusDiv.style.background = '#d1fae5';
             statusDiv.style.color = '#065f46';
             statusDiv.textContent = '✓ Connection successful!';
@@ -674,21 +914,33 @@ async function startCamera() {
         statusDiv.style.color = '#92400e';
         statusDiv.textContent = '⏳ Starting camera...';
         
-        const response = await fetch('/api/camera/start', { method: 'POST' });
+        const response = await fetch(`/api/camera/start?camera=${selectedCamera}`, { method: 'POST' });
         const data = await response.json();
         
         if (data.success) {
-            statusDiv.style.background = '#d1fae5';
-            statusDiv.style.color = '#065f46';
-            statusDiv.textContent = '✓ Camera started!';
-            
+            // The device connects in the background (and keeps retrying)
             document.getElementById('start-camera-btn').style.display = 'none';
             document.getElementById('stop-camera-btn').style.display = 'block';
             
-            // Reload camera snapshot
-            updateCameraSnapshot();
+            let status = { connected: !data.pending };
+            for (let attempt = 0; attempt < 20 && !status.connected; attempt++) {
+                await new Promise(resolve => setTimeout(resolve, 500));
+                status = await (await fetch(`/api/camera/status?camera=${selectedCamera}`)).json();
+                if (status.state === 'retrying') {
+                    statusDiv.textContent = `⏳ Camera unreachable, retrying in ${Math.ceil(status.retryIn / 1000)} s (${status.failures} failed)`;
+                }
+            }
             
-            setTimeout(() => { statusDiv.style.display = 'none'; }, 3000);
+            if (status.connected) {
+                statusDiv.style.background = '#d1fae5';
+                statusDiv.style.color = '#065f46';
+                statusDiv.textContent = '✓ Camera started!';
+                
+                // Reload camera snapshot
+                updateCameraSnapshot();
+                
+                setTimeout(() => { statusDiv.style.display = 'none'; }, 3000);
+            }
         } else {
             statusDiv.style.background = '#fee2e2';
             statusDiv.style.color = '#991b1b';
@@ -713,7 +965,7 @@ async function stopCamera() {
         statusDiv.style.color = '#92400e';
         statusDiv.textContent = '⏳ Stopping camera...';
         
-        const response = await fetch('/api/camera/stop', { method: 'POST' });
+        const response = await fetch(`/api/camera/stop?camera=${selectedCamera}`, { method: 'POST' });
         const data = await response.json();
         
         if (data.success) {
@@ -746,23 +998,31 @@ async function stopCamera() {
 // Check camera status periodically
 async function checkCameraStatus() {
     try {
-        const response = await fetch('/api/camera/status');
-        const data = await response.json();
-        
-        if (data.connected) {
-            document.getElementById('start-camera-btn').style.display = 'none';
-            document.getElementById('stop-camera-btn').style.display = 'block';
-            updateCameraSnapshot();
-        } else {
-            document.getElementById('start-camera-btn').style.display = 'block';
-            document.getElementById('stop-camera-btn').style.display = 'none';
-            cameraSnapshot.style.display = 'none';
-        }
+        const response = await fetch(`/api/camera/status?camera=${selectedCamera}`);
+        applyCameraStatus(await response.json());
     } catch (error) {
         console.error('Failed to check camera status:', error);
     }
 }
 
+// Show start/stop and the snapshot for the selected camera's link state
+function applyCameraStatus(data) {
+    if (data.connected) {
+        document.getElementById('start-camera-btn').style.display = 'none';
+        document.getElementById('stop-camera-btn').style.display = 'block';
+        updateCameraSnapshot();
+    } else if (data.state === 'connecting' || data.state === 'retrying') {
+        // Link is down but the device keeps reconnecting
+        document.getElementById('start-camera-btn').style.display = 'none';
+        document.getElementById('stop-camera-btn').style.display = 'block';
+        cameraSnapshot.style.display = 'none';
+    } else {
+        document.getElementById('start-camera-btn').style.display = 'block';
+        document.getElementById('stop-camera-btn').style.display = 'none';
+        cameraSnapshot.style.display = 'none';
+    }
+}
+
 // Modal management
 function openAddZoneModal(x = 10, y = 10, width = 100, height = 100) {
     editingZone = { x, y, width, height };
@@ -811,7 +1071,8 @@ async function saveZone() {
         width: Math.round(editingZone.width),
         height: Math.round(editingZone.height),
         relayPins,
-        timeout
+        timeout,
+        camera: editingZone.camera !== undefined ? editingZone.camera : selectedCamera
     };
     
     try {
@@ -0,0 +1,217 @@
+/**
+ * Detector Backends Implementation
+ */
+
+#include "detector.h"
+#include "metrics.h"
+
+MotionBackend::MotionBackend(MotionDetector* motionDetector) {
+  motion = motionDetector;
+}
+
+int MotionBackend::detect(const FrameLease& frame, std::vector<Detection>& detections) {
+  int blobCount = motion->detectMotion(frame.data(), frame.size());
+  const MotionBlob* blobs = motion->getBlobs();
+  
+  // Blob coordinates are in decoded frame pixels
+  float frameWidth = max(motion->getFrameWidth(), 1);
+  float frameHeight = max(motion->getFrameHeight(), 1);
+  for (int i = 0; i < blobCount; i++) {
+    const MotionBlob& blob = blobs[i];
+    Detection det;
+    det.x = blob.x / frameWidth;
+    det.y = blob.y / frameHeight;
+    det.width = blob.width / frameWidth;
+    det.height = blob.height / frameHeight;
+    det.confidence = blob.intensity;
+    det.classId = -1;
+    detections.push_back(det);
+  }
+  return blobCount;
+}
+
+PersonBackend::PersonBackend(TFLiteDetector* personModel) {
+  model = personModel;
+  frameBuffer = nullptr;
+  frameBufferPixels = 0;
+  hasRegion = false;
+}
+
+PersonBackend::~PersonBackend() {
+  if (frameBuffer) {
+    free(frameBuffer);
+  }
+}
+
+bool PersonBackend::begin(size_t maxPixels) {
+  if (!frameBuffer) {
+    frameBuffer = (uint8_t*)(psramFound() ? ps_malloc(maxPixels) : malloc(maxPixels));
+  }
+  if (!frameBuffer) {
+    Serial.println("⚠ Person frame buffer allocation failed - person detection disabled");
+    return false;
+  }
+  frameBufferPixels = maxPixels;
+  return true;
+}
+
+void PersonBackend::setRegion(const ZoneRegion* roi) {
+  hasRegion = roi != nullptr;
+  if (roi) {
+    region = *roi;
+  }
+}
+
+int PersonBackend::detect(const FrameLease& frame, std::vector<Detection>& detections) {
+  int imageWidth = 0;
+  int imageHeight = 0;
+  if (!decoder.readInfo(frame.data(), frame.size(), &imageWidth, &imageHeight)) {
+    return 0;
+  }
+  
+  JpegRegion crop = {0, 0, imageWidth, imageHeight};
+  if (hasRegion) {
+    crop.x = (int)(region.x * imageWidth);
+    crop.y = (int)(region.y * imageHeight);
+    crop.width = max((int)ceilf(region.width * imageWidth), 1);
+    crop.height = max((int)ceilf(region.height * imageHeight), 1);
+  }
+  
+  JpegScale scale = JPEG_SCALE_FULL;
+  for (int s = JPEG_SCALE_EIGHTH; s > JPEG_SCALE_FULL; s--) {
+    if (JpegDecoder::scaledSize(crop.width, (JpegScale)s) >= model->getInputWidth() &&
+        JpegDecoder::scaledSize(crop.height, (JpegScale)s) >= model->getInputHeight()) {
+      scale = (JpegScale)s;
+      break;
+    }
+  }
+  
+  // Reduce further if the chosen scale does not fit the buffer (crop grows to MCU bounds)
+  while (scale < JPEG_SCALE_EIGHTH &&
+         (size_t)JpegDecoder::scaledSize(crop.width + 32, scale) * JpegDecoder::scaledSize(crop.height + 32, scale) > frameBufferPixels) {
+    scale = (JpegScale)(scale + 1);
+  }
+  
+  int w = 0;
+  int h = 0;
+  if (!decoder.decodeRegion(frame.data(), frame.size(), scale, JPEG_GRAY8, &crop,
+                            frameBuffer, frameBufferPixels, &w, &h)) {
+    return 0;
+  }
+  
+  // Crop-relative boxes back to whole-frame coordinates
+  std::vector<Detection> persons = model->detectGray(frameBuffer, w, h);
+  float offsetX = (float)crop.x / imageWidth;
+  float offsetY = (float)crop.y / imageHeight;
+  float scaleX = (float)crop.width / imageWidth;
+  float scaleY = (float)crop.height / imageHeight;
+  for (Detection& det : persons) {
+    det.x = offsetX + det.x * scaleX;
+    det.y = offsetY + det.y * scaleY;
+    det.width *= scaleX;
+    det.height *= scaleY;
+    detections.push_back(det);
+  }
+  return persons.size();
+}
+
+DetectionPipeline::DetectionPipeline() {
+  gate = nullptr;
+  confirm = nullptr;
+  zones = nullptr;
+  camera = ZONE_ALL_CAMERAS;
+  lastConfirmAt = 0;
+  gateRuns = 0;
+  confirmRuns = 0;
+  confirmSkips = 0;
+}
+
+void DetectionPipeline::begin(Detector* gateStage, Detector* confirmStage, ZoneManager* zoneManager, int zoneCamera) {
+  gate = gateStage;
+  confirm = confirmStage;
+  zones = zoneManager;
+  camera = zoneCamera;
+  gateHits.reserve(MOTION_MAX_BLOBS);
+  
+  Serial.printf("✓ Detection pipeline: %s%s%s\n", gate ? gate->getName() : "none",
+                confirm && confirm->isReady() ? " -> " : "",
+                confirm && confirm->isReady() ? confirm->getName() : "");
+}
+
+void DetectionPipeline::process(const FrameLease& frame, const Config* config, std::vector<Detection>& detections) {
+  DetectorPipeline mode = config->pipeline;
+  bool confirmReady = confirm && confirm->isReady();
+  if (!confirmReady) {
+    mode = PIPELINE_MOTION;
+  }
+  
+  // Gate runs every frame unless the model alone is asked for
+  // (keeps the motion background model current)
+  gateHits.clear();
+  if (mode != PIPELINE_PERSON && gate && gate->isReady()) {
+    int64_t start = esp_timer_get_time();
+    gate->detect(frame, gateHits);
+    metrics.record(STAGE_MOTION, start);
+    gateRuns++;
+  }
+  
+  if (mode != PIPELINE_PERSON) {
+    if (mode != PIPELINE_CASCADE) {
+      detections.insert(detections.end(), gateHits.begin(), gateHits.end());
+    }
+    if (mode == PIPELINE_MOTION) {
+      return;
+    }
+  }
+  
+  // Crop the model input to the zones that matter (whole frame before any zone is drawn)
+  ZoneRegion region;
+  const ZoneRegion* roi = nullptr;
+  bool cascade = mode == PIPELINE_CASCADE;
+  if (config->roiInference && zones && zones->getZoneCount(camera) > 0) {
+    if (!zones->getCandidateRegion(gateHits, !cascade, &region, camera)) {
+      // Movement outside every zone: nothing for the model to confirm
+      lastConfirmed.clear();
+      confirmSkips++;
+      return;
+    }
+    roi = &region;
+  }
+  
+  if (!cascade) {
+    runConfirm(frame, roi, detections);
+    return;
+  }
+  
+  // Cascade: confirm movement with the person model
+  if (!gateHits.empty()) {
+    runConfirm(frame, roi, detections);
+    return;
+  }
+  
+  // Nothing moved: re-confirm occupied zones now and then, reuse the last answer in between
+  if (zones && zones->getActiveZoneCount(camera) > 0) {
+    if (millis() - lastConfirmAt >= CASCADE_HOLD_INTERVAL) {
+      runConfirm(frame, roi, detections);
+    } else {
+      detections.insert(detections.end(), lastConfirmed.begin(), lastConfirmed.end());
+      confirmSkips++;
+    }
+    return;
+  }
+  
+  lastConfirmed.clear();
+  confirmSkips++;
+}
+
+void DetectionPipeline::runConfirm(const FrameLease& frame, const ZoneRegion* region,
+                                   std::vector<Detection>& detections) {
+  size_t first = detections.size();
+  confirm->setRegion(region);
+  int64_t start = esp_timer_get_time();
+  confirm->detect(frame, detections);
+  metrics.record(STAGE_INFERENCE, start);
+  confirmRuns++;
+  lastConfirmAt = millis();
+  lastConfirmed.assign(detections.begin() + first, detections.end());
+}
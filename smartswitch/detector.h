@@ -0,0 +1,137 @@
+/**
+ * Detector Backends Header
+ *
+ * Common interface over the frame detectors so the processing task can
+ * chain them. Every backend takes the raw JPEG frame and appends
+ * detections in normalized (0-1) frame coordinates.
+ * - MotionBackend: MotionDetector blobs (DC-luma decode, very cheap)
+ * - PersonBackend: TFLite person model on a reduced-scale luma decode
+ * - DetectionPipeline: runs the backends as configured in config.json
+ *   ("motion", "person", "cascade" or "both")
+ */
+
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "frame_pool.h"
+#include "jpeg_decoder.h"
+#include "motion_detector.h"
+#include "tflite_detector.h"
+#include "zone_manager.h"
+
+// Cascade: while zones are held only by earlier confirmations (no motion),
+// re-run the person model at most this often and reuse its result between runs
+#define CASCADE_HOLD_INTERVAL 500   // ms
+
+/**
+ * Detector interface
+ */
+class Detector {
+public:
+  virtual ~Detector() {}
+  
+  // Short name for logs and the web UI
+  virtual const char* getName() = 0;
+  
+  // Backend can run (model loaded, buffers allocated)
+  virtual bool isReady() = 0;
+  
+  // Append detections for one frame; returns the number appended
+  virtual int detect(const FrameLease& frame, std::vector<Detection>& detections) = 0;
+  
+  // Limit following detect() calls to a region (nullptr = whole frame);
+  // detections stay in whole-frame coordinates. Ignored by backends that
+  // cannot crop.
+  virtual void setRegion(const ZoneRegion* region) { (void)region; }
+};
+
+/**
+ * Motion blobs as detections
+ */
+class MotionBackend : public Detector {
+public:
+  MotionBackend(MotionDetector* motion);
+  
+  const char* getName() { return "motion"; }
+  bool isReady() { return motion != nullptr; }
+  int detect(const FrameLease& frame, std::vector<Detection>& detections);
+  
+private:
+  MotionDetector* motion;
+};
+
+/**
+ * Person model on a grayscale decode at the smallest JPEG scale that
+ * still covers the model input; with a region only its MCUs are decoded
+ * and the model sees the crop
+ */
+class PersonBackend : public Detector {
+public:
+  PersonBackend(TFLiteDetector* model);
+  ~PersonBackend();
+  
+  // Allocate the decode buffer (call after the model is loaded)
+  bool begin(size_t maxPixels);
+  
+  const char* getName() { return "person"; }
+  bool isReady() { return model && model->isInitialized() && frameBuffer; }
+  int detect(const FrameLease& frame, std::vector<Detection>& detections);
+  void setRegion(const ZoneRegion* region);
+  
+private:
+  TFLiteDetector* model;
+  JpegDecoder decoder;
+  uint8_t* frameBuffer;
+  size_t frameBufferPixels;
+  ZoneRegion region;
+  bool hasRegion;
+};
+
+/**
+ * Detector pipeline
+ *
+ * Cascade mode runs the gate (motion) on every frame and the confirm
+ * stage (person) only when the gate fired inside a zone or a zone is
+ * still active; only confirmed detections are passed on. With roiInference
+ * the confirm stage only sees the bounding box of the zones involved.
+ * Without a usable confirm stage every mode falls back to the gate alone.
+ * With several cameras each one has its own pipeline (and motion gate, so
+ * background models stay apart) while the confirm stage is shared.
+ */
+class DetectionPipeline {
+public:
+  DetectionPipeline();
+  
+  // Zones of the given camera decide where the confirm stage looks
+  void begin(Detector* gate, Detector* confirm, ZoneManager* zones, int camera = ZONE_ALL_CAMERAS);
+  
+  // Detect on one frame (settings from config)
+  void process(const FrameLease& frame, const Config* config, std::vector<Detection>& detections);
+  
+  // Gate detections on the last frame (cascade output may be empty even when this is not)
+  int getGateHits() { return gateHits.size(); }
+  
+  // Statistics
+  uint32_t getGateRuns() { return gateRuns; }
+  uint32_t getConfirmRuns() { return confirmRuns; }
+  uint32_t getConfirmSkips() { return confirmSkips; }  // Cascade frames that skipped the model
+  
+private:
+  Detector* gate;
+  Detector* confirm;
+  ZoneManager* zones;
+  int camera;
+  std::vector<Detection> gateHits;      // Reused between frames
+  std::vector<Detection> lastConfirmed; // Held between cascade re-confirmations
+  unsigned long lastConfirmAt;
+  uint32_t gateRuns;
+  uint32_t confirmRuns;
+  uint32_t confirmSkips;
+  
+  void runConfirm(const FrameLease& frame, const ZoneRegion* region, std::vector<Detection>& detections);
+};
+
+#endif // DETECTOR_H
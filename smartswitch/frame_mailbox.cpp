@@ -0,0 +1,125 @@
+/**
+ * Frame Mailbox Implementation
+ *
+ * Pending leases are swapped under a spinlock; a binary semaphore
+ * wakes the consumer without polling and is given again after a take
+ * while other cameras still have frames waiting.
+ */
+
+#include "frame_mailbox.h"
+#include "metrics.h"
+
+FrameMailbox::FrameMailbox() {
+  mux = portMUX_INITIALIZER_UNLOCKED;
+  ready = nullptr;
+  sourceCount = 1;
+  postedCount = 0;
+  staleDrops = 0;
+  for (int i = 0; i < MAX_CAMERAS; i++) {
+    weight[i] = 1;
+    credit[i] = 0;
+    takenCount[i] = 0;
+  }
+}
+
+FrameMailbox::~FrameMailbox() {
+  if (ready) {
+    vSemaphoreDelete(ready);
+  }
+}
+
+bool FrameMailbox::begin(int sources) {
+  sourceCount = constrain(sources, 1, MAX_CAMERAS);
+  if (!ready) {
+    ready = xSemaphoreCreateBinary();
+  }
+  
+  if (!ready) {
+    Serial.println("ERROR: Failed to create frame mailbox");
+    return false;
+  }
+  return true;
+}
+
+void FrameMailbox::setWeight(int source, int sourceWeight) {
+  if (source >= 0 && source < MAX_CAMERAS) {
+    weight[source] = constrain(sourceWeight, 1, CAMERA_MAX_WEIGHT);
+  }
+}
+
+void FrameMailbox::post(const FrameLease& frame, int source) {
+  if (source < 0 || source >= sourceCount) {
+    return;
+  }
+  
+  bool replaced;
+  portENTER_CRITICAL(&mux);
+  replaced = pending[source].valid();
+  if (replaced) {
+    staleDrops++;  // Consumer never saw it
+  }
+  pending[source] = frame;
+  postedCount++;
+  portEXIT_CRITICAL(&mux);
+  
+  if (replaced) {
+    metrics.count(COUNTER_FRAMES_STALE);
+  }
+  
+  xSemaphoreGive(ready);
+}
+
+bool FrameMailbox::take(FrameLease* frame, uint32_t timeoutMs, int* source) {
+  if (xSemaphoreTake(ready, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+    return false;
+  }
+  
+  bool moreWaiting = false;
+  portENTER_CRITICAL(&mux);
+  int chosen = pickSource();
+  if (chosen >= 0) {
+    *frame = pending[chosen];
+    pending[chosen].release();
+    takenCount[chosen]++;
+  }
+  for (int s = 0; s < sourceCount; s++) {
+    moreWaiting = moreWaiting || pending[s].valid();
+  }
+  portEXIT_CRITICAL(&mux);
+  
+  // Keep the consumer awake for the cameras still waiting
+  if (moreWaiting) {
+    xSemaphoreGive(ready);
+  }
+  
+  if (source) {
+    *source = chosen;
+  }
+  return chosen >= 0 && frame->valid();
+}
+
+/**
+ * Smooth weighted round-robin over the cameras with a frame waiting:
+ * each earns its weight in credit, the richest is served and pays back
+ * the total. Cameras without a frame earn nothing, so a camera that was
+ * down does not get a burst of passes when it returns. Call with mux held.
+ */
+int FrameMailbox::pickSource() {
+  int best = -1;
+  int total = 0;
+  for (int s = 0; s < sourceCount; s++) {
+    if (!pending[s].valid()) {
+      continue;
+    }
+    credit[s] += weight[s];
+    total += weight[s];
+    if (best < 0 || credit[s] > credit[best]) {
+      best = s;
+    }
+  }
+  
+  if (best >= 0) {
+    credit[best] -= total;
+  }
+  return best;
+}
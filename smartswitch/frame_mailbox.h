@@ -0,0 +1,62 @@
+/**
+ * Frame Mailbox Header
+ *
+ * "Latest frame wins" hand-off between the network ingest tasks and the
+ * processing task, with one slot per camera. Posting replaces any frame
+ * of that camera that has not been taken yet, so a slow detector pass
+ * drops stale frames instead of backing up the TCP socket.
+ * Cameras with a waiting frame are served in smooth weighted round-robin,
+ * so a fast camera cannot starve the others of detector time.
+ */
+
+#ifndef FRAME_MAILBOX_H
+#define FRAME_MAILBOX_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "config.h"
+#include "frame_pool.h"
+
+/**
+ * Frame Mailbox Class
+ */
+class FrameMailbox {
+public:
+  FrameMailbox();
+  ~FrameMailbox();
+  
+  // Create synchronization primitives for sourceCount cameras
+  bool begin(int sourceCount = 1);
+  
+  // Share of detector passes for a camera while several have frames waiting
+  void setWeight(int source, int weight);
+  
+  // Publish newest frame of a camera (its unread older frame is dropped)
+  void post(const FrameLease& frame, int source = 0);
+  
+  // Wait up to timeoutMs for a frame from any camera; returns false on
+  // timeout, otherwise the camera it came from in *source
+  bool take(FrameLease* frame, uint32_t timeoutMs, int* source = nullptr);
+  
+  // Statistics
+  int getPostedCount() { return postedCount; }
+  int getStaleDrops() { return staleDrops; }
+  int getTakenCount(int source) { return takenCount[source]; }
+  
+private:
+  FrameLease pending[MAX_CAMERAS];
+  int weight[MAX_CAMERAS];
+  int credit[MAX_CAMERAS];    // Round-robin credit (served when highest)
+  int sourceCount;
+  portMUX_TYPE mux;
+  SemaphoreHandle_t ready;
+  
+  volatile int postedCount;
+  volatile int staleDrops;
+  volatile int takenCount[MAX_CAMERAS];
+  
+  int pickSource();
+};
+
+#endif // FRAME_MAILBOX_H
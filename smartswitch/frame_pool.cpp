@@ -0,0 +1,149 @@
+/**
+ * Frame Pool Implementation
+ *
+ * Slots live in one contiguous PSRAM block allocated at startup.
+ * Reference counts use atomic builtins so leases can cross cores.
+ */
+
+#include "frame_pool.h"
+
+// ---------------------------------------------------------------------------
+// FrameLease
+// ---------------------------------------------------------------------------
+
+FrameLease::FrameLease() {
+  pool = nullptr;
+  slot = nullptr;
+}
+
+FrameLease::FrameLease(FramePool* p, FrameSlot* s) {
+  pool = p;
+  slot = s;
+}
+
+FrameLease::FrameLease(const FrameLease& other) {
+  pool = other.pool;
+  slot = other.slot;
+  if (slot) {
+    pool->retain(slot);
+  }
+}
+
+FrameLease& FrameLease::operator=(const FrameLease& other) {
+  if (this != &other) {
+    if (other.slot) {
+      other.pool->retain(other.slot);
+    }
+    release();
+    pool = other.pool;
+    slot = other.slot;
+  }
+  return *this;
+}
+
+FrameLease::~FrameLease() {
+  release();
+}
+
+void FrameLease::release() {
+  if (slot) {
+    pool->release(slot);
+    slot = nullptr;
+    pool = nullptr;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// FramePool
+// ---------------------------------------------------------------------------
+
+FramePool::FramePool() {
+  slots = nullptr;
+  slotCount = 0;
+  slotSize = 0;
+  exhaustedCount = 0;
+}
+
+FramePool::~FramePool() {
+  if (slots) {
+    free(slots[0].data);
+    free(slots);
+  }
+}
+
+bool FramePool::begin(int count, size_t size) {
+  if (slots) {
+    return true;  // Already allocated
+  }
+
+  // One contiguous block keeps the heap layout fixed for the whole run
+  size_t total = (size_t)count * size;
+  uint8_t* block = psramFound() ? (uint8_t*)ps_malloc(total) : nullptr;
+  if (!block) {
+    block = (uint8_t*)malloc(total);
+  }
+  slots = (FrameSlot*)malloc(count * sizeof(FrameSlot));
+
+  if (!block || !slots) {
+    Serial.printf("ERROR: Failed to allocate frame pool (%d x %d bytes)\n", count, size);
+    free(block);
+    free(slots);
+    slots = nullptr;
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    slots[i].data = block + (size_t)i * size;
+    slots[i].capacity = size;
+    slots[i].offset = 0;
+    slots[i].size = 0;
+    slots[i].sequence = 0;
+    slots[i].receivedAt = 0;
+    slots[i].refCount = 0;
+  }
+
+  slotCount = count;
+  slotSize = size;
+
+  Serial.printf("✓ Frame pool allocated: %d slots x %d KB (%s)\n",
+                count, size / 1024, psramFound() ? "PSRAM" : "heap");
+  return true;
+}
+
+FrameSlot* FramePool::acquire() {
+  for (int i = 0; i < slotCount; i++) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&slots[i].refCount, &expected, 1, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      slots[i].offset = 0;
+      slots[i].size = 0;
+      return &slots[i];
+    }
+  }
+
+  exhaustedCount++;
+  return nullptr;
+}
+
+FrameLease FramePool::lease(FrameSlot* slot) {
+  retain(slot);
+  return FrameLease(this, slot);
+}
+
+void FramePool::retain(FrameSlot* slot) {
+  __atomic_add_fetch(&slot->refCount, 1, __ATOMIC_RELAXED);
+}
+
+void FramePool::release(FrameSlot* slot) {
+  __atomic_sub_fetch(&slot->refCount, 1, __ATOMIC_RELEASE);
+}
+
+int FramePool::getFreeSlots() {
+  int freeSlots = 0;
+  for (int i = 0; i < slotCount; i++) {
+    if (__atomic_load_n(&slots[i].refCount, __ATOMIC_RELAXED) == 0) {
+      freeSlots++;
+    }
+  }
+  return freeSlots;
+}
@@ -0,0 +1,100 @@
+/**
+ * Frame Pool Header
+ *
+ * Fixed set of PSRAM frame slots shared by the MJPEG parser and every
+ * consumer of a frame (detector, zone manager, web server).
+ * Slots are handed out as refcounted leases; a slot returns to the
+ * pool when its last lease is dropped, so frames are never copied
+ * and the heap does not fragment over long runs.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <Arduino.h>
+
+#define FRAME_POOL_SLOTS 5                // Parser + mailbox + processing + web server + spare
+#define FRAME_SLOTS_PER_CAMERA 3          // Parser, mailbox and web server slot of each further camera
+#define FRAME_SLOT_SIZE (100 * 1024)      // 100KB per slot (VGA JPEG + headers)
+
+class FramePool;
+
+/**
+ * Frame slot (owned by FramePool)
+ */
+struct FrameSlot {
+  uint8_t* data;      // Slot memory (FRAME_SLOT_SIZE bytes)
+  size_t capacity;    // Slot capacity in bytes
+  size_t offset;      // JPEG start within data
+  size_t size;        // JPEG size in bytes
+  uint32_t sequence;  // Frame sequence number
+  unsigned long receivedAt;  // millis() when the frame was completed
+  int refCount;       // Active leases (0 = free)
+};
+
+/**
+ * Frame Lease
+ *
+ * Refcounted handle to a pooled frame. Copying a lease adds a reader,
+ * destroying or releasing it drops one.
+ */
+class FrameLease {
+public:
+  FrameLease();
+  FrameLease(const FrameLease& other);
+  FrameLease& operator=(const FrameLease& other);
+  ~FrameLease();
+
+  // JPEG bytes (nullptr if lease is empty)
+  uint8_t* data() const { return slot ? slot->data + slot->offset : nullptr; }
+  size_t size() const { return slot ? slot->size : 0; }
+  uint32_t sequence() const { return slot ? slot->sequence : 0; }
+  unsigned long receivedAt() const { return slot ? slot->receivedAt : 0; }
+  bool valid() const { return slot != nullptr; }
+
+  // Drop this reader (slot is freed when the last lease is released)
+  void release();
+
+private:
+  friend class FramePool;
+  FrameLease(FramePool* pool, FrameSlot* slot);
+
+  FramePool* pool;
+  FrameSlot* slot;
+};
+
+/**
+ * Frame Pool Class
+ */
+class FramePool {
+public:
+  FramePool();
+  ~FramePool();
+
+  // Allocate slots (PSRAM when available)
+  bool begin(int slotCount = FRAME_POOL_SLOTS, size_t slotSize = FRAME_SLOT_SIZE);
+
+  // Take a free slot (refcount 1), or nullptr if all slots are leased
+  FrameSlot* acquire();
+
+  // Wrap a slot into a new reader lease
+  FrameLease lease(FrameSlot* slot);
+
+  // Reference counting (safe across cores)
+  void retain(FrameSlot* slot);
+  void release(FrameSlot* slot);
+
+  // Statistics
+  int getSlotCount() { return slotCount; }
+  int getFreeSlots();
+  size_t getSlotSize() { return slotSize; }
+  int getExhaustedCount() { return exhaustedCount; }
+
+private:
+  FrameSlot* slots;
+  int slotCount;
+  size_t slotSize;
+  int exhaustedCount;
+};
+
+#endif // FRAME_POOL_H
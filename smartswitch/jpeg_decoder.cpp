@@ -0,0 +1,912 @@
+/**
+ * Partial JPEG Decoder Implementation
+ *
+ * Baseline sequential JPEG only (SOF0/SOF1, huffman coded). The scan is
+ * huffman-decoded in full because AC terms must be consumed to find the
+ * next block, but AC values are skipped without being reconstructed.
+ */
+
+#include "jpeg_decoder.h"
+
+// Standard huffman tables (JPEG Annex K.3), used when a frame has no DHT
+// (common for MJPEG from IP cameras)
+static const uint8_t STD_DC_LUMA_COUNTS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t STD_DC_CHROMA_COUNTS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t STD_DC_VALUES[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t STD_AC_LUMA_COUNTS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t STD_AC_LUMA_VALUES[162] = {
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+  0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+  0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+  0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+  0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+  0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+  0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa
+};
+
+static const uint8_t STD_AC_CHROMA_COUNTS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t STD_AC_CHROMA_VALUES[162] = {
+  0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+  0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+  0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+  0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+  0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+  0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+  0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa
+};
+
+// Natural (row-major) position of each zigzag coefficient index
+static const uint8_t ZIGZAG[64] = {
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static inline uint16_t readU16(const uint8_t* p) {
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+// Write one pixel in the output format, returns the next position
+static inline uint8_t* storePixel(uint8_t* dst, JpegPixelFormat format, int y, int r, int g, int b) {
+  switch (format) {
+    case JPEG_GRAY8:
+      *dst = y;
+      return dst + 1;
+    case JPEG_RGB565:
+      *(uint16_t*)dst = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+      return dst + 2;
+    default:
+      dst[0] = r;
+      dst[1] = g;
+      dst[2] = b;
+      return dst + 3;
+  }
+}
+
+JpegDecoder::JpegDecoder() {
+  width = 0;
+  height = 0;
+  numComponents = 0;
+  maxH = 1;
+  maxV = 1;
+  restartInterval = 0;
+  scanComponents = 0;
+  pos = nullptr;
+  end = nullptr;
+  bitBuffer = 0;
+  bitCount = 0;
+  hitMarker = false;
+  error = "";
+  idctSize = 0;
+  idctZigzagLimit = 0;
+  memset(components, 0, sizeof(components));
+  memset(quant, 0, sizeof(quant));
+  for (int i = 0; i < 4; i++) {
+    dcTables[i].defined = false;
+    acTables[i].defined = false;
+  }
+}
+
+bool JpegDecoder::decodeLumaDC(const uint8_t* jpeg, size_t size, uint8_t* out,
+                               int maxWidth, int maxHeight, int* outWidth, int* outHeight) {
+  if (!parseHeaders(jpeg, size)) {
+    return false;
+  }
+
+  if (!checkLumaInScan()) {
+    return false;
+  }
+
+  int gridW = min((width + 7) / 8, maxWidth);
+  int gridH = min((height + 7) / 8, maxHeight);
+  *outWidth = gridW;
+  *outHeight = gridH;
+
+  // DC coefficient -> block mean: F(0,0) * q / 8 + 128
+  const int q0 = quant[components[0].quantTable][0];
+  resetBits();
+
+  if (scanComponents == 1) {
+    // Non-interleaved (grayscale): one block per MCU
+    JpegComponent& c = components[scanOrder[0]];
+    int compW = (width * c.h + maxH - 1) / maxH;
+    int compH = (height * c.v + maxV - 1) / maxV;
+    int blocksX = (compW + 7) / 8;
+    int blocksY = (compH + 7) / 8;
+    int mcu = 0;
+
+    for (int by = 0; by < blocksY; by++) {
+      for (int bx = 0; bx < blocksX; bx++, mcu++) {
+        if (restartInterval && mcu > 0 && mcu % restartInterval == 0 && !handleRestart()) {
+          return false;
+        }
+        int s = decodeHuffman(&dcTables[c.dcTable]);
+        if (s < 0 || s > JPEG_MAX_DC_BITS) {
+          error = "corrupt scan data";
+          return false;
+        }
+        c.dcPred += receiveExtend(s);
+        if (!skipAC(&acTables[c.acTable])) {
+          error = "corrupt scan data";
+          return false;
+        }
+        if (bx < gridW && by < gridH) {
+          int value = c.dcPred * q0 / 8 + 128;
+          out[by * gridW + bx] = (uint8_t)constrain(value, 0, 255);
+        }
+      }
+    }
+    return true;
+  }
+
+  // Interleaved: each MCU holds h x v blocks of every component
+  int mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+  int mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+  int mcu = 0;
+
+  for (int my = 0; my < mcusY; my++) {
+    for (int mx = 0; mx < mcusX; mx++, mcu++) {
+      if (restartInterval && mcu > 0 && mcu % restartInterval == 0 && !handleRestart()) {
+        return false;
+      }
+
+      for (int i = 0; i < scanComponents; i++) {
+        JpegComponent& c = components[scanOrder[i]];
+        const JpegHuffmanTable* dc = &dcTables[c.dcTable];
+        const JpegHuffmanTable* ac = &acTables[c.acTable];
+
+        for (int by = 0; by < c.v; by++) {
+          for (int bx = 0; bx < c.h; bx++) {
+            int s = decodeHuffman(dc);
+            if (s < 0 || s > JPEG_MAX_DC_BITS) {
+              error = "corrupt scan data";
+              return false;
+            }
+            c.dcPred += receiveExtend(s);
+            if (!skipAC(ac)) {
+              error = "corrupt scan data";
+              return false;
+            }
+
+            if (scanOrder[i] == 0) {
+              int blockX = mx * c.h + bx;
+              int blockY = my * c.v + by;
+              if (blockX < gridW && blockY < gridH) {
+                int value = c.dcPred * q0 / 8 + 128;
+                out[blockY * gridW + blockX] = (uint8_t)constrain(value, 0, 255);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool JpegDecoder::decode(const uint8_t* jpeg, size_t size, JpegScale scale, JpegPixelFormat format,
+                         uint8_t* out, size_t outSize, int* outWidth, int* outHeight) {
+  JpegRegion whole = {0, 0, 0, 0};
+  return decodeRegion(jpeg, size, scale, format, &whole, out, outSize, outWidth, outHeight);
+}
+
+bool JpegDecoder::decodeRegion(const uint8_t* jpeg, size_t size, JpegScale scale, JpegPixelFormat format,
+                               JpegRegion* region, uint8_t* out, size_t outSize, int* outWidth, int* outHeight) {
+  if (scale < JPEG_SCALE_FULL || scale > JPEG_SCALE_EIGHTH) {
+    error = "unsupported scale";
+    return false;
+  }
+  if (!parseHeaders(jpeg, size) || !checkLumaInScan()) {
+    return false;
+  }
+
+  // Expand the region to whole MCUs (8x8 blocks for a non-interleaved scan)
+  const int unitW = scanComponents == 1 ? 8 : 8 * maxH;
+  const int unitH = scanComponents == 1 ? 8 : 8 * maxV;
+  const int unitsX = (width + unitW - 1) / unitW;
+  const int unitsY = (height + unitH - 1) / unitH;
+  int ux0 = 0;
+  int uy0 = 0;
+  int ux1 = unitsX;
+  int uy1 = unitsY;
+  if (region->width > 0 && region->height > 0) {
+    ux0 = constrain(region->x / unitW, 0, unitsX - 1);
+    uy0 = constrain(region->y / unitH, 0, unitsY - 1);
+    ux1 = constrain((region->x + region->width + unitW - 1) / unitW, ux0 + 1, unitsX);
+    uy1 = constrain((region->y + region->height + unitH - 1) / unitH, uy0 + 1, unitsY);
+  }
+  region->x = ux0 * unitW;
+  region->y = uy0 * unitH;
+  region->width = min(ux1 * unitW, width) - region->x;
+  region->height = min(uy1 * unitH, height) - region->y;
+
+  int w = scaledSize(region->width, scale);
+  int h = scaledSize(region->height, scale);
+  if (!out || outSize < (size_t)w * h * bytesPerPixel(format)) {
+    error = "output buffer too small";
+    return false;
+  }
+  *outWidth = w;
+  *outHeight = h;
+
+  const int n = 8 >> scale;
+  prepareIdct(n);
+
+  // Chroma is only reconstructed for colour output of interleaved YCbCr
+  bool color = format != JPEG_GRAY8 && numComponents == 3 && scanComponents == 3;
+  int32_t coef[64];
+  resetBits();
+
+  if (scanComponents == 1) {
+    // Non-interleaved (grayscale): one block per MCU, written straight out
+    JpegComponent& c = components[scanOrder[0]];
+    int compW = (width * c.h + maxH - 1) / maxH;
+    int compH = (height * c.v + maxV - 1) / maxV;
+    int blocksX = (compW + 7) / 8;
+    int blocksY = min((compH + 7) / 8, uy1);   // Nothing below the region is needed
+    int mcu = 0;
+
+    for (int by = 0; by < blocksY; by++) {
+      for (int bx = 0; bx < blocksX; bx++, mcu++) {
+        if (restartInterval && mcu > 0 && mcu % restartInterval == 0 && !handleRestart()) {
+          return false;
+        }
+        bool inside = scanOrder[0] == 0 && by >= uy0 && bx >= ux0 && bx < ux1;
+        if (!inside) {
+          if (!skipBlock(c)) {
+            return false;
+          }
+          continue;
+        }
+        if (!decodeBlock(c, coef)) {
+          return false;
+        }
+
+        idctBlock(coef, mcuPlanes[0], n);
+        const int bpp = bytesPerPixel(format);
+        const int ox = (bx - ux0) * n;
+        const int oy = (by - uy0) * n;
+        for (int py = 0; py < n && oy + py < h; py++) {
+          uint8_t* dst = out + ((size_t)(oy + py) * w + ox) * bpp;
+          for (int px = 0; px < n && ox + px < w; px++) {
+            uint8_t y = mcuPlanes[0][py * n + px];
+            dst = storePixel(dst, format, y, y, y, y);
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // Interleaved: each MCU holds h x v blocks of every component
+  int mcusX = unitsX;
+  int mcusY = uy1;   // Nothing below the region is needed
+  int mcu = 0;
+
+  for (int my = 0; my < mcusY; my++) {
+    for (int mx = 0; mx < mcusX; mx++, mcu++) {
+      if (restartInterval && mcu > 0 && mcu % restartInterval == 0 && !handleRestart()) {
+        return false;
+      }
+      bool inside = my >= uy0 && mx >= ux0 && mx < ux1;
+
+      for (int i = 0; i < scanComponents; i++) {
+        int index = scanOrder[i];
+        JpegComponent& c = components[index];
+        bool needed = inside && (index == 0 || color);
+        int stride = c.h * n;
+
+        for (int by = 0; by < c.v; by++) {
+          for (int bx = 0; bx < c.h; bx++) {
+            if (!needed) {
+              if (!skipBlock(c)) {
+                return false;
+              }
+              continue;
+            }
+            if (!decodeBlock(c, coef)) {
+              return false;
+            }
+            idctBlock(coef, mcuPlanes[index] + by * n * stride + bx * n, stride);
+          }
+        }
+      }
+
+      if (inside) {
+        writeMCU(mx - ux0, my - uy0, format, color, out, w, h);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool JpegDecoder::readInfo(const uint8_t* jpeg, size_t size, int* imageWidth, int* imageHeight) {
+  if (!parseHeaders(jpeg, size)) {
+    return false;
+  }
+  *imageWidth = width;
+  *imageHeight = height;
+  return true;
+}
+
+bool JpegDecoder::checkLumaInScan() {
+  // Luma (first frame component) must be part of the first scan
+  for (int i = 0; i < scanComponents; i++) {
+    if (scanOrder[i] == 0) {
+      return true;
+    }
+  }
+  error = "first scan has no luma";
+  return false;
+}
+
+/**
+ * Build the NxN IDCT basis. The top-left NxN coefficients of an 8x8 DCT,
+ * scaled by N/8, are the DCT of the block averaged down to NxN:
+ *   f(x) = sum_u c(u) * sqrt(N/8) * F(u) * cos((2x+1) u pi / 2N)
+ */
+void JpegDecoder::prepareIdct(int size) {
+  if (idctSize == size) {
+    return;
+  }
+  idctSize = size;
+
+  for (int x = 0; x < size; x++) {
+    for (int u = 0; u < size; u++) {
+      double c = u == 0 ? sqrt(1.0 / size) : sqrt(2.0 / size);
+      double basis = c * sqrt(size / 8.0) * cos((2 * x + 1) * u * PI / (2 * size));
+      idctBasis[x][u] = (int16_t)lround(basis * (1 << JPEG_IDCT_BITS));
+    }
+  }
+
+  // Coefficients past this zigzag index never land inside the NxN corner
+  idctZigzagLimit = 0;
+  for (int k = 0; k < 64; k++) {
+    if ((ZIGZAG[k] & 7) < size && (ZIGZAG[k] >> 3) < size) {
+      idctZigzagLimit = k;
+    }
+  }
+}
+
+/**
+ * Consume one block outside the output, keeping only the DC predictor
+ */
+bool JpegDecoder::skipBlock(JpegComponent& c) {
+  int s = decodeHuffman(&dcTables[c.dcTable]);
+  if (s < 0 || s > JPEG_MAX_DC_BITS) {
+    error = "corrupt scan data";
+    return false;
+  }
+  c.dcPred += receiveExtend(s);
+  if (!skipAC(&acTables[c.acTable])) {
+    error = "corrupt scan data";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Decode one block, keeping (dequantized) only the NxN low-frequency corner
+ */
+bool JpegDecoder::decodeBlock(JpegComponent& c, int32_t* coef) {
+  const uint16_t* q = quant[c.quantTable];
+  const JpegHuffmanTable* ac = &acTables[c.acTable];
+  const int n = idctSize;
+
+  int s = decodeHuffman(&dcTables[c.dcTable]);
+  if (s < 0 || s > JPEG_MAX_DC_BITS) {
+    error = "corrupt scan data";
+    return false;
+  }
+  c.dcPred += receiveExtend(s);
+
+  for (int row = 0; row < n; row++) {
+    memset(coef + row * 8, 0, n * sizeof(int32_t));
+  }
+  // Valid 8-bit data stays well inside +-4095; clamping keeps the IDCT from overflowing
+  coef[0] = constrain(c.dcPred * q[0], -4095, 4095);
+
+  for (int k = 1; k < 64; k++) {
+    int rs = decodeHuffman(ac);
+    if (rs < 0) {
+      error = "corrupt scan data";
+      return false;
+    }
+    int run = rs >> 4;
+    s = rs & 0x0F;
+
+    if (s == 0) {
+      if (run != 15) {
+        break;  // End of block
+      }
+      k += 15;  // ZRL: 16 zeros
+      continue;
+    }
+
+    k += run;
+    if (k > 63) {
+      error = "corrupt scan data";
+      return false;
+    }
+    if (k <= idctZigzagLimit) {
+      int pos = ZIGZAG[k];
+      int value = receiveExtend(s);
+      if ((pos & 7) < n && (pos >> 3) < n) {
+        coef[pos] = constrain(value * q[k], -4095, 4095);
+      }
+    } else {
+      getBits(s);
+    }
+  }
+  return true;
+}
+
+/**
+ * Separable NxN IDCT of the corner coefficients into out (row stride)
+ */
+void JpegDecoder::idctBlock(const int32_t* coef, uint8_t* out, int stride) {
+  const int n = idctSize;
+
+  if (n == 1) {
+    out[0] = (uint8_t)constrain(coef[0] / 8 + 128, 0, 255);
+    return;
+  }
+
+  // Rows: tmp[v][x] = sum_u F[v][u] * B[x][u]
+  int32_t tmp[64];
+  for (int v = 0; v < n; v++) {
+    const int32_t* row = coef + v * 8;
+    for (int x = 0; x < n; x++) {
+      int32_t sum = 0;
+      for (int u = 0; u < n; u++) {
+        sum += row[u] * idctBasis[x][u];
+      }
+      tmp[v * 8 + x] = sum >> JPEG_IDCT_BITS;
+    }
+  }
+
+  // Columns: out[y][x] = sum_v tmp[v][x] * B[y][v]
+  for (int y = 0; y < n; y++) {
+    for (int x = 0; x < n; x++) {
+      int32_t sum = 0;
+      for (int v = 0; v < n; v++) {
+        sum += tmp[v * 8 + x] * idctBasis[y][v];
+      }
+      int value = ((sum + (1 << (JPEG_IDCT_BITS - 1))) >> JPEG_IDCT_BITS) + 128;
+      out[y * stride + x] = (uint8_t)constrain(value, 0, 255);
+    }
+  }
+}
+
+/**
+ * Convert one decoded MCU to the output format (chroma nearest-upsampled)
+ */
+void JpegDecoder::writeMCU(int mx, int my, JpegPixelFormat format, bool color,
+                           uint8_t* out, int outWidth, int outHeight) {
+  const int n = idctSize;
+  const int mcuW = maxH * n;
+  const int mcuH = maxV * n;
+  const int x0 = mx * mcuW;
+  const int y0 = my * mcuH;
+  const int bpp = bytesPerPixel(format);
+  const JpegComponent& luma = components[0];
+
+  for (int py = 0; py < mcuH && y0 + py < outHeight; py++) {
+    const uint8_t* lumaRow = mcuPlanes[0] + (py * luma.v / maxV) * (luma.h * n);
+    const uint8_t* cbRow = nullptr;
+    const uint8_t* crRow = nullptr;
+    if (color) {
+      cbRow = mcuPlanes[1] + (py * components[1].v / maxV) * (components[1].h * n);
+      crRow = mcuPlanes[2] + (py * components[2].v / maxV) * (components[2].h * n);
+    }
+    uint8_t* dst = out + ((size_t)(y0 + py) * outWidth + x0) * bpp;
+
+    for (int px = 0; px < mcuW && x0 + px < outWidth; px++) {
+      int y = lumaRow[px * luma.h / maxH];
+      int r = y;
+      int g = y;
+      int b = y;
+
+      if (color) {
+        int cb = cbRow[px * components[1].h / maxH] - 128;
+        int cr = crRow[px * components[2].h / maxH] - 128;
+        // BT.601 full range, 16-bit fixed point
+        r = constrain(y + ((91881 * cr) >> 16), 0, 255);
+        g = constrain(y - ((22554 * cb + 46802 * cr) >> 16), 0, 255);
+        b = constrain(y + ((116130 * cb) >> 16), 0, 255);
+      }
+
+      dst = storePixel(dst, format, y, r, g, b);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Marker parsing
+// ---------------------------------------------------------------------------
+
+bool JpegDecoder::parseHeaders(const uint8_t* jpeg, size_t size) {
+  const uint8_t* p = jpeg;
+  const uint8_t* e = jpeg + size;
+  bool haveFrame = false;
+
+  if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+    error = "missing SOI marker";
+    return false;
+  }
+  p += 2;
+
+  restartInterval = 0;
+  for (int i = 0; i < 4; i++) {
+    dcTables[i].defined = false;
+    acTables[i].defined = false;
+  }
+
+  while (p + 4 <= e) {
+    if (p[0] != 0xFF) {
+      error = "bad marker";
+      return false;
+    }
+    uint8_t marker = p[1];
+    if (marker == 0xFF) {
+      p++;  // Fill byte
+      continue;
+    }
+
+    int len = readU16(p + 2);
+    const uint8_t* segment = p + 4;
+    if (len < 2 || segment + len - 2 > e) {
+      error = "truncated segment";
+      return false;
+    }
+
+    switch (marker) {
+      case 0xDB:  // DQT
+        if (!parseDQT(segment, len - 2)) return false;
+        break;
+      case 0xC0:  // SOF0 baseline
+      case 0xC1:  // SOF1 extended sequential, huffman
+        if (!parseSOF(segment, len - 2)) return false;
+        haveFrame = true;
+        break;
+      case 0xC2:
+      case 0xC3:
+      case 0xC9:
+      case 0xCA:
+        error = "progressive/lossless/arithmetic JPEG not supported";
+        return false;
+      case 0xC4:  // DHT
+        if (!parseDHT(segment, len - 2)) return false;
+        break;
+      case 0xDD:  // DRI
+        if (len < 4) {
+          error = "bad DRI";
+          return false;
+        }
+        restartInterval = readU16(segment);
+        break;
+      case 0xDA:  // SOS - entropy coded data follows the segment
+        if (!haveFrame) {
+          error = "SOS before SOF";
+          return false;
+        }
+        if (!parseSOS(segment, len - 2)) return false;
+        pos = segment + len - 2;
+        end = e;
+        return true;
+      case 0xD9:  // EOI
+        error = "EOI before scan";
+        return false;
+      default:
+        break;  // APPn, COM, ... skipped
+    }
+
+    p = segment + len - 2;
+  }
+
+  error = "no scan found";
+  return false;
+}
+
+bool JpegDecoder::parseDQT(const uint8_t* p, int len) {
+  while (len > 0) {
+    int precision = p[0] >> 4;
+    int id = p[0] & 0x0F;
+    int tableLen = 1 + (precision ? 128 : 64);
+    if (id > 3 || tableLen > len) {
+      error = "bad DQT";
+      return false;
+    }
+    for (int i = 0; i < 64; i++) {
+      quant[id][i] = precision ? readU16(p + 1 + i * 2) : p[1 + i];
+    }
+    p += tableLen;
+    len -= tableLen;
+  }
+  return true;
+}
+
+bool JpegDecoder::parseSOF(const uint8_t* p, int len) {
+  if (len < 6 || p[0] != 8) {
+    error = "unsupported sample precision";
+    return false;
+  }
+
+  height = readU16(p + 1);
+  width = readU16(p + 3);
+  numComponents = p[5];
+
+  if (width == 0 || height == 0 || numComponents < 1 ||
+      numComponents > JPEG_MAX_COMPONENTS || len < 6 + numComponents * 3) {
+    error = "bad SOF";
+    return false;
+  }
+
+  maxH = 1;
+  maxV = 1;
+  for (int i = 0; i < numComponents; i++) {
+    const uint8_t* c = p + 6 + i * 3;
+    components[i].id = c[0];
+    components[i].h = c[1] >> 4;
+    components[i].v = c[1] & 0x0F;
+    components[i].quantTable = c[2] & 0x03;
+    if (components[i].h < 1 || components[i].h > 4 || components[i].v < 1 || components[i].v > 4) {
+      error = "bad sampling factors";
+      return false;
+    }
+    maxH = max(maxH, (int)components[i].h);
+    maxV = max(maxV, (int)components[i].v);
+  }
+  return true;
+}
+
+bool JpegDecoder::parseDHT(const uint8_t* p, int len) {
+  while (len >= 17) {
+    int tableClass = p[0] >> 4;
+    int id = p[0] & 0x0F;
+    const uint8_t* counts = p + 1;
+
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+      total += counts[i];
+    }
+    if (id > 3 || total > 256 || 17 + total > len) {
+      error = "bad DHT";
+      return false;
+    }
+
+    if (!buildHuffmanTable(tableClass == 0 ? &dcTables[id] : &acTables[id], counts, p + 17)) {
+      error = "bad DHT";
+      return false;
+    }
+    p += 17 + total;
+    len -= 17 + total;
+  }
+  return true;
+}
+
+bool JpegDecoder::parseSOS(const uint8_t* p, int len) {
+  if (len < 1) {
+    error = "bad SOS";
+    return false;
+  }
+  scanComponents = p[0];
+  if (scanComponents < 1 || scanComponents > numComponents || len < 1 + scanComponents * 2 + 3) {
+    error = "bad SOS";
+    return false;
+  }
+
+  for (int i = 0; i < scanComponents; i++) {
+    uint8_t id = p[1 + i * 2];
+    uint8_t tables = p[2 + i * 2];
+    int index = -1;
+    for (int j = 0; j < numComponents; j++) {
+      if (components[j].id == id) {
+        index = j;
+      }
+    }
+    if (index < 0) {
+      error = "SOS references unknown component";
+      return false;
+    }
+
+    JpegComponent& c = components[index];
+    c.dcTable = (tables >> 4) & 0x03;
+    c.acTable = tables & 0x03;
+    c.dcPred = 0;
+    scanOrder[i] = index;
+
+    // Frames without DHT use the standard tables
+    if (!dcTables[c.dcTable].defined) {
+      buildHuffmanTable(&dcTables[c.dcTable],
+                        c.dcTable == 0 ? STD_DC_LUMA_COUNTS : STD_DC_CHROMA_COUNTS, STD_DC_VALUES);
+    }
+    if (!acTables[c.acTable].defined) {
+      if (c.acTable == 0) {
+        buildHuffmanTable(&acTables[c.acTable], STD_AC_LUMA_COUNTS, STD_AC_LUMA_VALUES);
+      } else {
+        buildHuffmanTable(&acTables[c.acTable], STD_AC_CHROMA_COUNTS, STD_AC_CHROMA_VALUES);
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Canonical codes from a DHT; false (table left undefined) if the counts
+ * overflow their code lengths
+ */
+bool JpegDecoder::buildHuffmanTable(JpegHuffmanTable* table, const uint8_t* counts, const uint8_t* symbols) {
+  memset(table->lookup, 0, sizeof(table->lookup));
+  table->defined = false;
+
+  int code = 0;
+  int k = 0;
+  for (int length = 1; length <= 16; length++) {
+    int n = counts[length - 1];
+    if (code + n >= (1 << length)) {
+      return false;   // Codes no longer fit (the all-ones code is reserved)
+    }
+    table->valueOffset[length] = k - code;
+
+    for (int i = 0; i < n; i++, code++, k++) {
+      table->values[k] = symbols[k];
+
+      // Short codes: fill every lookup entry that starts with this code
+      if (length <= JPEG_HUFF_LOOKUP_BITS) {
+        int shift = JPEG_HUFF_LOOKUP_BITS - length;
+        uint16_t entry = (length << 8) | symbols[k];
+        for (int j = 0; j < (1 << shift); j++) {
+          table->lookup[(code << shift) | j] = entry;
+        }
+      }
+    }
+
+    table->maxCode[length] = n ? code - 1 : -1;
+    code <<= 1;
+  }
+  table->maxCode[17] = 0x7FFFFFFF;  // Sentinel
+  table->defined = true;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Entropy decoding
+// ---------------------------------------------------------------------------
+
+void JpegDecoder::resetBits() {
+  bitBuffer = 0;
+  bitCount = 0;
+  hitMarker = false;
+}
+
+/**
+ * Top up the bit buffer to at least 25 bits, removing 0xFF00 stuffing.
+ * At a marker (or end of data) zeros are shifted in instead.
+ */
+void JpegDecoder::fillBits() {
+  while (bitCount <= 24) {
+    uint32_t byte = 0;
+    if (!hitMarker && pos < end) {
+      byte = *pos++;
+      if (byte == 0xFF) {
+        if (pos < end && *pos == 0x00) {
+          pos++;
+        } else {
+          hitMarker = true;  // Leave the marker for handleRestart()
+          pos--;
+          byte = 0;
+        }
+      }
+    }
+    bitBuffer |= byte << (24 - bitCount);
+    bitCount += 8;
+  }
+}
+
+int JpegDecoder::getBits(int n) {
+  if (n == 0) {
+    return 0;
+  }
+  fillBits();
+  int value = bitBuffer >> (32 - n);
+  bitBuffer <<= n;
+  bitCount -= n;
+  return value;
+}
+
+int JpegDecoder::decodeHuffman(const JpegHuffmanTable* table) {
+  fillBits();
+
+  uint16_t entry = table->lookup[bitBuffer >> (32 - JPEG_HUFF_LOOKUP_BITS)];
+  if (entry) {
+    int length = entry >> 8;
+    bitBuffer <<= length;
+    bitCount -= length;
+    return entry & 0xFF;
+  }
+
+  // Long code: walk lengths past the lookup table
+  int length = JPEG_HUFF_LOOKUP_BITS + 1;
+  int32_t code = bitBuffer >> (32 - length);
+  while (length <= 16 && code > table->maxCode[length]) {
+    length++;
+    code = bitBuffer >> (32 - length);
+  }
+  if (length > 16) {
+    return -1;
+  }
+
+  bitBuffer <<= length;
+  bitCount -= length;
+  return table->values[table->valueOffset[length] + code];
+}
+
+int JpegDecoder::receiveExtend(int s) {
+  if (s == 0) {
+    return 0;
+  }
+  int value = getBits(s);
+  if (value < (1 << (s - 1))) {
+    value -= (1 << s) - 1;
+  }
+  return value;
+}
+
+/**
+ * Consume the 63 AC coefficients of a block without reconstructing them
+ */
+bool JpegDecoder::skipAC(const JpegHuffmanTable* table) {
+  for (int k = 1; k < 64; k++) {
+    int rs = decodeHuffman(table);
+    if (rs < 0) {
+      return false;
+    }
+    int run = rs >> 4;
+    int s = rs & 0x0F;
+
+    if (s == 0) {
+      if (run != 15) {
+        break;  // End of block
+      }
+      k += 15;  // ZRL: 16 zeros
+    } else {
+      k += run;
+      getBits(s);
+    }
+  }
+  return true;
+}
+
+/**
+ * Restart marker: discard remaining bits, skip RSTn and reset predictors
+ */
+bool JpegDecoder::handleRestart() {
+  resetBits();
+
+  while (pos + 1 < end && !(pos[0] == 0xFF && pos[1] >= 0xD0 && pos[1] <= 0xD7)) {
+    pos++;
+  }
+  if (pos + 1 >= end) {
+    error = "missing restart marker";
+    return false;
+  }
+  pos += 2;
+
+  for (int i = 0; i < numComponents; i++) {
+    components[i].dcPred = 0;
+  }
+  return true;
+}
@@ -0,0 +1,173 @@
+/**
+ * Partial JPEG Decoder Header
+ *
+ * Minimal baseline (huffman) JPEG decoder for analysis, not display.
+ * - decodeLumaDC(): only the luma DC coefficient of each 8x8 block,
+ *   giving a 1/8 scale grayscale image without AC terms or IDCT
+ * - decode(): MCU by MCU into a caller buffer at 1/1, 1/2, 1/4 or 1/8
+ *   scale using a reduced-size IDCT (only the low-frequency NxN
+ *   coefficients are used), as grayscale, RGB565 or RGB888
+ * - decodeRegion(): the same for a crop, reconstructing only its MCUs
+ */
+
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <Arduino.h>
+
+#define JPEG_MAX_COMPONENTS 3
+#define JPEG_HUFF_LOOKUP_BITS 9   // Codes up to 9 bits decode with one table lookup
+#define JPEG_IDCT_BITS 11         // Fixed point fraction bits of the IDCT basis
+#define JPEG_MAX_DC_BITS 11       // Largest DC difference category (8-bit samples)
+
+/**
+ * Output scale (power of two reduction)
+ */
+enum JpegScale {
+  JPEG_SCALE_FULL = 0,
+  JPEG_SCALE_HALF = 1,
+  JPEG_SCALE_QUARTER = 2,
+  JPEG_SCALE_EIGHTH = 3
+};
+
+/**
+ * Output pixel format
+ */
+enum JpegPixelFormat {
+  JPEG_GRAY8,     // 1 byte per pixel (luma only, chroma never reconstructed)
+  JPEG_RGB565,    // Native-endian uint16_t per pixel
+  JPEG_RGB888     // R, G, B bytes
+};
+
+/**
+ * Source rectangle of a region decode (full-size image pixels)
+ */
+struct JpegRegion {
+  int x;
+  int y;
+  int width;      // 0 = whole image
+  int height;
+};
+
+/**
+ * Huffman table (canonical codes, JPEG Annex C)
+ */
+struct JpegHuffmanTable {
+  uint16_t lookup[1 << JPEG_HUFF_LOOKUP_BITS];  // (length << 8) | symbol, 0 = long code
+  int32_t maxCode[18];      // Largest code of each length (-1 = none)
+  int32_t valueOffset[18];  // Index of first symbol of each length minus its code
+  uint8_t values[256];
+  bool defined;
+};
+
+/**
+ * Frame component (from SOF and SOS)
+ */
+struct JpegComponent {
+  uint8_t id;
+  uint8_t h;            // Horizontal sampling factor
+  uint8_t v;            // Vertical sampling factor
+  uint8_t quantTable;
+  uint8_t dcTable;
+  uint8_t acTable;
+  int dcPred;           // DC predictor (reset at restart markers)
+};
+
+/**
+ * Partial JPEG Decoder Class
+ */
+class JpegDecoder {
+public:
+  JpegDecoder();
+
+  // Decode luma DC of every block into out (1/8 scale grayscale, row-major).
+  // Grid larger than maxWidth x maxHeight is clipped; actual size is returned.
+  bool decodeLumaDC(const uint8_t* jpeg, size_t size, uint8_t* out,
+                    int maxWidth, int maxHeight, int* outWidth, int* outHeight);
+
+  // Decode into out at 1/2^scale size; out must hold
+  // scaledSize(width) * scaledSize(height) pixels of the given format
+  bool decode(const uint8_t* jpeg, size_t size, JpegScale scale, JpegPixelFormat format,
+              uint8_t* out, size_t outSize, int* outWidth, int* outHeight);
+  
+  // Decode only the MCUs covering region, which is widened to MCU bounds
+  // and returned; blocks outside are entropy-decoded but not reconstructed,
+  // and the scan stops after the region's last MCU row
+  bool decodeRegion(const uint8_t* jpeg, size_t size, JpegScale scale, JpegPixelFormat format,
+                    JpegRegion* region, uint8_t* out, size_t outSize, int* outWidth, int* outHeight);
+  
+  // Read image size without decoding
+  bool readInfo(const uint8_t* jpeg, size_t size, int* imageWidth, int* imageHeight);
+  
+  // Output dimension for a scale (rounded up)
+  static int scaledSize(int size, JpegScale scale) { return (size + (1 << scale) - 1) >> scale; }
+  
+  // Bytes per pixel of a format
+  static int bytesPerPixel(JpegPixelFormat format) { return format == JPEG_GRAY8 ? 1 : (format == JPEG_RGB565 ? 2 : 3); }
+  
+  // Image size from the last parsed SOF
+  int getWidth() { return width; }
+  int getHeight() { return height; }
+
+  // Reason for the last failure
+  const char* getError() { return error; }
+
+private:
+  // Image info
+  int width;
+  int height;
+  int numComponents;
+  int maxH;
+  int maxV;
+  int restartInterval;
+  JpegComponent components[JPEG_MAX_COMPONENTS];
+  uint16_t quant[4][64];    // Quantization tables (zigzag order)
+  JpegHuffmanTable dcTables[4];
+  JpegHuffmanTable acTables[4];
+
+  // Current scan
+  int scanComponents;
+  int scanOrder[JPEG_MAX_COMPONENTS];  // Indices into components[]
+
+  // Scaled IDCT (basis for the current output block size)
+  int idctSize;                 // Output block size (8 >> scale)
+  int idctZigzagLimit;          // Last zigzag index inside the NxN corner
+  int16_t idctBasis[8][8];      // [x][u], JPEG_IDCT_BITS fraction bits
+  uint8_t mcuPlanes[JPEG_MAX_COMPONENTS][32 * 32];  // One decoded MCU per component
+  
+  // Entropy decoder state
+  const uint8_t* pos;
+  const uint8_t* end;
+  uint32_t bitBuffer;
+  int bitCount;
+  bool hitMarker;
+  const char* error;
+
+  // Marker parsing
+  bool parseHeaders(const uint8_t* jpeg, size_t size);
+  bool parseDQT(const uint8_t* p, int len);
+  bool parseSOF(const uint8_t* p, int len);
+  bool parseDHT(const uint8_t* p, int len);
+  bool parseSOS(const uint8_t* p, int len);
+  bool buildHuffmanTable(JpegHuffmanTable* table, const uint8_t* counts, const uint8_t* symbols);
+
+  // Entropy decoding
+  void resetBits();
+  void fillBits();
+  int getBits(int n);
+  int decodeHuffman(const JpegHuffmanTable* table);
+  int receiveExtend(int s);
+  bool skipAC(const JpegHuffmanTable* table);
+  bool handleRestart();
+  
+  // Scaled decode
+  bool checkLumaInScan();
+  void prepareIdct(int size);
+  bool decodeBlock(JpegComponent& c, int32_t* coef);
+  bool skipBlock(JpegComponent& c);
+  void idctBlock(const int32_t* coef, uint8_t* out, int stride);
+  void writeMCU(int mx, int my, JpegPixelFormat format, bool color,
+                uint8_t* out, int outWidth, int outHeight);
+};
+
+#endif // JPEG_DECODER_H
@@ -0,0 +1,115 @@
+/**
+ * Metrics Implementation
+ */
+
+#include "metrics.h"
+
+Metrics metrics;
+
+// Bucket upper bounds (microseconds)
+static const uint32_t BUCKET_BOUNDS[METRIC_BUCKETS] = {
+  100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+};
+
+static const char* STAGE_NAMES[STAGE_COUNT] = {
+  "tcp_read", "parse", "motion", "inference", "zone_update", "ws_broadcast", "frame_total"
+};
+
+Metrics::Metrics() {
+  memset(stages, 0, sizeof(stages));
+  memset(counters, 0, sizeof(counters));
+  mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void Metrics::recordDuration(MetricStage stage, int64_t durationUs) {
+  if (durationUs < 0) {
+    durationUs = 0;
+  }
+  
+  int bucket = 0;
+  while (bucket < METRIC_BUCKETS && durationUs > BUCKET_BOUNDS[bucket]) {
+    bucket++;
+  }
+  
+  portENTER_CRITICAL(&mux);
+  LatencyHistogram& h = stages[stage];
+  h.buckets[bucket]++;
+  h.sumUs += durationUs;
+  h.count++;
+  portEXIT_CRITICAL(&mux);
+}
+
+void Metrics::count(MetricCounter counter, uint32_t n) {
+  portENTER_CRITICAL(&mux);
+  counters[counter] += n;
+  portEXIT_CRITICAL(&mux);
+}
+
+LatencyHistogram Metrics::getHistogram(MetricStage stage) {
+  portENTER_CRITICAL(&mux);
+  LatencyHistogram h = stages[stage];
+  portEXIT_CRITICAL(&mux);
+  return h;
+}
+
+const char* Metrics::getStageName(MetricStage stage) {
+  return STAGE_NAMES[stage];
+}
+
+uint32_t Metrics::getBucketBound(int bucket) {
+  return BUCKET_BOUNDS[bucket];
+}
+
+void Metrics::writePrometheus(Print& out) {
+  // Copy under the lock, format without it
+  LatencyHistogram snapshot[STAGE_COUNT];
+  uint32_t counterSnapshot[COUNTER_COUNT];
+  portENTER_CRITICAL(&mux);
+  memcpy(snapshot, stages, sizeof(snapshot));
+  memcpy(counterSnapshot, counters, sizeof(counterSnapshot));
+  portEXIT_CRITICAL(&mux);
+  
+  out.print("# HELP smartswitch_stage_seconds Pipeline stage latency\n");
+  out.print("# TYPE smartswitch_stage_seconds histogram\n");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const LatencyHistogram& h = snapshot[s];
+    uint32_t cumulative = 0;
+    for (int b = 0; b < METRIC_BUCKETS; b++) {
+      cumulative += h.buckets[b];
+      out.printf("smartswitch_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %u\n",
+                 STAGE_NAMES[s], BUCKET_BOUNDS[b] / 1e6, (unsigned)cumulative);
+    }
+    out.printf("smartswitch_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", STAGE_NAMES[s], (unsigned)h.count);
+    out.printf("smartswitch_stage_seconds_sum{stage=\"%s\"} %.6f\n", STAGE_NAMES[s], h.sumUs / 1e6);
+    out.printf("smartswitch_stage_seconds_count{stage=\"%s\"} %u\n", STAGE_NAMES[s], (unsigned)h.count);
+  }
+  
+  out.print("# TYPE smartswitch_frames_processed_total counter\n");
+  out.printf("smartswitch_frames_processed_total %u\n", (unsigned)counterSnapshot[COUNTER_FRAMES_PROCESSED]);
+  out.print("# HELP smartswitch_frames_dropped_total Frames dropped before reaching their consumer\n");
+  out.print("# TYPE smartswitch_frames_dropped_total counter\n");
+  out.printf("smartswitch_frames_dropped_total{reason=\"stale\"} %u\n", (unsigned)counterSnapshot[COUNTER_FRAMES_STALE]);
+  out.printf("smartswitch_frames_dropped_total{reason=\"pool\"} %u\n", (unsigned)counterSnapshot[COUNTER_FRAMES_POOL_DROPPED]);
+  out.printf("smartswitch_frames_dropped_total{reason=\"ws_queue\"} %u\n", (unsigned)counterSnapshot[COUNTER_WS_FRAMES_DROPPED]);
+  
+  // Memory gauges (fragmentation = 1 - largest free block / free bytes)
+  uint32_t heapFree = ESP.getFreeHeap();
+  uint32_t psramFree = ESP.getFreePsram();
+  out.print("# TYPE smartswitch_heap_free_bytes gauge\n");
+  out.printf("smartswitch_heap_free_bytes %u\n", (unsigned)heapFree);
+  out.print("# HELP smartswitch_heap_min_free_bytes Heap low-water mark since boot\n");
+  out.print("# TYPE smartswitch_heap_min_free_bytes gauge\n");
+  out.printf("smartswitch_heap_min_free_bytes %u\n", (unsigned)ESP.getMinFreeHeap());
+  out.print("# TYPE smartswitch_heap_fragmentation_ratio gauge\n");
+  out.printf("smartswitch_heap_fragmentation_ratio %.3f\n",
+             heapFree ? 1.0 - (double)ESP.getMaxAllocHeap() / heapFree : 0.0);
+  out.print("# TYPE smartswitch_psram_free_bytes gauge\n");
+  out.printf("smartswitch_psram_free_bytes %u\n", (unsigned)psramFree);
+  out.print("# TYPE smartswitch_psram_min_free_bytes gauge\n");
+  out.printf("smartswitch_psram_min_free_bytes %u\n", (unsigned)ESP.getMinFreePsram());
+  out.print("# TYPE smartswitch_psram_fragmentation_ratio gauge\n");
+  out.printf("smartswitch_psram_fragmentation_ratio %.3f\n",
+             psramFree ? 1.0 - (double)ESP.getMaxAllocPsram() / psramFree : 0.0);
+  out.print("# TYPE smartswitch_uptime_seconds gauge\n");
+  out.printf("smartswitch_uptime_seconds %lu\n", millis() / 1000);
+}
@@ -0,0 +1,93 @@
+/**
+ * Metrics Header
+ *
+ * Fixed-bucket latency histograms for each stage of the frame pipeline
+ * plus drop counters, timed with esp_timer_get_time(). Recording is a
+ * bucket search and three additions under a spinlock, cheap enough for
+ * every frame. Exported in Prometheus text format at /api/metrics.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+#define METRIC_BUCKETS 12   // Finite histogram buckets (plus +Inf)
+
+/**
+ * Timed pipeline stages
+ */
+enum MetricStage {
+  STAGE_TCP_READ,       // Socket reads and waits for stream data
+  STAGE_PARSE,          // Multipart boundary/header parsing
+  STAGE_MOTION,         // Motion detector (gate)
+  STAGE_INFERENCE,      // Person model incl. decode and preprocessing
+  STAGE_ZONE_UPDATE,    // ZoneManager::update
+  STAGE_WS_BROADCAST,   // WebSocket frame fan-out
+  STAGE_FRAME_TOTAL,    // Whole processFrame()
+  STAGE_COUNT
+};
+
+/**
+ * Event counters
+ */
+enum MetricCounter {
+  COUNTER_FRAMES_PROCESSED,
+  COUNTER_FRAMES_STALE,         // Replaced in the mailbox before processing
+  COUNTER_FRAMES_POOL_DROPPED,  // No free frame slot while parsing
+  COUNTER_WS_FRAMES_DROPPED,    // Viewer queue full
+  COUNTER_COUNT
+};
+
+/**
+ * Latency histogram (microseconds)
+ */
+struct LatencyHistogram {
+  uint32_t buckets[METRIC_BUCKETS + 1];   // Non-cumulative; last is +Inf
+  uint64_t sumUs;
+  uint32_t count;
+};
+
+/**
+ * Metrics Class
+ */
+class Metrics {
+public:
+  Metrics();
+  
+  // Record a stage that started at startUs (esp_timer_get_time())
+  void record(MetricStage stage, int64_t startUs) { recordDuration(stage, esp_timer_get_time() - startUs); }
+  void recordDuration(MetricStage stage, int64_t durationUs);
+  
+  // Bump an event counter
+  void count(MetricCounter counter, uint32_t n = 1);
+  
+  // Write all metrics plus memory gauges in Prometheus text format
+  void writePrometheus(Print& out);
+  
+  // Copy of one stage histogram (host benchmark report)
+  LatencyHistogram getHistogram(MetricStage stage);
+  static const char* getStageName(MetricStage stage);
+  static uint32_t getBucketBound(int bucket);
+  
+private:
+  LatencyHistogram stages[STAGE_COUNT];
+  uint32_t counters[COUNTER_COUNT];
+  portMUX_TYPE mux;
+};
+
+// Shared by all tasks
+extern Metrics metrics;
+
+/**
+ * Adds the lifetime of a scope to a microsecond total
+ */
+struct ScopedTimer {
+  int64_t& total;
+  int64_t start;
+  ScopedTimer(int64_t& accumulator) : total(accumulator), start(esp_timer_get_time()) {}
+  ~ScopedTimer() { total += esp_timer_get_time() - start; }
+};
+
+#endif // METRICS_H
@@ -6,58 +6,236 @@
  */
 
 #include "mjpeg_stream.h"
+#include "metrics.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
 
 MJPEGStream::MJPEGStream() {
+  framePool = nullptr;
+  parseSlot = nullptr;
   buffer = nullptr;
   bufferSize = MJPEG_BUFFER_SIZE;
   bufferPos = 0;
   connected = false;
+  disconnectRequested = false;
+  reconnectRequested = false;
+  lastDataTime = 0;
+  linkState = LINK_IDLE;
+  wantConnected = false;
+  connectFailures = 0;
+  retryDelay = 0;
+  nextAttemptAt = 0;
+  resolved = false;
+  requestMux = portMUX_INITIALIZER_UNLOCKED;
+  requestedURL[0] = '\0';
+  connectRequested = false;
   boundaryFound = false;
+  parseState = PARSE_BOUNDARY;
+  scanPos = 0;
+  partStart = 0;
+  contentLength = 0;
+  boundaryLength = 0;
+  useContentLength = true;
+  lengthFraming = false;
+  snapshotKeepAlive = false;
+  skipBody = false;
+  snapshotRequest[0] = '\0';
+  snapshotRequestLength = 0;
   frameCount = 0;
+  droppedFrames = 0;
   lastFrameTime = 0;
   firstFrameTime = 0;
+  readTimeUs = 0;
   memset(boundary, 0, BOUNDARY_MAX_LENGTH);
 }
 
 MJPEGStream::~MJPEGStream() {
   disconnect();
-  if (buffer) {
-    free(buffer);
+  if (parseSlot) {
+    framePool->release(parseSlot);
   }
 }
 
 bool MJPEGStream::begin(const char* url) {
-  streamURL = String(url);
+  if (strlen(url) >= MJPEG_URL_MAX_LENGTH) {
+    Serial.println("ERROR: MJPEG stream URL too long");
+    return false;
+  }
   
-  // Allocate buffer
-  if (!buffer) {
-    buffer = (uint8_t*)malloc(bufferSize);
-    if (!buffer) {
-      Serial.println("ERROR: Failed to allocate MJPEG buffer");
-      return false;
+  // Hand the URL to the fetching task; it connects on its next service()
+  portENTER_CRITICAL(&requestMux);
+  strcpy(requestedURL, url);
+  connectRequested = true;
+  disconnectRequested = false;
+  portEXIT_CRITICAL(&requestMux);
+  return true;
+}
+
+bool MJPEGStream::begin(const char* ip, int port, const char* path) {
+  // Build stream URL (locally, streamURL belongs to the fetching task)
+  char url[MJPEG_URL_MAX_LENGTH];
+  int len = snprintf(url, sizeof(url), "http://%s:%d%s", ip, port, path);
+  if (len < 0 || len >= (int)sizeof(url)) {
+    Serial.println("ERROR: MJPEG stream URL too long");
+    return false;
+  }
+  
+  return begin(url);
+}
+
+/**
+ * Link state machine: picks up requests from other tasks, notices a lost
+ * link and dials again once the backoff has expired. Only this task ever
+ * blocks on the camera, so the web UI and relay timeouts keep running.
+ */
+void MJPEGStream::service() {
+  // New URL from the web UI: start over without backoff
+  if (connectRequested) {
+    char url[MJPEG_URL_MAX_LENGTH];
+    portENTER_CRITICAL(&requestMux);
+    strcpy(url, requestedURL);
+    connectRequested = false;
+    portEXIT_CRITICAL(&requestMux);
+    
+    disconnect();
+    if (streamURL != url) {
+      streamURL = url;
+      resolved = false;
     }
+    Serial.printf("MJPEG Stream URL: %s\n", streamURL.c_str());
+    wantConnected = true;
+    connectFailures = 0;
+    retryDelay = 0;
+    nextAttemptAt = millis();
+  }
+  
+  if (disconnectRequested) {
+    disconnect();
+    disconnectRequested = false;
+    wantConnected = false;
+    linkState = LINK_IDLE;
+    return;
+  }
+  
+  if (reconnectRequested) {
+    reconnectRequested = false;
+    disconnect();
+  }
+  
+  if (!wantConnected || isConnected()) {
+    return;
   }
   
-  Serial.printf("MJPEG Stream URL: %s\n", streamURL.c_str());
+  // Link went down (stall, camera closed the socket, single-frame part done)
+  if (linkState == LINK_CONNECTED) {
+    disconnect();
+    nextAttemptAt = millis() + retryDelay;
+    linkState = LINK_BACKOFF;
+  }
+  
+  if ((long)(millis() - nextAttemptAt) < 0) {
+    return;
+  }
   
-  // Connect to stream
-  return connectToStream();
+  linkState = LINK_CONNECTING;
+  if (acquireParseSlot() && connectToStream()) {
+    linkState = LINK_CONNECTED;
+    return;
+  }
+  connectionFailed();
 }
 
-bool MJPEGStream::begin(const char* ip, int port, const char* path) {
-  // Build stream URL
-  streamURL = "http://";
-  streamURL += ip;
-  streamURL += ":";
-  streamURL += String(port);
-  streamURL += path;
-  
-  return begin(streamURL.c_str());
+/**
+ * Schedule the next attempt with exponential backoff
+ */
+void MJPEGStream::connectionFailed() {
+  connectFailures++;
+  retryDelay = retryDelay ? min(retryDelay * 2, (unsigned long)MJPEG_RETRY_MAX) : MJPEG_RETRY_MIN;
+  nextAttemptAt = millis() + retryDelay;
+  linkState = LINK_BACKOFF;
+  
+  // The camera may have moved (DHCP), look its name up again now and then
+  if (connectFailures % MJPEG_RESOLVE_FAILURES == 0) {
+    resolved = false;
+  }
+  
+  Serial.printf("⚠ Camera connection failed (%d in a row), retrying in %lu s\n",
+                connectFailures, retryDelay / 1000);
+}
+
+unsigned long MJPEGStream::getRetryIn() {
+  if (linkState != LINK_BACKOFF) {
+    return 0;
+  }
+  long remaining = (long)(nextAttemptAt - millis());
+  return remaining > 0 ? remaining : 0;
+}
+
+/**
+ * Take a pooled slot to parse into (kept across reconnects)
+ */
+bool MJPEGStream::acquireParseSlot() {
+  if (parseSlot) {
+    return true;
+  }
+  if (!framePool) {
+    Serial.println("ERROR: No frame pool attached to MJPEG stream");
+    return false;
+  }
+  parseSlot = framePool->acquire();
+  if (!parseSlot) {
+    Serial.println("ERROR: Failed to acquire MJPEG parse slot");
+    return false;
+  }
+  buffer = parseSlot->data;
+  bufferSize = parseSlot->capacity;
+  return true;
+}
+
+/**
+ * Host name position in streamURL (without scheme and port)
+ */
+void MJPEGStream::splitURL(int* hostStart, int* hostEnd) {
+  int start = streamURL.indexOf("://");
+  start = start >= 0 ? start + 3 : 0;
+  int end = start;
+  while (end < (int)streamURL.length() && streamURL[end] != ':' && streamURL[end] != '/') {
+    end++;
+  }
+  *hostStart = start;
+  *hostEnd = end;
+}
+
+/**
+ * Connect URL with the camera host replaced by its cached address,
+ * so a reconnect does not wait on DNS/mDNS again
+ */
+bool MJPEGStream::resolveCamera(String* url) {
+  int hostStart;
+  int hostEnd;
+  splitURL(&hostStart, &hostEnd);
+  String host = streamURL.substring(hostStart, hostEnd);
+  
+  if (!resolved) {
+    if (!resolvedIP.fromString(host) && !WiFi.hostByName(host.c_str(), resolvedIP)) {
+      Serial.printf("ERROR: Cannot resolve camera host %s\n", host.c_str());
+      return false;
+    }
+    resolved = true;
+  }
+  
+  *url = streamURL.substring(0, hostStart) + resolvedIP.toString() + streamURL.substring(hostEnd);
+  return true;
 }
 
 bool MJPEGStream::connectToStream() {
   Serial.println("Connecting to MJPEG stream...");
   
+  String url;
+  if (!resolveCamera(&url)) {
+    return false;
+  }
+  
   // Yield before connecting
   yield();
   
@@ -65,7 +243,14 @@ bool MJPEGStream::connectToStream() {
   http.setTimeout(5000); // 5 second timeout
   http.setConnectTimeout(3000); // 3 second connect timeout
   
-  if (!http.begin(client, streamURL)) {
+  // HTTPClient only keeps response headers it was asked for
+  const char* headerKeys[] = {"Content-Type", "Connection"};
+  http.collectHeaders(headerKeys, 2);
+  
+  // Ask for keep-alive so snapshot cameras can be polled on one connection
+  http.setReuse(true);
+  
+  if (!http.begin(client, url)) {
     Serial.println("ERROR: Failed to initialize HTTP client");
     return false;
   }
@@ -108,198 +293,481 @@ bool MJPEGStream::connectToStream() {
     }
     boundaryFound = true;
   } else {
-    // Non-standard stream (might be single JPEG or streaming without boundaries)
-    Serial.println("⚠ Not a multipart stream - using single-frame mode");
-    Serial.println("  This camera serves individual JPEG frames");
-    boundaryFound = false;  // Will read entire response as one frame
+    // Single JPEG per request (/capture style endpoint)
+    boundaryFound = false;
     strcpy(boundary, "");
+    
+    // Sized responses on a kept-alive connection are polled in place,
+    // anything else is read to the end and re-requested
+    String connection = http.header("Connection");
+    snapshotKeepAlive = http.getSize() > 0 && !connection.equalsIgnoreCase("close");
+    if (snapshotKeepAlive) {
+      Serial.println("⚠ Not a multipart stream - polling snapshots over keep-alive");
+    } else {
+      Serial.println("⚠ Not a multipart stream - using single-frame mode");
+      Serial.println("  This camera serves individual JPEG frames");
+    }
+  }
+  
+  prepareBoundarySearch();
+  parseState = PARSE_BOUNDARY;
+  scanPos = 0;
+  lengthFraming = false;
+  
+  if (!boundaryFound && snapshotKeepAlive) {
+    // HTTPClient has read the first response headers, its body comes next;
+    // the request for the following frame goes out right away
+    buildSnapshotRequest();
+    parseState = PARSE_BODY;
+    partStart = 0;
+    contentLength = http.getSize();
+    skipBody = false;
+    lengthFraming = true;
+    sendSnapshotRequest();
   }
   
   connected = true;
   bufferPos = 0;
   firstFrameTime = millis();
+  lastDataTime = millis();
   
   Serial.println("✓ Connected to camera stream");
   return true;
 }
 
-bool MJPEGStream::fetchFrame(uint8_t** frameData, size_t* frameSize) {
+bool MJPEGStream::fetchFrame(FrameLease* frame) {
   if (!connected) {
     return false;
   }
   
-  // Read data from stream and extract frame
-  return extractFrame(frameData, frameSize);
+  // Read data from stream and extract frame; socket time is split from parse time
+  int64_t start = esp_timer_get_time();
+  readTimeUs = 0;
+  bool ok = extractFrame(frame);
+  if (ok) {
+    // Frames are flowing again: the next drop reconnects at once
+    connectFailures = 0;
+    retryDelay = 0;
+    metrics.recordDuration(STAGE_TCP_READ, readTimeUs);
+    metrics.recordDuration(STAGE_PARSE, esp_timer_get_time() - start - readTimeUs);
+  }
+  return ok;
+}
+
+/**
+ * Hand the parse slot out as a frame and continue parsing in a fresh slot.
+ * Only the bytes after the frame are carried over, the JPEG itself stays put.
+ */
+bool MJPEGStream::publishFrame(size_t jpegStart, size_t jpegSize, size_t consumed, FrameLease* frame) {
+  FrameSlot* next = framePool->acquire();
+  if (!next) {
+    // Every slot is still held by readers - drop this frame
+    memmove(buffer, &buffer[consumed], bufferPos - consumed);
+    bufferPos = bufferPos - consumed;
+    parseState = PARSE_BOUNDARY;
+    scanPos = 0;
+    droppedFrames++;
+    metrics.count(COUNTER_FRAMES_POOL_DROPPED);
+    return false;
+  }
+  
+  parseSlot->offset = jpegStart;
+  parseSlot->size = jpegSize;
+  parseSlot->sequence = frameCount + 1;
+  parseSlot->receivedAt = millis();
+  *frame = framePool->lease(parseSlot);
+
+  // Carry leftover stream data into the next slot
+  memcpy(next->data, &buffer[consumed], bufferPos - consumed);
+  bufferPos = bufferPos - consumed;
+  
+  framePool->release(parseSlot);
+  parseSlot = next;
+  buffer = parseSlot->data;
+  
+  // Leftover data starts at the next part boundary
+  parseState = PARSE_BOUNDARY;
+  scanPos = 0;
+  
+  frameCount++;
+  lastFrameTime = millis();
+  return true;
 }
 
-bool MJPEGStream::extractFrame(uint8_t** frameData, size_t* frameSize) {
+bool MJPEGStream::extractFrame(FrameLease* frame) {
   // Handle non-multipart streams (single JPEG per request)
   if (!boundaryFound) {
-    // Read all available data as a single JPEG frame
-    int readAttempts = 0;
-    while (readMoreData() && readAttempts < 50) {
-      // Keep reading until no more data (max 50 attempts to prevent overflow)
-      delay(10);
-      readAttempts++;
+    return snapshotKeepAlive ? extractSnapshotFrame(frame) : extractSingleFrame(frame);
+  }
+  
+  // Standard MJPEG with boundaries. Positions are resumed across reads,
+  // so no byte is scanned twice and nothing is shifted between frames.
+  while (true) {
+    if (parseState == PARSE_BOUNDARY) {
+      size_t resumePos;
+      int boundaryPos = findBoundaryInBuffer(scanPos, &resumePos);
+      if (boundaryPos == -1) {
+        // Only the unscanned tail can still hold the start of a boundary
+        memmove(buffer, &buffer[resumePos], bufferPos - resumePos);
+        bufferPos = bufferPos - resumePos;
+        scanPos = 0;
+        if (!readMoreData()) {
+          return false;
+        }
+        continue;
+      }
+      
+      partStart = boundaryPos + boundaryLength;
+      scanPos = partStart;
+      parseState = PARSE_HEADERS;
     }
     
-    // Check if we have a complete JPEG (starts with FFD8, ends with FFD9)
-    if (bufferPos > 100) {
-      // Find JPEG start marker (0xFF 0xD8)
-      int jpegStart = -1;
-      for (size_t i = 0; i < bufferPos - 1; i++) {
-        if (buffer[i] == 0xFF && buffer[i+1] == 0xD8) {
-          jpegStart = i;
-          break;
+    if (parseState == PARSE_HEADERS) {
+      int headerEnd = findHeaderEnd(scanPos);
+      if (headerEnd == -1) {
+        if (bufferPos == bufferSize && partStart > 0) {
+          // Slot full mid-header, move the part to the front
+          memmove(buffer, &buffer[partStart], bufferPos - partStart);
+          bufferPos = bufferPos - partStart;
+          scanPos = scanPos - partStart;
+          partStart = 0;
+        }
+        if (bufferPos - partStart > MJPEG_MAX_HEADER_SIZE) {
+          // Not a real part header, look for the next boundary
+          Serial.println("⚠ Part headers too long, resyncing");
+          parseState = PARSE_BOUNDARY;
+          scanPos = partStart;
+          continue;
         }
+        scanPos = max(partStart, bufferPos >= 3 ? bufferPos - 3 : 0);
+        if (!readMoreData()) {
+          return false;
+        }
+        continue;
       }
       
-      // Find JPEG end marker (0xFF 0xD9)
-      int jpegEnd = -1;
-      for (size_t i = bufferPos - 2; i > 0; i--) {
-        if (buffer[i] == 0xFF && buffer[i+1] == 0xD9) {
-          jpegEnd = i + 2;
-          break;
+      contentLength = useContentLength ? parseContentLength(partStart, headerEnd) : 0;
+      if (contentLength > bufferSize - MJPEG_MAX_HEADER_SIZE) {
+        Serial.printf("⚠ Content-Length %d exceeds frame slot, scanning instead\n", contentLength);
+        contentLength = 0;
+      }
+      
+      // Make room so the whole body lands contiguously in this slot
+      if (contentLength > 0 && (size_t)headerEnd + contentLength > bufferSize) {
+        memmove(buffer, &buffer[headerEnd], bufferPos - headerEnd);
+        bufferPos = bufferPos - headerEnd;
+        headerEnd = 0;
+      }
+      
+      lengthFraming = contentLength > 0;
+      partStart = headerEnd;
+      scanPos = partStart;
+      parseState = PARSE_BODY;
+    }
+    
+    // JPEG data starts here
+    size_t jpegStart = partStart;
+    size_t jpegSize;
+    size_t consumed;
+    
+    if (contentLength > 0) {
+      // Content-Length framing: pull exactly the remaining body bytes
+      size_t jpegEnd = jpegStart + contentLength;
+      if (bufferPos < jpegEnd) {
+        if (!readMoreData(jpegEnd - bufferPos)) {
+          return false;
         }
+        continue;
       }
+      jpegSize = contentLength;
+      consumed = jpegEnd;
+    } else {
+      // No Content-Length: find next boundary (end of JPEG)
+      size_t resumePos;
+      int nextBoundary = findBoundaryInBuffer(scanPos, &resumePos);
       
-      if (jpegStart >= 0 && jpegEnd > jpegStart) {
-        int jpegSize = jpegEnd - jpegStart;
-        
-        *frameData = (uint8_t*)malloc(jpegSize);
-        if (*frameData) {
-          memcpy(*frameData, &buffer[jpegStart], jpegSize);
-          *frameSize = jpegSize;
-          
-          bufferPos = 0;  // Reset buffer for next frame
-          frameCount++;
-          lastFrameTime = millis();
-          
-          // Reconnect for next frame (single-shot mode)
-          disconnect();
-          delay(50);  // Small delay before reconnecting
-          
-          return true;
+      if (nextBoundary == -1) {
+        scanPos = resumePos;
+        if (bufferPos - jpegStart > bufferSize - 10000) {
+          // Frame too large or corrupted, skip
+          Serial.println("⚠ Frame too large, skipping");
+          memmove(buffer, &buffer[resumePos], bufferPos - resumePos);
+          bufferPos = bufferPos - resumePos;
+          scanPos = 0;
+          parseState = PARSE_BOUNDARY;
+          continue;
+        }
+        if (!readMoreData()) {
+          return false;
         }
+        continue;
       }
+      
+      jpegSize = nextBoundary - jpegStart;
+      consumed = nextBoundary;
     }
     
-    bufferPos = 0;
-    return false;
+    if (jpegSize > 0) {
+      // Lease the frame in place; leftover data moves to the next slot
+      if (publishFrame(jpegStart, jpegSize, consumed, frame)) {
+        return true;
+      }
+      
+      // Pool exhausted, frame dropped - keep parsing
+      static unsigned long lastDropLog = 0;
+      if (millis() - lastDropLog > 5000) {
+        Serial.printf("⚠ Frame pool exhausted, dropped %d frames\n", droppedFrames);
+        lastDropLog = millis();
+      }
+      continue;
+    } else {
+      // Empty part
+      Serial.println("⚠ Invalid frame size: 0");
+      memmove(buffer, &buffer[consumed], bufferPos - consumed);
+      bufferPos = bufferPos - consumed;
+      scanPos = 0;
+      parseState = PARSE_BOUNDARY;
+      continue;
+    }
   }
   
-  // Standard MJPEG with boundaries
+  return false;
+}
+
+/**
+ * Keep-alive snapshot polling: each response is framed by its
+ * Content-Length, and the next request is sent as soon as a response's
+ * headers arrive, so the camera captures while this frame is read and
+ * processed
+ */
+bool MJPEGStream::extractSnapshotFrame(FrameLease* frame) {
   while (true) {
-    // Read more data if buffer is running low
-    if (bufferPos < 1024) {
-      if (!readMoreData()) {
-        return false;
+    if (parseState == PARSE_HEADERS) {
+      int headerEnd = findHeaderEnd(scanPos);
+      if (headerEnd == -1) {
+        if (bufferPos - partStart > MJPEG_MAX_HEADER_SIZE) {
+          Serial.println("⚠ Snapshot response headers too long");
+          disconnect();
+          return false;
+        }
+        scanPos = max(partStart, bufferPos >= 3 ? bufferPos - 3 : 0);
+        if (!readMoreData()) {
+          return false;
+        }
+        continue;
       }
-    }
-    
-    // Find boundary marker
-    int boundaryPos = findBoundaryInBuffer();
-    if (boundaryPos == -1) {
-      // No boundary found, need more data
-      if (!readMoreData()) {
+      
+      int status = 0;
+      if (memcmp(&buffer[partStart], "HTTP/", 5) == 0) {
+        status = atoi((const char*)&buffer[partStart + 9]);
+      }
+      contentLength = parseContentLength(partStart, headerEnd);
+      if (contentLength == 0 || contentLength > bufferSize - MJPEG_MAX_HEADER_SIZE) {
+        // Cannot frame the next body, reconnect and re-detect the endpoint
+        Serial.printf("⚠ Snapshot response %d without usable Content-Length (%d)\n", status, contentLength);
+        disconnect();
         return false;
       }
-      continue;
-    }
-    
-    // Skip past boundary and headers to find JPEG data
-    int searchPos = boundaryPos + strlen(boundary);
-    
-    // Look for \r\n\r\n (end of headers)
-    while (searchPos < (int)bufferPos - 3) {
-      if (buffer[searchPos] == '\r' && buffer[searchPos + 1] == '\n' &&
-          buffer[searchPos + 2] == '\r' && buffer[searchPos + 3] == '\n') {
-        // Found end of headers
-        searchPos += 4;
-        break;
+      
+      // Keep one request in flight
+      sendSnapshotRequest();
+      
+      // Make room so the whole body lands contiguously in this slot
+      if ((size_t)headerEnd + contentLength > bufferSize) {
+        memmove(buffer, &buffer[headerEnd], bufferPos - headerEnd);
+        bufferPos = bufferPos - headerEnd;
+        headerEnd = 0;
       }
-      searchPos++;
+      
+      skipBody = status != HTTP_CODE_OK;
+      partStart = headerEnd;
+      parseState = PARSE_BODY;
     }
     
-    if (searchPos >= (int)bufferPos - 3) {
-      // Need more data to find headers
-      if (!readMoreData()) {
+    // Pull exactly the remaining body bytes
+    size_t bodyEnd = partStart + contentLength;
+    if (bufferPos < bodyEnd) {
+      if (!readMoreData(bodyEnd - bufferPos)) {
         return false;
       }
       continue;
     }
     
-    // JPEG data starts here
-    int jpegStart = searchPos;
+    bool published = false;
+    if (skipBody) {
+      Serial.println("⚠ Snapshot request failed, skipping response");
+      memmove(buffer, &buffer[bodyEnd], bufferPos - bodyEnd);
+      bufferPos = bufferPos - bodyEnd;
+    } else {
+      published = publishFrame(partStart, contentLength, bodyEnd, frame);
+    }
     
-    // Find next boundary (end of JPEG)
-    int nextBoundary = -1;
-    for (int i = jpegStart; i < (int)bufferPos - (int)strlen(boundary); i++) {
-      if (memcmp(&buffer[i], boundary, strlen(boundary)) == 0) {
-        nextBoundary = i;
+    // Leftover data is the start of the next response
+    parseState = PARSE_HEADERS;
+    partStart = 0;
+    scanPos = 0;
+    if (published) {
+      return true;
+    }
+  }
+}
+
+/**
+ * Request line for snapshot polling, built once per connection
+ */
+void MJPEGStream::buildSnapshotRequest() {
+  int hostStart;
+  int hostEnd;
+  splitURL(&hostStart, &hostEnd);
+  
+  // Host header keeps the port, the path is everything after it
+  int pathStart = streamURL.indexOf('/', hostEnd);
+  String host = streamURL.substring(hostStart, pathStart >= 0 ? pathStart : streamURL.length());
+  String path = pathStart >= 0 ? streamURL.substring(pathStart) : String("/");
+  
+  int len = snprintf(snapshotRequest, sizeof(snapshotRequest),
+                     "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+                     path.c_str(), host.c_str());
+  snapshotRequestLength = len > 0 ? min((size_t)len, sizeof(snapshotRequest) - 1) : 0;
+}
+
+void MJPEGStream::sendSnapshotRequest() {
+  client.write((const uint8_t*)snapshotRequest, snapshotRequestLength);
+}
+
+bool MJPEGStream::extractSingleFrame(FrameLease* frame) {
+  // Read all available data as a single JPEG frame
+  int readAttempts = 0;
+  while (readMoreData() && readAttempts < 50) {
+    // Keep reading until no more data (max 50 attempts to prevent overflow)
+    delay(10);
+    readAttempts++;
+  }
+  
+  // Check if we have a complete JPEG (starts with FFD8, ends with FFD9)
+  if (bufferPos > 100) {
+    // Find JPEG start marker (0xFF 0xD8)
+    int jpegStart = -1;
+    for (size_t i = 0; i < bufferPos - 1; i++) {
+      if (buffer[i] == 0xFF && buffer[i+1] == 0xD8) {
+        jpegStart = i;
         break;
       }
     }
     
-    if (nextBoundary == -1) {
-      // Need more data to find end of frame
-      if (bufferPos - jpegStart > bufferSize - 10000) {
-        // Frame too large or corrupted, skip
-        Serial.println("⚠ Frame too large, skipping");
-        memmove(buffer, &buffer[jpegStart], bufferPos - jpegStart);
-        bufferPos = bufferPos - jpegStart;
-        continue;
-      }
-      if (!readMoreData()) {
-        return false;
+    // Find JPEG end marker (0xFF 0xD9)
+    int jpegEnd = -1;
+    for (size_t i = bufferPos - 2; i > 0; i--) {
+      if (buffer[i] == 0xFF && buffer[i+1] == 0xD9) {
+        jpegEnd = i + 2;
+        break;
       }
-      continue;
     }
     
-    // Extract JPEG frame
-    int jpegSize = nextBoundary - jpegStart;
-    
-    if (jpegSize > 0 && jpegSize < (int)bufferSize) {
-      // Allocate frame buffer (caller must free this)
-      *frameData = (uint8_t*)malloc(jpegSize);
-      if (*frameData == nullptr) {
-        Serial.println("ERROR: Failed to allocate frame buffer");
-        return false;
-      }
-      
-      memcpy(*frameData, &buffer[jpegStart], jpegSize);
-      *frameSize = jpegSize;
-      
-      // Remove processed data from buffer
-      memmove(buffer, &buffer[nextBoundary], bufferPos - nextBoundary);
-      bufferPos = bufferPos - nextBoundary;
-      
-      frameCount++;
-      lastFrameTime = millis();
+    if (jpegStart >= 0 && jpegEnd > jpegStart) {
+      int jpegSize = jpegEnd - jpegStart;
       
-      return true;
-    } else {
-      // Invalid frame size
-      Serial.printf("⚠ Invalid frame size: %d\n", jpegSize);
-      memmove(buffer, &buffer[nextBoundary], bufferPos - nextBoundary);
-      bufferPos = bufferPos - nextBoundary;
-      continue;
+      // Whole buffer is consumed by this frame
+      if (publishFrame(jpegStart, jpegSize, bufferPos, frame)) {
+        // Single-shot mode: service() dials again for the next frame
+        disconnect();
+        delay(50);  // Small delay before reconnecting
+        
+        return true;
+      }
     }
   }
   
+  bufferPos = 0;
   return false;
 }
 
-int MJPEGStream::findBoundaryInBuffer() {
-  for (size_t i = 0; i < bufferPos - strlen(boundary); i++) {
-    if (memcmp(&buffer[i], boundary, strlen(boundary)) == 0) {
+/**
+ * Build the Boyer-Moore-Horspool skip table for the current boundary
+ */
+void MJPEGStream::prepareBoundarySearch() {
+  boundaryLength = strlen(boundary);
+  for (int i = 0; i < 256; i++) {
+    boundarySkip[i] = boundaryLength > 0 ? boundaryLength : 1;
+  }
+  for (size_t i = 0; i + 1 < boundaryLength; i++) {
+    boundarySkip[(uint8_t)boundary[i]] = boundaryLength - 1 - i;
+  }
+}
+
+/**
+ * Boyer-Moore-Horspool search for the boundary starting at 'from'.
+ * On a miss, resumePos is the first position that could still match
+ * once more data arrives.
+ */
+int MJPEGStream::findBoundaryInBuffer(size_t from, size_t* resumePos) {
+  const size_t n = boundaryLength;
+  const uint8_t* pattern = (const uint8_t*)boundary;
+  size_t i = from;
+  
+  while (i + n <= bufferPos) {
+    uint8_t c = buffer[i + n - 1];
+    if (c == pattern[n - 1] && memcmp(&buffer[i], pattern, n - 1) == 0) {
       return i;
     }
+    i += boundarySkip[c];
+  }
+  
+  *resumePos = min(i, bufferPos);
+  return -1;
+}
+
+/**
+ * Find the blank line ending the part headers, returns offset of the body
+ */
+int MJPEGStream::findHeaderEnd(size_t from) {
+  const uint8_t* p = buffer + from;
+  const uint8_t* end = buffer + bufferPos;
+  
+  while (p + 3 < end) {
+    p = (const uint8_t*)memchr(p, '\r', end - p - 3);
+    if (!p) {
+      return -1;
+    }
+    if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+      return (p - buffer) + 4;
+    }
+    p++;
   }
   return -1;
 }
 
-bool MJPEGStream::readMoreData() {
+/**
+ * Read Content-Length from the part headers (0 if absent)
+ */
+size_t MJPEGStream::parseContentLength(size_t start, size_t end) {
+  static const char key[] = "content-length:";
+  const size_t keyLen = sizeof(key) - 1;
+  
+  for (size_t i = start; i + keyLen <= end; i++) {
+    // Header names only start at the beginning of a line
+    if (i != start && buffer[i - 1] != '\n') {
+      continue;
+    }
+    if (strncasecmp((const char*)&buffer[i], key, keyLen) == 0) {
+      size_t j = i + keyLen;
+      size_t value = 0;
+      while (j < end && buffer[j] == ' ') {
+        j++;
+      }
+      while (j < end && buffer[j] >= '0' && buffer[j] <= '9') {
+        value = value * 10 + (buffer[j] - '0');
+        j++;
+      }
+      return value;
+    }
+  }
+  return 0;
+}
+
+bool MJPEGStream::readMoreData(size_t maxBytes) {
+  ScopedTimer timer(readTimeUs);
+  
   // Yield periodically to prevent watchdog
   static unsigned long lastYield = 0;
   if (millis() - lastYield > 1000) {
@@ -307,6 +775,12 @@ bool MJPEGStream::readMoreData() {
     lastYield = millis();
   }
   
+  // Disconnect asked for by another task (web UI, watchdog)
+  if (disconnectRequested) {
+    disconnect();
+    return false;
+  }
+  
   // Get WiFi stream
   WiFiClient* stream = http.getStreamPtr();
   if (!stream) {
@@ -324,35 +798,57 @@ bool MJPEGStream::readMoreData() {
   
   // Check if data is available
   if (!stream->available()) {
-    delay(10);
-    return bufferPos > 0; // Return true if we have some data buffered
+    if (millis() - lastDataTime > MJPEG_STALL_TIMEOUT) {
+      Serial.println("⚠ Stream stalled, no data received");
+      return false;
+    }
+    // Sleep on the socket until bytes arrive (no fixed delay)
+    waitForData(MJPEG_DATA_WAIT_MS);
+    return true;
   }
   
   // Read available data
   size_t available = stream->available();
   size_t spaceLeft = bufferSize - bufferPos;
-  size_t toRead = min(available, spaceLeft);
+  size_t toRead = min(min(available, spaceLeft), maxBytes);
   
-  if (toRead == 0) {
+  if (spaceLeft == 0) {
     // Buffer full, shift data
     Serial.println("⚠ Buffer full, shifting data");
     size_t keepSize = bufferPos / 2;
     memmove(buffer, &buffer[bufferPos - keepSize], keepSize);
     bufferPos = keepSize;
     spaceLeft = bufferSize - bufferPos;
-    toRead = min(available, spaceLeft);
+    toRead = min(min(available, spaceLeft), maxBytes);
   }
   
   size_t bytesRead = stream->readBytes(&buffer[bufferPos], toRead);
   bufferPos += bytesRead;
+  if (bytesRead > 0) {
+    lastDataTime = millis();
+  }
   
   return bytesRead > 0;
 }
 
-bool MJPEGStream::reconnect() {
-  disconnect();
-  delay(1000);
-  return connectToStream();
+/**
+ * Block on the stream socket until it is readable or the timeout expires
+ */
+void MJPEGStream::waitForData(uint32_t timeoutMs) {
+  int fd = client.fd();
+  if (fd < 0) {
+    delay(1);
+    return;
+  }
+  
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(fd, &readSet);
+  
+  struct timeval timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_usec = (timeoutMs % 1000) * 1000;
+  select(fd + 1, &readSet, nullptr, nullptr, &timeout);
 }
 
 void MJPEGStream::disconnect() {
@@ -365,7 +861,7 @@ void MJPEGStream::disconnect() {
 }
 
 bool MJPEGStream::isConnected() {
-  return connected && client.connected();
+  return connected && !disconnectRequested && client.connected();
 }
 
 float MJPEGStream::getAverageFPS() {
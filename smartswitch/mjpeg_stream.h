@@ -11,9 +11,29 @@
 #include <Arduino.h>
 #include <WiFiClient.h>
 #include <HTTPClient.h>
+#include <IPAddress.h>
+#include "frame_pool.h"
 
-#define MJPEG_BUFFER_SIZE (100 * 1024)  // 100KB buffer for MJPEG data
+#define MJPEG_BUFFER_SIZE FRAME_SLOT_SIZE  // Parse buffer is a pooled frame slot
 #define BOUNDARY_MAX_LENGTH 128
+#define MJPEG_MAX_HEADER_SIZE 1024  // Max size of per-part headers
+#define MJPEG_DATA_WAIT_MS 20       // Max wait on the socket per read attempt
+#define MJPEG_STALL_TIMEOUT 5000    // No bytes for this long = stream stalled
+#define MJPEG_URL_MAX_LENGTH 128
+#define MJPEG_REQUEST_MAX_LENGTH (MJPEG_URL_MAX_LENGTH + 64)  // Snapshot polling request
+#define MJPEG_RETRY_MIN 1000        // First reconnect delay after a failed attempt
+#define MJPEG_RETRY_MAX 30000       // Reconnect delay doubles up to this
+#define MJPEG_RESOLVE_FAILURES 3    // Consecutive failures before the host name is looked up again
+
+/**
+ * Camera link state (driven by service() on the fetching task)
+ */
+enum StreamLinkState {
+  LINK_IDLE,          // Not asked to connect
+  LINK_CONNECTING,    // Attempt in progress
+  LINK_CONNECTED,     // Streaming
+  LINK_BACKOFF        // Waiting before the next attempt
+};
 
 /**
  * MJPEG Stream Client Class
@@ -23,26 +43,49 @@ public:
   MJPEGStream();
   ~MJPEGStream();
   
-  // Initialize with stream URL
+  // Frame slots used for parsing and handed out to readers
+  void setFramePool(FramePool* pool) { framePool = pool; }
+  
+  // Ask for a connection to the stream URL (safe from any task, returns
+  // at once); the fetching task connects in service() and keeps the link
+  // up with exponential backoff until requestDisconnect()
   bool begin(const char* streamURL);
   
-  // Initialize with IP and port (convenience method)
+  // Same with IP and port (convenience method)
   bool begin(const char* ip, int port, const char* path = "/stream");
   
-  // Fetch next frame from stream
-  bool fetchFrame(uint8_t** frameData, size_t* frameSize);
+  // Connect, reconnect or back off as needed (call from the task that fetches frames)
+  void service();
+  
+  // Fetch next frame from stream (lease shares the pooled slot, no copy)
+  bool fetchFrame(FrameLease* frame);
   
-  // Reconnect to stream
-  bool reconnect();
+  // Drop the link and let service() dial again (safe from any task)
+  void requestReconnect() { reconnectRequested = true; }
   
-  // Disconnect from stream
+  // Disconnect from stream (call from the task that fetches frames)
   void disconnect();
   
+  // Ask the fetching task to disconnect and stop reconnecting (safe from any task)
+  void requestDisconnect() { disconnectRequested = true; }
+  
   // Check if connected
   bool isConnected();
   
+  // Link state for the web UI
+  StreamLinkState getLinkState() { return linkState; }
+  int getConnectFailures() { return connectFailures; }
+  unsigned long getRetryIn();
+  
   // Get stream statistics
   int getFrameCount() { return frameCount; }
+  int getDroppedFrames() { return droppedFrames; }
+  
+  // Parser mode: frame parts by their Content-Length header when present
+  // (falls back to boundary search per part when the header is missing)
+  void setContentLengthMode(bool enabled) { useContentLength = enabled; }
+  bool isLengthFraming() { return lengthFraming; }
+  bool isSnapshotPolling() { return !boundaryFound && snapshotKeepAlive; }
   float getAverageFPS();
   
 private:
@@ -51,25 +94,76 @@ private:
   HTTPClient http;
   String streamURL;
   bool connected;
+  volatile bool disconnectRequested;
+  volatile bool reconnectRequested;
+  unsigned long lastDataTime;
+  
+  // Link state machine (owned by the fetching task)
+  volatile StreamLinkState linkState;
+  bool wantConnected;
+  int connectFailures;
+  unsigned long retryDelay;       // Next backoff step (0 = retry at once)
+  unsigned long nextAttemptAt;
+  IPAddress resolvedIP;           // Cached camera address
+  bool resolved;
   
-  // Stream parsing
+  // Connect request handed over from other tasks
+  portMUX_TYPE requestMux;
+  char requestedURL[MJPEG_URL_MAX_LENGTH];
+  volatile bool connectRequested;
+  
+  // Stream parsing (buffer points into parseSlot)
+  FramePool* framePool;
+  FrameSlot* parseSlot;
   uint8_t* buffer;
   size_t bufferSize;
   size_t bufferPos;
   char boundary[BOUNDARY_MAX_LENGTH];
   bool boundaryFound;
   
+  // Multipart parser state (offsets into buffer, resumed between reads)
+  enum ParseState { PARSE_BOUNDARY, PARSE_HEADERS, PARSE_BODY };
+  ParseState parseState;
+  size_t scanPos;         // Next position to search from
+  size_t partStart;       // Header start, then body start of current part
+  size_t contentLength;   // Body size from headers (0 = unknown)
+  size_t boundaryLength;
+  uint8_t boundarySkip[256];  // Boyer-Moore-Horspool shift table
+  bool useContentLength;
+  bool lengthFraming;     // Last part was framed by Content-Length
+  
+  // Snapshot polling (non-multipart cameras on a keep-alive connection)
+  bool snapshotKeepAlive;
+  bool skipBody;          // Current response is an error page, not a frame
+  char snapshotRequest[MJPEG_REQUEST_MAX_LENGTH];
+  size_t snapshotRequestLength;
+  
   // Statistics
   int frameCount;
+  int droppedFrames;
   unsigned long lastFrameTime;
   unsigned long firstFrameTime;
+  int64_t readTimeUs;     // Socket time within the current fetchFrame()
   
   // Private methods
+  bool acquireParseSlot();
+  bool resolveCamera(String* url);
+  void connectionFailed();
   bool connectToStream();
   bool findBoundary();
-  bool extractFrame(uint8_t** frameData, size_t* frameSize);
-  int findBoundaryInBuffer();
-  bool readMoreData();
+  bool extractFrame(FrameLease* frame);
+  bool extractSingleFrame(FrameLease* frame);
+  bool extractSnapshotFrame(FrameLease* frame);
+  void buildSnapshotRequest();
+  void sendSnapshotRequest();
+  void splitURL(int* hostStart, int* hostEnd);
+  bool publishFrame(size_t jpegStart, size_t jpegSize, size_t consumed, FrameLease* frame);
+  void prepareBoundarySearch();
+  int findBoundaryInBuffer(size_t from, size_t* resumePos);
+  int findHeaderEnd(size_t from);
+  size_t parseContentLength(size_t start, size_t end);
+  bool readMoreData(size_t maxBytes = SIZE_MAX);
+  void waitForData(uint32_t timeoutMs);
 };
 
 #endif // MJPEG_STREAM_H
@@ -1,125 +1,375 @@
 /**
  * Simple Motion Detector Implementation
  * 
- * Lightweight motion detection using frame differencing
- * Works directly with JPEG data - no full decoding needed
+ * Background subtraction on JPEG DC luma (one value per 8x8 block).
+ * Static cells adapt quickly, moving cells slowly so a person standing
+ * still is not absorbed into the background at once.
  */
 
 #include "motion_detector.h"
 
+#define BACKGROUND_SHIFT_STATIC 4   // Background learns 1/16 of the change per frame
+#define BACKGROUND_SHIFT_MOVING 6   // 1/64 while motion is present
+
+static void* allocDetectorBuffer(size_t size) {
+  void* buffer = psramFound() ? ps_malloc(size) : nullptr;
+  if (!buffer) {
+    buffer = malloc(size);
+  }
+  return buffer;
+}
+
 MotionDetector::MotionDetector() {
-  previousFrame = nullptr;
-  previousFrameSize = 0;
+  lumaGrid = nullptr;
+  cellLuma = nullptr;
+  background = nullptr;
+  diffMap = nullptr;
+  cellsX = 0;
+  cellsY = 0;
+  backgroundReady = false;
   width = 0;
   height = 0;
   sensitivity = 0.3;
   minBlobSize = 400;  // 20x20 pixels
   initialized = false;
+  lastErrorLog = 0;
+  blobCount = 0;
 }
 
 MotionDetector::~MotionDetector() {
-  if (previousFrame) {
-    free(previousFrame);
-  }
+  free(lumaGrid);
+  free(cellLuma);
+  free(background);
+  free(diffMap);
 }
 
 bool MotionDetector::begin(int frameWidth, int frameHeight) {
   width = frameWidth;
   height = frameHeight;
   
-  // Allocate buffer for previous frame
-  size_t maxFrameSize = width * height / 2;  // Rough estimate for JPEG
-  previousFrame = (uint8_t*)malloc(maxFrameSize);
+  // Buffers sized for the largest supported frame, so resolution
+  // changes on the camera never reallocate
+  lumaGrid = (uint8_t*)allocDetectorBuffer(MOTION_MAX_BLOCKS_X * MOTION_MAX_BLOCKS_Y);
+  cellLuma = (uint8_t*)allocDetectorBuffer(MOTION_MAX_CELLS);
+  background = (uint16_t*)allocDetectorBuffer(MOTION_MAX_CELLS * sizeof(uint16_t));
+  diffMap = (uint8_t*)allocDetectorBuffer(MOTION_MAX_CELLS);
   
-  if (!previousFrame) {
-    Serial.println("ERROR: Failed to allocate motion detector buffer");
+  if (!lumaGrid || !cellLuma || !background || !diffMap) {
+    Serial.println("ERROR: Failed to allocate motion detector buffers");
     return false;
   }
   
-  previousFrameSize = 0;
+  backgroundReady = false;
   initialized = true;
   
-  Serial.printf("✓ Motion detector initialized (%dx%d, sensitivity=%.2f)\n", 
+  Serial.printf("✓ Motion detector initialized (%dx%d, sensitivity=%.2f)\n",
                 width, height, sensitivity);
   return true;
 }
 
-std::vector<MotionBlob> MotionDetector::detectMotion(uint8_t* currentFrame, size_t frameSize) {
-  std::vector<MotionBlob> blobs;
+int MotionDetector::detectMotion(uint8_t* currentFrame, size_t frameSize) {
+  blobCount = 0;
   
   if (!initialized || !currentFrame || frameSize == 0) {
-    return blobs;
+    return 0;
   }
   
-  // First frame - just store it
-  if (previousFrameSize == 0) {
-    if (frameSize <= (size_t)(width * height / 2)) {
-      memcpy(previousFrame, currentFrame, frameSize);
-      previousFrameSize = frameSize;
+  // Partial decode: one luma value per 8x8 block
+  int gridW = 0;
+  int gridH = 0;
+  if (!decoder.decodeLumaDC(currentFrame, frameSize, lumaGrid,
+                            MOTION_MAX_BLOCKS_X, MOTION_MAX_BLOCKS_Y, &gridW, &gridH)) {
+    if (millis() - lastErrorLog > 5000) {
+      Serial.printf("⚠ Motion detector: JPEG decode failed (%s)\n", decoder.getError());
+      lastErrorLog = millis();
     }
-    return blobs;
-  }
-  
-  // Calculate difference between current and previous frame
-  // Simple byte-by-byte comparison (works reasonably well for JPEG)
-  float difference = calculateFrameDifference(currentFrame, previousFrame, 
-                                               min(frameSize, previousFrameSize));
-  
-  // If significant motion detected
-  if (difference > sensitivity) {
-    // Create a single motion blob covering the whole frame
-    // (simplified - in reality we'd analyze specific regions)
-    MotionBlob blob;
-    blob.x = width / 4;
-    blob.y = height / 4;
-    blob.width = width / 2;
-    blob.height = height / 2;
-    blob.intensity = difference;
-    
-    blobs.push_back(blob);
+    return 0;
+  }
+  
+  width = decoder.getWidth();
+  height = decoder.getHeight();
+  buildCells(gridW, gridH);
+  
+  int cells = cellsX * cellsY;
+  
+  // First frame (or new resolution) - just learn the background
+  if (!backgroundReady) {
+    for (int i = 0; i < cells; i++) {
+      background[i] = cellLuma[i] << 4;
+    }
+    backgroundReady = true;
+    return 0;
+  }
+  
+  int movingCells = updateBackground();
+  if (movingCells == 0) {
+    return 0;
+  }
+  
+  // Most of the image changed at once - lighting, not motion
+  if (movingCells > cells * MOTION_LIGHTING_RATIO) {
+    for (int i = 0; i < cells; i++) {
+      background[i] = cellLuma[i] << 4;
+    }
+    Serial.println("Motion detector: lighting change, background reset");
+    return 0;
+  }
+  
+  blobCount = findMotionBlobs(diffMap, cellsX, cellsY);
+  
+  if (blobCount > 0) {
+    Serial.printf("🔍 Motion detected! %d cells changed, %d regions\n", movingCells, blobCount);
+  }
+  
+  return blobCount;
+}
+
+void MotionDetector::buildCells(int gridW, int gridH) {
+  int newCellsX = (gridW + MOTION_CELL_BLOCKS - 1) / MOTION_CELL_BLOCKS;
+  int newCellsY = (gridH + MOTION_CELL_BLOCKS - 1) / MOTION_CELL_BLOCKS;
+  
+  // Resolution changed - old background no longer lines up
+  if (newCellsX != cellsX || newCellsY != cellsY) {
+    cellsX = newCellsX;
+    cellsY = newCellsY;
+    backgroundReady = false;
+  }
+  
+  for (int cy = 0; cy < cellsY; cy++) {
+    int y0 = cy * MOTION_CELL_BLOCKS;
+    int y1 = min(y0 + MOTION_CELL_BLOCKS, gridH);
     
-    Serial.printf("🔍 Motion detected! Intensity: %.3f\n", difference);
+    for (int cx = 0; cx < cellsX; cx++) {
+      int x0 = cx * MOTION_CELL_BLOCKS;
+      int x1 = min(x0 + MOTION_CELL_BLOCKS, gridW);
+      int sum = 0;
+      
+      for (int by = y0; by < y1; by++) {
+        for (int bx = x0; bx < x1; bx++) {
+          sum += lumaGrid[by * gridW + bx];
+        }
+      }
+      cellLuma[cy * cellsX + cx] = sum / ((y1 - y0) * (x1 - x0));
+    }
   }
+}
+
+int MotionDetector::updateBackground() {
+  int cells = cellsX * cellsY;
   
-  // Store current frame for next comparison
-  if (frameSize <= (size_t)(width * height / 2)) {
-    memcpy(previousFrame, currentFrame, frameSize);
-    previousFrameSize = frameSize;
+  // Global brightness shift (auto exposure) is not motion
+  int32_t shift = 0;
+  for (int i = 0; i < cells; i++) {
+    shift += (cellLuma[i] << 4) - background[i];
   }
+  shift /= cells;
   
-  return blobs;
+  // Sensitivity 1.0 = half the luma range must change
+  int threshold = (int)(sensitivity * 128 * 16);
+  int movingCells = 0;
+  
+  for (int i = 0; i < cells; i++) {
+    int current = cellLuma[i] << 4;
+    int diff = abs(current - background[i] - shift);
+    
+    if (diff > threshold) {
+      diffMap[i] = constrain(diff >> 4, 1, 255);
+      background[i] += (current - background[i]) / (1 << BACKGROUND_SHIFT_MOVING);
+      movingCells++;
+    } else {
+      diffMap[i] = 0;
+      background[i] += (current - background[i]) / (1 << BACKGROUND_SHIFT_STATIC);
+    }
+  }
+  
+  return movingCells;
 }
 
-float MotionDetector::calculateFrameDifference(uint8_t* frame1, uint8_t* frame2, size_t size) {
-  if (!frame1 || !frame2 || size == 0) {
-    return 0.0;
+/**
+ * Single-pass 8-connected labelling with union-find.
+ * Only the previous and current label rows are kept; region bounds
+ * accumulate on the root label as cells are visited.
+ */
+int MotionDetector::findMotionBlobs(uint8_t* diffMap, int w, int h) {
+  uint8_t* prevRow = rowLabels[0];
+  uint8_t* currRow = rowLabels[1];
+  int labelCount = 0;
+  
+  memset(prevRow, 0, w);
+  
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      uint8_t diff = diffMap[y * w + x];
+      currRow[x] = 0;
+      if (diff == 0) {
+        continue;
+      }
+      
+      // Already-visited neighbours: left, up-left, up, up-right
+      uint8_t neighbours[4] = {
+        x > 0 ? currRow[x - 1] : (uint8_t)0,
+        x > 0 ? prevRow[x - 1] : (uint8_t)0,
+        prevRow[x],
+        x + 1 < w ? prevRow[x + 1] : (uint8_t)0
+      };
+      
+      uint8_t label = 0;
+      for (int n = 0; n < 4; n++) {
+        if (neighbours[n] == 0) {
+          continue;
+        }
+        if (label == 0) {
+          label = neighbours[n];
+        } else {
+          unionLabels(label, neighbours[n]);
+        }
+      }
+      
+      if (label == 0) {
+        if (labelCount >= MOTION_MAX_LABELS) {
+          continue;  // Out of labels - isolated noise cell, skip it
+        }
+        label = ++labelCount;
+        labelParent[label] = label;
+        MotionRegion& region = regions[label];
+        region.minX = region.maxX = x;
+        region.minY = region.maxY = y;
+        region.cells = 0;
+        region.diffSum = 0;
+      }
+      
+      MotionRegion& region = regions[findRoot(label)];
+      region.minX = min((int)region.minX, x);
+      region.maxX = max((int)region.maxX, x);
+      region.maxY = y;
+      region.cells++;
+      region.diffSum += diff;
+      currRow[x] = label;
+    }
+    
+    uint8_t* swap = prevRow;
+    prevRow = currRow;
+    currRow = swap;
+  }
+  
+  // Compact root regions to the front of the array
+  int regionCount = 0;
+  for (int label = 1; label <= labelCount; label++) {
+    if (labelParent[label] == label) {
+      regions[regionCount++] = regions[label];
+    }
+  }
+  
+  regionCount = mergeRegions(regionCount);
+  
+  // Largest regions first
+  for (int i = 1; i < regionCount; i++) {
+    MotionRegion region = regions[i];
+    int j = i - 1;
+    while (j >= 0 && regions[j].cells < region.cells) {
+      regions[j + 1] = regions[j];
+      j--;
+    }
+    regions[j + 1] = region;
   }
   
-  // Sample every Nth byte to speed up comparison
-  const int sampleRate = 50;  // Check every 50th byte
-  int diffCount = 0;
-  int totalSamples = 0;
+  // Convert to frame pixels and drop regions under minBlobSize
+  const int cellSize = 8 * MOTION_CELL_BLOCKS;
+  int count = 0;
   
-  for (size_t i = 0; i < size; i += sampleRate) {
-    int diff = abs((int)frame1[i] - (int)frame2[i]);
-    if (diff > 30) {  // Threshold for considering a byte "different"
-      diffCount++;
+  for (int i = 0; i < regionCount && count < MOTION_MAX_BLOBS; i++) {
+    const MotionRegion& region = regions[i];
+    MotionBlob& blob = blobs[count];
+    
+    blob.x = region.minX * cellSize;
+    blob.y = region.minY * cellSize;
+    blob.width = min((region.maxX + 1) * cellSize, width) - blob.x;
+    blob.height = min((region.maxY + 1) * cellSize, height) - blob.y;
+    blob.intensity = (float)region.diffSum / region.cells / 255.0;
+    
+    if (blob.width * blob.height >= minBlobSize) {
+      count++;
     }
-    totalSamples++;
   }
   
-  // Return percentage of changed bytes
-  return totalSamples > 0 ? (float)diffCount / totalSamples : 0.0;
+  return count;
 }
 
-std::vector<MotionBlob> MotionDetector::findMotionBlobs(uint8_t* diffMap, int w, int h) {
-  // Simplified - just return center blob if motion detected
-  // Full implementation would do connected component analysis
-  std::vector<MotionBlob> blobs;
-  return blobs;
+uint8_t MotionDetector::findRoot(uint8_t label) {
+  while (labelParent[label] != label) {
+    labelParent[label] = labelParent[labelParent[label]];  // Path halving
+    label = labelParent[label];
+  }
+  return label;
+}
+
+void MotionDetector::unionLabels(uint8_t a, uint8_t b) {
+  uint8_t rootA = findRoot(a);
+  uint8_t rootB = findRoot(b);
+  if (rootA == rootB) {
+    return;
+  }
+  
+  // Keep the older label as root and fold the other region into it
+  if (rootB < rootA) {
+    uint8_t swap = rootA;
+    rootA = rootB;
+    rootB = swap;
+  }
+  
+  MotionRegion& target = regions[rootA];
+  const MotionRegion& source = regions[rootB];
+  target.minX = min(target.minX, source.minX);
+  target.minY = min(target.minY, source.minY);
+  target.maxX = max(target.maxX, source.maxX);
+  target.maxY = max(target.maxY, source.maxY);
+  target.cells += source.cells;
+  target.diffSum += source.diffSum;
+  labelParent[rootB] = rootA;
+}
+
+/**
+ * Merge regions whose bounding boxes are within MOTION_MERGE_GAP cells
+ * (one person often splits into several components)
+ */
+int MotionDetector::mergeRegions(int count) {
+  bool merged = true;
+  
+  while (merged) {
+    merged = false;
+    
+    for (int i = 0; i < count; i++) {
+      for (int j = i + 1; j < count; j++) {
+        MotionRegion& a = regions[i];
+        const MotionRegion& b = regions[j];
+        
+        bool near = b.minX <= a.maxX + MOTION_MERGE_GAP + 1 &&
+                    a.minX <= b.maxX + MOTION_MERGE_GAP + 1 &&
+                    b.minY <= a.maxY + MOTION_MERGE_GAP + 1 &&
+                    a.minY <= b.maxY + MOTION_MERGE_GAP + 1;
+        if (!near) {
+          continue;
+        }
+        
+        a.minX = min(a.minX, b.minX);
+        a.minY = min(a.minY, b.minY);
+        a.maxX = max(a.maxX, b.maxX);
+        a.maxY = max(a.maxY, b.maxY);
+        a.cells += b.cells;
+        a.diffSum += b.diffSum;
+        
+        regions[j] = regions[--count];
+        j--;
+        merged = true;
+      }
+    }
+  }
+  
+  return count;
 }
 
 void MotionDetector::reset() {
-  previousFrameSize = 0;
+  backgroundReady = false;
+  blobCount = 0;
   Serial.println("Motion detector reset");
 }
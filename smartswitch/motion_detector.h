@@ -1,16 +1,28 @@
 /**
  * Simple Motion Detector Header
  * 
- * Lightweight motion detection using frame differencing
- * No AI/ML required - just compares consecutive frames
+ * Lightweight motion detection on a 1/8 scale luma image taken from the
+ * JPEG DC coefficients (no full decode). Each 16x16 pixel cell is compared
+ * against a running background model.
+ * No AI/ML required
  */
 
 #ifndef MOTION_DETECTOR_H
 #define MOTION_DETECTOR_H
 
 #include <Arduino.h>
-#include <vector>
 #include "config.h"
+#include "jpeg_decoder.h"
+
+#define MOTION_MAX_BLOCKS_X 200     // 1600 px wide (UXGA) / 8
+#define MOTION_MAX_BLOCKS_Y 150     // 1200 px high (UXGA) / 8
+#define MOTION_CELL_BLOCKS 2        // Cell = 2x2 blocks (16x16 pixels)
+#define MOTION_MAX_CELLS_X (MOTION_MAX_BLOCKS_X / MOTION_CELL_BLOCKS)
+#define MOTION_MAX_CELLS ((MOTION_MAX_BLOCKS_X / MOTION_CELL_BLOCKS) * (MOTION_MAX_BLOCKS_Y / MOTION_CELL_BLOCKS))
+#define MOTION_LIGHTING_RATIO 0.6   // More cells than this changing = lighting change, not motion
+#define MOTION_MAX_LABELS 255       // Provisional component labels per frame
+#define MOTION_MAX_BLOBS 8          // Blobs reported per frame (largest first)
+#define MOTION_MERGE_GAP 1          // Components this many cells apart are merged
 
 /**
  * Motion Detection Result
@@ -23,6 +35,18 @@ struct MotionBlob {
   float intensity;  // Motion intensity (0.0 - 1.0)
 };
 
+/**
+ * Connected region of moving cells (cell coordinates)
+ */
+struct MotionRegion {
+  uint8_t minX;
+  uint8_t minY;
+  uint8_t maxX;
+  uint8_t maxY;
+  uint16_t cells;     // Moving cells in region
+  uint32_t diffSum;   // Sum of cell differences
+};
+
 /**
  * Simple Motion Detector Class
  */
@@ -34,8 +58,12 @@ public:
   // Initialize detector
   bool begin(int frameWidth, int frameHeight);
   
-  // Process new frame and detect motion
-  std::vector<MotionBlob> detectMotion(uint8_t* currentFrame, size_t frameSize);
+  // Process new JPEG frame and detect motion, returns number of blobs
+  int detectMotion(uint8_t* currentFrame, size_t frameSize);
+  
+  // Blobs from the last detectMotion() call (valid until the next call)
+  const MotionBlob* getBlobs() { return blobs; }
+  int getBlobCount() { return blobCount; }
   
   // Configure sensitivity (0.0 - 1.0, default 0.3)
   void setSensitivity(float sens) { sensitivity = sens; }
@@ -43,23 +71,51 @@ public:
   // Configure minimum blob size (default 20x20 pixels)
   void setMinBlobSize(int minSize) { minBlobSize = minSize; }
   
-  // Reset (clear previous frame)
+  // Size of the last decoded frame (blob coordinates are in this space)
+  int getFrameWidth() { return width; }
+  int getFrameHeight() { return height; }
+  
+  // Reset (relearn background)
   void reset();
   
 private:
-  uint8_t* previousFrame;
-  size_t previousFrameSize;
+  JpegDecoder decoder;
+  uint8_t* lumaGrid;        // Block means (1/8 scale luma)
+  uint8_t* cellLuma;        // Cell means
+  uint16_t* background;     // Background per cell (luma x 16)
+  uint8_t* diffMap;         // Per-cell difference (0 = no motion)
+  int cellsX;
+  int cellsY;
+  bool backgroundReady;
   int width;
   int height;
   float sensitivity;
   int minBlobSize;
   bool initialized;
+  unsigned long lastErrorLog;
+  
+  // Connected-component labelling (fixed size, no per-frame allocation)
+  uint8_t rowLabels[2][MOTION_MAX_CELLS_X];
+  uint8_t labelParent[MOTION_MAX_LABELS + 1];
+  MotionRegion regions[MOTION_MAX_LABELS + 1];
+  MotionBlob blobs[MOTION_MAX_BLOBS];
+  int blobCount;
+  
+  // Helper: Average blocks into cells
+  void buildCells(int gridW, int gridH);
+  
+  // Helper: Compare cells with background, returns number of moving cells
+  int updateBackground();
+  
+  // Helper: Find motion regions (fills blobs[], returns count)
+  int findMotionBlobs(uint8_t* diffMap, int w, int h);
   
-  // Helper: Calculate difference between frames
-  float calculateFrameDifference(uint8_t* frame1, uint8_t* frame2, size_t size);
+  // Helpers: Union-find over provisional labels
+  uint8_t findRoot(uint8_t label);
+  void unionLabels(uint8_t a, uint8_t b);
   
-  // Helper: Find motion regions
-  std::vector<MotionBlob> findMotionBlobs(uint8_t* diffMap, int w, int h);
+  // Helper: Merge regions closer than MOTION_MERGE_GAP, returns new count
+  int mergeRegions(int count);
 };
 
 #endif
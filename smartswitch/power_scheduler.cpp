@@ -0,0 +1,65 @@
+/**
+ * Power Scheduler Implementation
+ *
+ * Called from the processing task only, so state changes need no lock.
+ */
+
+#include "power_scheduler.h"
+#include <WiFi.h>
+#include "esp_wifi.h"
+
+PowerScheduler::PowerScheduler() {
+  powerSave = false;
+  idle = false;
+  lastActivity = 0;
+  idleSince = 0;
+  idleTotal = 0;
+  idleEntries = 0;
+}
+
+void PowerScheduler::begin(bool enablePowerSave) {
+  powerSave = enablePowerSave;
+  idle = false;
+  lastActivity = millis();
+}
+
+void PowerScheduler::update(bool activity) {
+  unsigned long now = millis();
+  
+  if (activity) {
+    lastActivity = now;
+    if (idle) {
+      exitIdle();
+    }
+  } else if (!idle && now - lastActivity >= SCHED_IDLE_AFTER) {
+    enterIdle();
+  }
+}
+
+unsigned long PowerScheduler::getIdleTime() {
+  return idleTotal + (idle ? millis() - idleSince : 0);
+}
+
+void PowerScheduler::enterIdle() {
+  idle = true;
+  idleSince = millis();
+  idleEntries++;
+  
+  if (powerSave) {
+    setCpuFrequencyMhz(SCHED_IDLE_CPU_MHZ);
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+  }
+  Serial.printf("💤 Room idle - analysing 1 frame every %d ms%s\n", SCHED_IDLE_FRAME_INTERVAL,
+                powerSave ? ", CPU and Wi-Fi in power save" : "");
+}
+
+void PowerScheduler::exitIdle() {
+  idle = false;
+  idleTotal += millis() - idleSince;
+  
+  if (powerSave) {
+    setCpuFrequencyMhz(SCHED_ACTIVE_CPU_MHZ);
+    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+  }
+  Serial.println("✓ Activity detected - full frame rate");
+}
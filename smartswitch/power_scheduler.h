@@ -0,0 +1,54 @@
+/**
+ * Power Scheduler Header
+ *
+ * Chooses the frame analysis rate from room activity. While detections,
+ * active zones or web viewers are present every frame is processed at
+ * full CPU clock; after a quiet period the processing task drops to
+ * about one frame per second and (optionally) lowers the CPU clock and
+ * lets the Wi-Fi modem sleep. The first detection restores full rate.
+ */
+
+#ifndef POWER_SCHEDULER_H
+#define POWER_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHED_IDLE_AFTER 30000          // Quiet time before idling (ms)
+#define SCHED_IDLE_FRAME_INTERVAL 1000  // Time between analysed frames while idle (ms)
+#define SCHED_ACTIVE_CPU_MHZ 240
+#define SCHED_IDLE_CPU_MHZ 80           // Lowest clock that keeps Wi-Fi running
+
+/**
+ * Power Scheduler Class
+ */
+class PowerScheduler {
+public:
+  PowerScheduler();
+  
+  // Start in the active state; powerSave enables CPU and modem scaling
+  void begin(bool powerSave);
+  
+  // Report one processed frame (activity = anything worth full rate)
+  void update(bool activity);
+  
+  // Wait before taking the next frame (0 = process frames as they arrive)
+  uint32_t getFrameDelay() { return idle ? SCHED_IDLE_FRAME_INTERVAL : 0; }
+  
+  // State
+  bool isIdle() { return idle; }
+  unsigned long getIdleTime();        // Total time spent idle (ms)
+  int getIdleEntries() { return idleEntries; }
+  
+private:
+  bool powerSave;
+  volatile bool idle;
+  unsigned long lastActivity;
+  unsigned long idleSince;
+  unsigned long idleTotal;
+  int idleEntries;
+  
+  void enterIdle();
+  void exitIdle();
+};
+
+#endif // POWER_SCHEDULER_H
@@ -10,7 +10,7 @@
  * - 5V dual-channel relay module
  * 
  * Features:
- * - MJPEG stream consumer from remote CCTV camera
+ * - MJPEG stream consumer from up to MAX_CAMERAS remote CCTV cameras
  * - TensorFlow Lite person detection
  * - Web-based zone drawing interface
  * - Zone-based relay activation with timeouts
@@ -20,33 +20,81 @@
 #include <WiFi.h>
 #include <LittleFS.h>
 #include "config.h"
+#include "frame_pool.h"
+#include "frame_mailbox.h"
 #include "mjpeg_stream.h"
+#include "jpeg_decoder.h"
 #include "motion_detector.h"
+#include "tflite_detector.h"
+#include "detector.h"
 #include "zone_manager.h"
 #include "web_server.h"
+#include "power_scheduler.h"
+#include "metrics.h"
 #include "utils.h"
 
 #define SPIFFS LittleFS  // Use LittleFS instead of SPIFFS
 
+/**
+ * Per-camera state: stream, motion background and detector pipeline.
+ * The person model, its decode buffer and the zone manager are shared;
+ * the processing task time-slices them between cameras.
+ */
+struct CameraChannel {
+  MJPEGStream stream;
+  MotionDetector motion;
+  MotionBackend motionBackend;
+  DetectionPipeline pipeline;
+  TaskHandle_t ingestTaskHandle;
+  unsigned long lastFrameTime;  // Watchdog: last frame analysed
+  bool wasConnected;
+  int frameCount;               // Frames analysed since the last stats line
+  std::vector<Detection> detections;   // Reused every frame (no per-frame allocation)
+  
+  CameraChannel() : motionBackend(&motion) {
+    ingestTaskHandle = nullptr;
+    lastFrameTime = 0;
+    wasConnected = false;
+    frameCount = 0;
+    detections.reserve(ZONE_MAX_DETECTIONS);
+  }
+};
+
 // Global objects
 Config globalConfig;
-MJPEGStream mjpegStream;
-MotionDetector motionDetector;
+FramePool framePool;
+CameraChannel channels[MAX_CAMERAS];
+int cameraCount = 1;              // Channels running (config cameras at boot)
+TFLiteDetector personDetector;
+PersonBackend personBackend(&personDetector);
 ZoneManager zoneManager;
 WebServerManager webServer;
+PowerScheduler powerScheduler;
 
-// Frame buffer
-uint8_t* frameBuffer = nullptr;
-size_t frameSize = 0;
+// Latest-frame hand-off between ingest (core 0) and processing (core 1),
+// cameras served in weighted round-robin
+FrameMailbox frameMailbox;
+TaskHandle_t processTaskHandle = nullptr;
+
+#define INGEST_TASK_CORE 0
+#define PROCESS_TASK_CORE 1
+#define INGEST_TASK_STACK 8192
+#define PROCESS_TASK_STACK 12288
+
+// Person model input is decoded straight from the JPEG at reduced scale
+#define PERSON_FRAME_MAX_PIXELS (320 * 240)
 
 // Watchdog timer variables
-unsigned long lastFrameTime = 0;
 const unsigned long WATCHDOG_TIMEOUT = 60000; // 60 seconds
 
+// A camera without frames for this long has its zone timeouts run without frames
+#define CAMERA_IDLE_CHECK 1000
+
 // Performance tracking
 unsigned long lastStatsTime = 0;
 int frameCount = 0;
 float avgFPS = 0.0;
+unsigned long frameAgeTotal = 0;  // Sum of ingest -> processing delays (ms)
 
 void setup() {
   Serial.begin(115200);
@@ -82,28 +130,63 @@ void setup() {
   Serial.println("✓ Hostname set to: smartswitch");
   Serial.println("  Access via: http://smartswitch.local/ (if mDNS supported)");
   
+  // Allocate frame slots once; the streams parse into them and readers lease them
+  cameraCount = constrain(globalConfig.numCameras, 1, MAX_CAMERAS);
+  if (!framePool.begin(FRAME_POOL_SLOTS + (cameraCount - 1) * FRAME_SLOTS_PER_CAMERA)) {
+    Serial.println("⚠ Frame pool allocation failed - camera stream disabled");
+  }
+  for (int c = 0; c < cameraCount; c++) {
+    channels[c].stream.setFramePool(&framePool);
+  }
+  
   // Initialize zone manager
   zoneManager.begin(&globalConfig);
   Serial.println("✓ Zone manager initialized");
   
-  // Initialize simple motion detector (lightweight, no AI)
-  if (motionDetector.begin(640, 480)) {
-    Serial.println("✓ Motion detector initialized");
-    Serial.println("  Motion in zones will trigger relays");
-    motionDetector.setSensitivity(0.15);  // Adjust 0.1-0.5 (lower = more sensitive)
-  } else {
-    Serial.println("⚠ Motion detector failed to initialize");
+  // Initialize simple motion detectors (lightweight, no AI), one background model per camera
+  for (int c = 0; c < cameraCount; c++) {
+    MotionDetector& motion = channels[c].motion;
+    if (motion.begin(640, 480)) {
+      Serial.printf("✓ Motion detector initialized (camera %d)\n", c + 1);
+      motion.setSensitivity(0.15);  // Adjust 0.1-0.5 (lower = more sensitive)
+    } else {
+      Serial.printf("⚠ Motion detector failed to initialize (camera %d)\n", c + 1);
+    }
+  }
+  Serial.println("  Motion in zones will trigger relays");
+  
+  // Load person model once if one was uploaded (arena stays allocated in PSRAM)
+  if (LittleFS.exists("/model.tflite")) {
+    if (personDetector.begin("/model.tflite")) {
+      char modelInfo[128];
+      personDetector.getModelInfo(modelInfo, sizeof(modelInfo));
+      Serial.printf("  %s\n", modelInfo);
+      personBackend.begin(PERSON_FRAME_MAX_PIXELS);
+    }
+  }
+  
+  // Motion gates the person model (or runs alone without one), see config.json "pipeline"
+  for (int c = 0; c < cameraCount; c++) {
+    channels[c].pipeline.begin(&channels[c].motionBackend, &personBackend, &zoneManager, c);
   }
   
   // Don't auto-connect to camera - let user test/start from web UI
   Serial.println("\n⚠ Camera not connected - configure and test via web interface");
-  Serial.println("  Current camera setting: http://" + String(globalConfig.cctvIP) + ":" + String(globalConfig.cctvPort) + globalConfig.streamPath);
+  for (int c = 0; c < cameraCount; c++) {
+    const CameraSource& camera = globalConfig.cameras[c];
+    Serial.printf("  Camera %d setting: http://%s:%d%s\n", c + 1, camera.ip, camera.port, camera.path);
+  }
   Serial.println("  Click 'Test Connection' in Settings tab to verify camera access");
   
-  // Start web server (pass NULL for TFLite detector - we're using motion)
+  // Start web server (TFLite detector only reported when a model is loaded)
   yield(); // Prevent watchdog
   delay(100);
-  webServer.begin(&globalConfig, &zoneManager, nullptr, &mjpegStream);
+  MJPEGStream* streams[MAX_CAMERAS];
+  for (int c = 0; c < cameraCount; c++) {
+    streams[c] = &channels[c].stream;
+  }
+  webServer.begin(&globalConfig, &zoneManager,
+                  personDetector.isInitialized() ? &personDetector : nullptr, streams, cameraCount);
   Serial.println("✓ Web server started");
   yield();
   
@@ -119,14 +202,28 @@ void setup() {
   Serial.println("⚙️  STEP 2: Configure camera (Settings tab)");
   Serial.println("   → Enter your camera's IP address and port");
   Serial.printf("   → Current: http://%s:%d%s\n\n", 
-                globalConfig.cctvIP, globalConfig.cctvPort, globalConfig.streamPath);
+                globalConfig.cameras[0].ip, globalConfig.cameras[0].port, globalConfig.cameras[0].path);
   Serial.println("🎯 STEP 3: Draw zones (Zones tab)");
   Serial.println("   → Click 'Draw Zone' button");
   Serial.println("   → Draw rectangles on video feed");
   Serial.println("   → Assign relay pins to each zone\n");
   
-  lastFrameTime = millis();
   lastStatsTime = millis();
+  powerScheduler.begin(globalConfig.powerSave);
+  
+  // Start the frame pipeline: one network ingest task per camera on core 0,
+  // processing on core 1
+  frameMailbox.begin(cameraCount);
+  for (int c = 0; c < cameraCount; c++) {
+    frameMailbox.setWeight(c, globalConfig.cameras[c].weight);
+    channels[c].lastFrameTime = millis();
+    xTaskCreatePinnedToCore(ingestTask, "Ingest", INGEST_TASK_STACK, (void*)(intptr_t)c, 2,
+                            &channels[c].ingestTaskHandle, INGEST_TASK_CORE);
+  }
+  xTaskCreatePinnedToCore(processTask, "Process", PROCESS_TASK_STACK, nullptr, 1,
+                          &processTaskHandle, PROCESS_TASK_CORE);
+  Serial.printf("✓ Frame pipeline started (%d camera%s, ingest: core 0, processing: core 1)\n",
+                cameraCount, cameraCount > 1 ? "s" : "");
 }
 
 void loop() {
@@ -141,102 +238,194 @@ void loop() {
     return;
   }
   
-  // Track camera connection state
-  static bool wasConnected = false;
-  bool isConnected = mjpegStream.isConnected();
-  
-  // Only process frames if camera is connected
-  if (!isConnected) {
-    // Camera not connected - just wait
-    wasConnected = false;
-    delay(500);
-    return;
-  }
-  
-  // Update lastFrameTime when camera first connects to prevent immediate timeout
-  if (isConnected && !wasConnected) {
-    Serial.println("Camera connection established - resetting watchdog timer");
-    lastFrameTime = millis();
-    wasConnected = true;
-  }
-  
-  // Watchdog timer: disable all relays if no frame received for too long
-  if (millis() - lastFrameTime > WATCHDOG_TIMEOUT) {
-    Serial.println("⚠ WATCHDOG TIMEOUT - No frames for 60s, disabling all relays!");
-    zoneManager.disableAllRelays();
-    mjpegStream.disconnect(); // Disconnect stuck stream
-    delay(1000); // Prevent log spam
-    return;
-  }
+  // Frames are handled by the ingest and processing tasks
+  delay(100);
+}
+
+/**
+ * Network ingest task (core 0, one per camera)
+ * 
+ * Reads the camera's MJPEG stream as fast as it arrives and posts each
+ * frame to the camera's mailbox slot. Never waits on detection, so the
+ * TCP socket keeps draining.
+ */
+void ingestTask(void* param) {
+  int camera = (int)(intptr_t)param;
+  MJPEGStream& mjpegStream = channels[camera].stream;
+  FrameLease incoming;
   
-  // Fetch next MJPEG frame
-  if (mjpegStream.fetchFrame(&frameBuffer, &frameSize)) {
-    lastFrameTime = millis();
-    frameCount++;
-    
-    // Use motion detection on raw JPEG frames (no decoding needed)
-    int width = 640;  // Assume default resolution
-    int height = 480;
-    
-    // Detect motion in current frame
-    std::vector<Detection> detections;
-    std::vector<MotionBlob> motionBlobs = motionDetector.detectMotion(frameBuffer, frameSize);
+  while (true) {
+    // Connects, reconnects with backoff, or handles a stop from the web UI
+    mjpegStream.service();
     
-    // Convert motion blobs to detections for zone manager
-    for (const MotionBlob& blob : motionBlobs) {
-      Detection det;
-      det.x = (float)blob.x / width;
-      det.y = (float)blob.y / height;
-      det.width = (float)blob.width / width;
-      det.height = (float)blob.height / height;
-      det.confidence = blob.intensity;
-      detections.push_back(det);
+    if (!mjpegStream.isConnected()) {
+      // Camera not connected (or backing off) - just wait
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
     }
     
-    if (true) {  // Always process frame
-      
-      // Update relay states based on detections and zones (if auto control enabled)
-      if (globalConfig.autoRelayControl) {
-        zoneManager.update(detections, width, height);
-      } else {
-        // Just log detections without controlling relays
-        if (detections.size() > 0) {
-          Serial.printf("👁 Motion detected but auto-relay control DISABLED\n");
-        }
+    if (mjpegStream.fetchFrame(&incoming)) {
+      frameMailbox.post(incoming, camera);
+      incoming.release();
+    } else {
+      // Failed to fetch frame - stream is down or stalled
+      static unsigned long lastErrorLog[MAX_CAMERAS];
+      if (millis() - lastErrorLog[camera] > 5000) {
+        Serial.printf("⚠ Failed to fetch MJPEG frame from camera %d - reconnecting\n", camera + 1);
+        lastErrorLog[camera] = millis();
       }
       
-      // Send frame to web UI clients (via WebSocket)
-      webServer.broadcastFrame(frameBuffer, frameSize, detections);
+      // Drop the link; service() dials again after the backoff
+      mjpegStream.disconnect();
+    }
+  }
+}
+
+/**
+ * Frame processing task (core 1)
+ * 
+ * Takes the newest frame of the next camera in the weighted round-robin;
+ * frames that arrived while a detector pass was running have already
+ * been replaced. While the room is idle the task sleeps between frames,
+ * so only the newest frames at each wake-up are analysed.
+ */
+void processTask(void* param) {
+  FrameLease frame;
+  
+  while (true) {
+    uint32_t frameDelay = powerScheduler.getFrameDelay();
+    if (frameDelay > 0) {
+      vTaskDelay(pdMS_TO_TICKS(frameDelay));
+    }
+    
+    int camera = 0;
+    if (frameMailbox.take(&frame, 1000, &camera)) {
+      processFrame(camera, frame);
       
-    } else {
-      Serial.println("⚠ Failed to decode JPEG frame");
+      // Done with this frame - slot returns to the pool once the web server drops it too
+      frame.release();
     }
     
-    // Calculate and display FPS stats every 10 seconds
-    if (millis() - lastStatsTime > 10000) {
-      avgFPS = frameCount / ((millis() - lastStatsTime) / 1000.0);
-      Serial.printf("📊 Performance: %.1f FPS, Free heap: %d bytes, PSRAM: %d bytes\n",
-                   avgFPS, ESP.getFreeHeap(), ESP.getFreePsram());
-      frameCount = 0;
-      lastStatsTime = millis();
+    // Cameras without frames (link down or reconnecting): their zone timeouts still run
+    for (int c = 0; c < cameraCount; c++) {
+      if (millis() - channels[c].lastFrameTime >= CAMERA_IDLE_CHECK) {
+        zoneManager.checkTimeouts(c);
+      }
     }
     
+    checkFrameWatchdog();
+  }
+}
+
+/**
+ * Run detection, zone logic and web fan-out for one frame of a camera
+ */
+void processFrame(int camera, const FrameLease& frame) {
+  int64_t frameStart = esp_timer_get_time();
+  CameraChannel& channel = channels[camera];
+  channel.lastFrameTime = millis();
+  channel.frameCount++;
+  frameCount++;
+  frameAgeTotal += millis() - frame.receivedAt();
+  
+  // Motion and/or person detections in normalized frame coordinates
+  std::vector<Detection>& detections = channel.detections;
+  detections.clear();
+  channel.pipeline.process(frame, &globalConfig, detections);
+  
+  // Update relay states based on detections and the camera's zones (if auto control enabled)
+  if (globalConfig.autoRelayControl) {
+    int64_t zoneStart = esp_timer_get_time();
+    zoneManager.update(detections, ZONE_CANVAS_WIDTH, ZONE_CANVAS_HEIGHT, camera);
+    metrics.record(STAGE_ZONE_UPDATE, zoneStart);
   } else {
-    // Failed to fetch frame - stream might be down
-    static unsigned long lastErrorLog = 0;
-    if (millis() - lastErrorLog > 5000) {
-      Serial.println("⚠ Failed to fetch MJPEG frame");
-      Serial.println("  Check camera connection in web interface");
-      lastErrorLog = millis();
-      
-      // Disconnect to prevent watchdog
-      mjpegStream.disconnect();
+    // Just log detections without controlling relays
+    if (detections.size() > 0) {
+      Serial.printf("👁 Motion detected but auto-relay control DISABLED\n");
     }
-    delay(100);
   }
   
-  // Small delay to prevent tight loop
-  delay(50); // Target ~20 FPS max (combined with processing time)
+  // Send frame to web UI clients (via WebSocket)
+  int64_t broadcastStart = esp_timer_get_time();
+  webServer.broadcastFrame(frame, detections, camera);
+  metrics.record(STAGE_WS_BROADCAST, broadcastStart);
+  
+  // Full rate while anything is happening or someone is watching live
+  powerScheduler.update(!detections.empty() || channel.pipeline.getGateHits() > 0 ||
+                        zoneManager.getActiveZoneCount() > 0 || webServer.getViewerCount() > 0);
+                        
+  // Calculate and display FPS stats every 10 seconds
+  if (millis() - lastStatsTime > 10000) {
+    avgFPS = frameCount / ((millis() - lastStatsTime) / 1000.0);
+    Serial.printf("📊 Performance: %.1f FPS, Free heap: %d bytes, PSRAM: %d bytes, Frame slots free: %d/%d\n",
+                 avgFPS, ESP.getFreeHeap(), ESP.getFreePsram(),
+                 framePool.getFreeSlots(), framePool.getSlotCount());
+    Serial.printf("   Queue wait: %lu ms avg, stale frames dropped: %d, %s (idle %lu s total)\n",
+                 frameAgeTotal / frameCount, frameMailbox.getStaleDrops(),
+                 powerScheduler.isIdle() ? "idle" : "active", powerScheduler.getIdleTime() / 1000);
+    unsigned long gateRuns = 0;
+    unsigned long confirmRuns = 0;
+    unsigned long confirmSkips = 0;
+    for (int c = 0; c < cameraCount; c++) {
+      gateRuns += channels[c].pipeline.getGateRuns();
+      confirmRuns += channels[c].pipeline.getConfirmRuns();
+      confirmSkips += channels[c].pipeline.getConfirmSkips();
+    }
+    Serial.printf("   Detectors: %lu gate runs, %lu person runs, %lu person skips\n",
+                 gateRuns, confirmRuns, confirmSkips);
+    if (cameraCount > 1) {
+      Serial.print("   Frames per camera:");
+      for (int c = 0; c < cameraCount; c++) {
+        Serial.printf(" #%d %d (weight %d)", c + 1, channels[c].frameCount, globalConfig.cameras[c].weight);
+      }
+      Serial.println();
+    }
+    for (int c = 0; c < cameraCount; c++) {
+      channels[c].frameCount = 0;
+    }
+    frameCount = 0;
+    frameAgeTotal = 0;
+    lastStatsTime = millis();
+  }
+  
+  metrics.count(COUNTER_FRAMES_PROCESSED);
+  metrics.record(STAGE_FRAME_TOTAL, frameStart);
+}
+
+/**
+ * Disable relays if a connected stream stops delivering frames
+ * (with several cameras only the stuck camera's zones are released)
+ */
+void checkFrameWatchdog() {
+  for (int c = 0; c < cameraCount; c++) {
+    CameraChannel& channel = channels[c];
+    
+    // Track camera connection state
+    if (!channel.stream.isConnected()) {
+      channel.wasConnected = false;
+      continue;
+    }
+    
+    // Update lastFrameTime when camera first connects to prevent immediate timeout
+    if (!channel.wasConnected) {
+      Serial.printf("Camera %d connection established - resetting watchdog timer\n", c + 1);
+      channel.lastFrameTime = millis();
+      channel.wasConnected = true;
+    }
+    
+    // Watchdog timer: disable relays if no frame received for too long
+    if (millis() - channel.lastFrameTime > WATCHDOG_TIMEOUT) {
+      if (cameraCount == 1) {
+        Serial.println("⚠ WATCHDOG TIMEOUT - No frames for 60s, disabling all relays!");
+        zoneManager.disableAllRelays();
+      } else {
+        Serial.printf("⚠ WATCHDOG TIMEOUT - No frames from camera %d for 60s, releasing its zones!\n", c + 1);
+        zoneManager.releaseCamera(c);
+      }
+      channel.stream.requestReconnect(); // Drop the stuck stream and dial again
+      channel.lastFrameTime = millis();
+    }
+  }
 }
 
 /**
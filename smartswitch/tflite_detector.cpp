@@ -1,56 +1,120 @@
 /**
  * TensorFlow Lite Person Detector Implementation
  * 
- * This is a framework for TFLite integration. Full implementation requires:
- * 1. TensorFlow Lite for Microcontrollers library
- * 2. Pre-trained quantized person detection model (.tflite file)
- * 3. Model-specific input/output tensor parsing
+ * Runs a quantized person model with TensorFlow Lite for Microcontrollers.
+ * Model flatbuffer and tensor arena live in PSRAM and are set up once in
+ * begin(); every frame reuses the same interpreter and input tensor.
  * 
- * For now, includes a motion detection fallback for testing.
+ * Falls back to simple motion detection when no model is available.
  */
 
 #include "tflite_detector.h"
+#include "utils.h"
 #include <LittleFS.h>
 
-// Uncomment when TFLite library is available:
-// #include "tensorflow/lite/micro/micro_interpreter.h"
-// #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
-// #include "tensorflow/lite/micro/system_setup.h"
-// #include "tensorflow/lite/schema/schema_generated.h"
+#if TFLITE_ENABLED
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#endif
 
 #define TENSOR_ARENA_SIZE (500 * 1024)  // 500KB for tensor operations
+#define TFLITE_OP_COUNT 11              // Ops registered in the resolver
 #define MIN_CONFIDENCE 0.5
+#define PERSON_CLASS_ID 0               // COCO SSD label map (person = 0)
+
+#if TFLITE_ENABLED
+// Only the ops used by person classifiers and SSD detectors, so the
+// linker can drop every other kernel
+static tflite::MicroMutableOpResolver<TFLITE_OP_COUNT>& getOpResolver() {
+  static tflite::MicroMutableOpResolver<TFLITE_OP_COUNT> resolver;
+  static bool registered = false;
+  
+  if (!registered) {
+    // Classifier backbone (MobileNet)
+    resolver.AddConv2D();
+    resolver.AddDepthwiseConv2D();
+    resolver.AddAveragePool2D();
+    resolver.AddReshape();
+    resolver.AddSoftmax();
+    resolver.AddAdd();
+    // Quantized I/O and SSD head
+    resolver.AddQuantize();
+    resolver.AddDequantize();
+    resolver.AddLogistic();
+    resolver.AddConcatenation();
+    resolver.AddDetectionPostprocess();
+    registered = true;
+  }
+  return resolver;
+}
+
+// Read output element as float (handles int8/uint8 quantization)
+static float outputValue(const TfLiteTensor* tensor, int index) {
+  switch (tensor->type) {
+    case kTfLiteInt8:
+      return (tensor->data.int8[index] - tensor->params.zero_point) * tensor->params.scale;
+    case kTfLiteUInt8:
+      return (tensor->data.uint8[index] - tensor->params.zero_point) * tensor->params.scale;
+    default:
+      return tensor->data.f[index];
+  }
+}
+#endif
 
 TFLiteDetector::TFLiteDetector() {
   initialized = false;
   interpreter = nullptr;
   model = nullptr;
+  modelData = nullptr;
+  modelSize = 0;
   tensorArena = nullptr;
   tensorArenaSize = TENSOR_ARENA_SIZE;
+  arenaUsed = 0;
+  input = nullptr;
+  inputBytes = nullptr;
+  memset(inputQuant, 0, sizeof(inputQuant));
+  inputFloat = false;
   inputWidth = 320;
   inputHeight = 240;
   inputChannels = 3;
   detectionThreshold = MIN_CONFIDENCE;
   lastInferenceTime = 0;
+  lastPreprocessTime = 0;
   previousFrame = nullptr;
   previousWidth = 0;
   previousHeight = 0;
 }
 
 TFLiteDetector::~TFLiteDetector() {
+#if TFLITE_ENABLED
+  delete interpreter;
+#endif
   if (tensorArena) {
     free(tensorArena);
   }
+  if (modelData) {
+    free(modelData);
+  }
   if (previousFrame) {
     free(previousFrame);
   }
 }
 
 bool TFLiteDetector::begin(const char* modelPath) {
+  if (initialized) {
+    return true;  // Model, arena and interpreter are set up only once
+  }
+  
   Serial.println("Initializing TFLite detector...");
   
+#if !TFLITE_ENABLED
+  Serial.println("⚠ TFLite disabled at build time (TFLITE_ENABLED=0) - using fallback detection");
+  return false;
+#endif
+
   // Check if PSRAM is available
-  if (ESP.getFreePsram() < TENSOR_ARENA_SIZE) {
+  if (!tensorArena && ESP.getFreePsram() < TENSOR_ARENA_SIZE) {
     Serial.println("⚠ WARNING: Insufficient PSRAM for TFLite");
     Serial.printf("   Available: %d bytes, Required: %d bytes\n", 
                  ESP.getFreePsram(), TENSOR_ARENA_SIZE);
@@ -58,24 +122,29 @@ bool TFLiteDetector::begin(const char* modelPath) {
     return false;
   }
   
-  // Load model from SPIFFS
+  // Load model from LittleFS
   if (!loadModel(modelPath)) {
     Serial.println("⚠ Model loading failed - using fallback detection");
     return false;
   }
   
-  // Allocate tensor arena
+  // Allocate tensor arena and interpreter
   if (!allocateTensors()) {
     Serial.println("⚠ Tensor allocation failed");
     return false;
   }
   
   initialized = true;
-  Serial.println("✓ TFLite detector initialized successfully");
+  Serial.printf("✓ TFLite detector initialized (input %dx%dx%d, arena %d/%d KB used)\n",
+                inputWidth, inputHeight, inputChannels, arenaUsed / 1024, tensorArenaSize / 1024);
   return true;
 }
 
 bool TFLiteDetector::loadModel(const char* path) {
+  if (modelData) {
+    return true;  // Already loaded
+  }
+  
   // Check if model file exists
   if (!LittleFS.exists(path)) {
     Serial.printf("Model file not found: %s\n", path);
@@ -88,40 +157,102 @@ bool TFLiteDetector::loadModel(const char* path) {
     return false;
   }
   
-  size_t modelSize = modelFile.size();
+  modelSize = modelFile.size();
   Serial.printf("Model size: %d bytes\n", modelSize);
   
-  // For actual TFLite implementation:
-  // 1. Read model data into buffer
-  // 2. Parse with tflite::GetModel()
-  // 3. Verify model schema version
-  // 4. Create interpreter with op resolver
+  // LittleFS files are not contiguous in flash, so read the flatbuffer
+  // into PSRAM once; the interpreter references it for the whole run
+  modelData = (uint8_t*)ps_malloc(modelSize);
+  if (!modelData) {
+    Serial.println("ERROR: Failed to allocate model buffer");
+    modelFile.close();
+    return false;
+  }
   
+  size_t bytesRead = modelFile.read(modelData, modelSize);
   modelFile.close();
   
-  // Placeholder: mark as loaded
-  Serial.println("⚠ TFLite model loading not fully implemented");
-  Serial.println("   Add TensorFlow Lite for Microcontrollers library for full support");
+  if (bytesRead != modelSize) {
+    Serial.printf("ERROR: Model read incomplete (%d of %d bytes)\n", bytesRead, modelSize);
+    free(modelData);
+    modelData = nullptr;
+    return false;
+  }
   
-  return false; // Return false until fully implemented
+#if TFLITE_ENABLED
+  model = tflite::GetModel(modelData);
+  if (model->version() != TFLITE_SCHEMA_VERSION) {
+    Serial.printf("ERROR: Model schema version %d, expected %d\n",
+                 model->version(), TFLITE_SCHEMA_VERSION);
+    free(modelData);
+    modelData = nullptr;
+    model = nullptr;
+    return false;
+  }
+#endif
+
+  return true;
 }
 
 bool TFLiteDetector::allocateTensors() {
-  // Allocate tensor arena in PSRAM
-  tensorArena = (uint8_t*)ps_malloc(tensorArenaSize);
+  // Allocate tensor arena in PSRAM (kept for the lifetime of the detector)
   if (!tensorArena) {
-    Serial.println("ERROR: Failed to allocate tensor arena");
+    tensorArena = (uint8_t*)ps_malloc(tensorArenaSize);
+    if (!tensorArena) {
+      Serial.println("ERROR: Failed to allocate tensor arena");
+      return false;
+    }
+    Serial.printf("Tensor arena allocated: %d bytes\n", tensorArenaSize);
+  }
+  
+#if TFLITE_ENABLED
+  if (!interpreter) {
+    interpreter = new tflite::MicroInterpreter(model, getOpResolver(), tensorArena, tensorArenaSize);
+  }
+  
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    Serial.println("ERROR: AllocateTensors() failed (arena too small or unsupported op)");
     return false;
   }
+  arenaUsed = interpreter->arena_used_bytes();
   
-  Serial.printf("Tensor arena allocated: %d bytes\n", tensorArenaSize);
+  // Input must be NHWC with 1 (grayscale) or 3 (RGB) channels
+  input = interpreter->input(0);
+  if (input->dims->size != 4 || (input->dims->data[3] != 1 && input->dims->data[3] != 3)) {
+    Serial.println("ERROR: Unsupported model input shape");
+    return false;
+  }
+  if (input->type != kTfLiteInt8 && input->type != kTfLiteUInt8 && input->type != kTfLiteFloat32) {
+    Serial.println("ERROR: Unsupported model input type");
+    return false;
+  }
   
-  // For actual TFLite implementation:
-  // 1. Create MicroInterpreter with model, op resolver, and tensor arena
-  // 2. Call AllocateTensors()
-  // 3. Get input/output tensor pointers
+  inputHeight = input->dims->data[1];
+  inputWidth = input->dims->data[2];
+  inputChannels = input->dims->data[3];
+  
+  // Quantized inputs are written directly by the fused preprocessing kernels,
+  // through a table built from the tensor's own quantization
+  inputBytes = nullptr;
+  inputFloat = input->type == kTfLiteFloat32;
+  if (!inputFloat) {
+    if (inputWidth > PREPROCESS_MAX_WIDTH) {
+      Serial.printf("ERROR: Quantized model input width %d exceeds %d\n", inputWidth, PREPROCESS_MAX_WIDTH);
+      return false;
+    }
+    if (!buildInputQuantTable(input->params.scale, input->params.zero_point, input->type == kTfLiteInt8, inputQuant)) {
+      Serial.printf("ERROR: Unsupported input quantization (scale %f, zero point %d): expected a [0,1] or [-1,1] pixel range\n",
+                    input->params.scale, (int)input->params.zero_point);
+      return false;
+    }
+    inputBytes = input->data.uint8;
+  }
   
+  Serial.printf("Tensor arena used: %d of %d bytes\n", arenaUsed, tensorArenaSize);
   return true;
+#else
+  return false;
+#endif
 }
 
 std::vector<Detection> TFLiteDetector::detect(uint16_t* frame, int width, int height) {
@@ -135,18 +266,13 @@ std::vector<Detection> TFLiteDetector::detect(uint16_t* frame, int width, int he
     return detections;
   }
   
-  // Preprocess frame
+  // Preprocess frame straight into the input tensor
   preprocessFrame(frame, width, height);
   
-  // Run inference (placeholder)
-  // For actual TFLite implementation:
-  // 1. Copy preprocessed data to input tensor
-  // 2. Call interpreter->Invoke()
-  // 3. Read output tensors
-  // 4. Parse bounding boxes and scores
-  
-  // Parse output
-  detections = parseOutputTensors();
+  // Run inference and parse output
+  if (runInference()) {
+    detections = parseOutputTensors();
+  }
   
   lastInferenceTime = millis() - startTime;
   return detections;
@@ -165,44 +291,216 @@ std::vector<Detection> TFLiteDetector::detectRGB(uint8_t* frame, int width, int
   preprocessFrameRGB(frame, width, height);
   
   // Run inference and parse output
-  detections = parseOutputTensors();
+  if (runInference()) {
+    detections = parseOutputTensors();
+  }
   
   lastInferenceTime = millis() - startTime;
   return detections;
 }
 
+std::vector<Detection> TFLiteDetector::detectGray(uint8_t* frame, int width, int height) {
+  unsigned long startTime = millis();
+  std::vector<Detection> detections;
+  
+  if (!initialized) {
+    lastInferenceTime = millis() - startTime;
+    return detections;
+  }
+  
+  // Preprocess grayscale frame
+  preprocessFrameGray(frame, width, height);
+  
+  // Run inference and parse output
+  if (runInference()) {
+    detections = parseOutputTensors();
+  }
+  
+  lastInferenceTime = millis() - startTime;
+  return detections;
+}
+
+bool TFLiteDetector::runInference() {
+#if TFLITE_ENABLED
+  if (interpreter->Invoke() != kTfLiteOk) {
+    Serial.println("ERROR: TFLite inference failed");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Store one pixel in a float input tensor, normalized to [0, 1]
+ * (quantized inputs are filled by the fused kernels in utils.cpp)
+ */
+void TFLiteDetector::writeInputPixel(int index, uint8_t r, uint8_t g, uint8_t b) {
+#if TFLITE_ENABLED
+  if (inputChannels == 1) {
+    input->data.f[index] = ((r * 77 + g * 150 + b * 29) >> 8) / 255.0f;
+    return;
+  }
+  
+  float* pixel = input->data.f + index * 3;
+  pixel[0] = r / 255.0f;
+  pixel[1] = g / 255.0f;
+  pixel[2] = b / 255.0f;
+#endif
+}
+
 void TFLiteDetector::preprocessFrame(uint16_t* frame, int width, int height) {
-  // Convert RGB565 to RGB888 and normalize
-  // Resize to model input size if needed
-  // For MobileNet: normalize to [-1, 1] or [0, 1]
+  unsigned long startTime = micros();
+  
+  // Quantized model: resize + convert + quantize in one pass into the tensor
+  // (allocateTensors checked its width; the 1-byte tensor never takes float writes)
+  if (inputBytes) {
+    resizeQuantizeRGB565(frame, width, height, inputBytes,
+                         inputWidth, inputHeight, inputChannels, inputQuant);
+    lastPreprocessTime = micros() - startTime;
+    return;
+  }
+  
+  if (!inputFloat) {
+    return;
+  }
   
-  // Placeholder implementation
+  // Float model: nearest-neighbour resize (16.16 fixed point steps)
+  uint32_t xStep = ((uint32_t)width << 16) / inputWidth;
+  uint32_t yStep = ((uint32_t)height << 16) / inputHeight;
+  int index = 0;
+  
+  for (int y = 0; y < inputHeight; y++) {
+    const uint16_t* row = frame + ((y * yStep) >> 16) * width;
+    for (int x = 0; x < inputWidth; x++, index++) {
+      uint16_t pixel = row[(x * xStep) >> 16];
+      uint8_t r = (pixel >> 8) & 0xF8;
+      uint8_t g = (pixel >> 3) & 0xFC;
+      uint8_t b = (pixel << 3) & 0xF8;
+      writeInputPixel(index, r, g, b);
+    }
+  }
+  lastPreprocessTime = micros() - startTime;
 }
 
 void TFLiteDetector::preprocessFrameRGB(uint8_t* frame, int width, int height) {
-  // Resize to model input size if needed
-  // Normalize pixel values
+  unsigned long startTime = micros();
   
-  // Placeholder implementation
+  if (inputBytes) {
+    resizeQuantizeRGB888(frame, width, height, inputBytes,
+                         inputWidth, inputHeight, inputChannels, inputQuant);
+    lastPreprocessTime = micros() - startTime;
+    return;
+  }
+  
+  if (!inputFloat) {
+    return;
+  }
+  
+  uint32_t xStep = ((uint32_t)width << 16) / inputWidth;
+  uint32_t yStep = ((uint32_t)height << 16) / inputHeight;
+  int index = 0;
+  
+  for (int y = 0; y < inputHeight; y++) {
+    const uint8_t* row = frame + ((y * yStep) >> 16) * width * 3;
+    for (int x = 0; x < inputWidth; x++, index++) {
+      const uint8_t* pixel = row + ((x * xStep) >> 16) * 3;
+      writeInputPixel(index, pixel[0], pixel[1], pixel[2]);
+    }
+  }
+  lastPreprocessTime = micros() - startTime;
+}
+
+void TFLiteDetector::preprocessFrameGray(uint8_t* frame, int width, int height) {
+  unsigned long startTime = micros();
+  
+  if (inputBytes) {
+    resizeQuantizeGray(frame, width, height, inputBytes,
+                       inputWidth, inputHeight, inputChannels, inputQuant);
+    lastPreprocessTime = micros() - startTime;
+    return;
+  }
+  
+  if (!inputFloat) {
+    return;
+  }
+  
+  uint32_t xStep = ((uint32_t)width << 16) / inputWidth;
+  uint32_t yStep = ((uint32_t)height << 16) / inputHeight;
+  int index = 0;
+  
+  for (int y = 0; y < inputHeight; y++) {
+    const uint8_t* row = frame + ((y * yStep) >> 16) * width;
+    for (int x = 0; x < inputWidth; x++, index++) {
+      uint8_t gray = row[(x * xStep) >> 16];
+      writeInputPixel(index, gray, gray, gray);
+    }
+  }
+  lastPreprocessTime = micros() - startTime;
 }
 
 std::vector<Detection> TFLiteDetector::parseOutputTensors() {
   std::vector<Detection> detections;
   
-  // For actual TFLite SSD model output parsing:
-  // Output tensors typically:
-  //   - Bounding boxes: [1, num_detections, 4] (y1, x1, y2, x2)
-  //   - Classes: [1, num_detections]
-  //   - Scores: [1, num_detections]
-  //   - Num detections: [1]
-  
-  // Parse and filter:
-  // 1. Iterate through detections
-  // 2. Filter by confidence threshold
-  // 3. Filter by class (person = 0 or 1 depending on model)
-  // 4. Create Detection objects
+#if TFLITE_ENABLED
+  if (interpreter->outputs_size() >= 4) {
+    // SSD postprocess output:
+    //   - Bounding boxes: [1, num_detections, 4] (y1, x1, y2, x2)
+    //   - Classes: [1, num_detections]
+    //   - Scores: [1, num_detections]
+    //   - Num detections: [1]
+    TfLiteTensor* boxes = interpreter->output(0);
+    TfLiteTensor* classes = interpreter->output(1);
+    TfLiteTensor* scores = interpreter->output(2);
+    TfLiteTensor* count = interpreter->output(3);
+    
+    int numDetections = min((int)outputValue(count, 0), scores->dims->data[1]);
+    
+    for (int i = 0; i < numDetections; i++) {
+      float score = outputValue(scores, i);
+      int classId = (int)outputValue(classes, i);
+      
+      // Filter: person class only, above confidence threshold
+      if (classId != PERSON_CLASS_ID || score < detectionThreshold) {
+        continue;
+      }
+      
+      float y1 = constrain(outputValue(boxes, i * 4 + 0), 0.0f, 1.0f);
+      float x1 = constrain(outputValue(boxes, i * 4 + 1), 0.0f, 1.0f);
+      float y2 = constrain(outputValue(boxes, i * 4 + 2), 0.0f, 1.0f);
+      float x2 = constrain(outputValue(boxes, i * 4 + 3), 0.0f, 1.0f);
+      
+      Detection det;
+      det.x = x1;
+      det.y = y1;
+      det.width = x2 - x1;
+      det.height = y2 - y1;
+      det.confidence = score;
+      det.classId = 0;
+      detections.push_back(det);
+    }
+    return detections;
+  }
   
-  // Placeholder: return empty
+  // Classifier output: [1, 2] {no person, person} or [1, 1] person score.
+  // No location, so a person is reported as a full-frame detection.
+  TfLiteTensor* output = interpreter->output(0);
+  int classes = output->dims->data[output->dims->size - 1];
+  float personScore = outputValue(output, classes > 1 ? 1 : 0);
+  
+  if (personScore >= detectionThreshold) {
+    Detection det;
+    det.x = 0.0;
+    det.y = 0.0;
+    det.width = 1.0;
+    det.height = 1.0;
+    det.confidence = personScore;
+    det.classId = 0;
+    detections.push_back(det);
+  }
+#endif
+
   return detections;
 }
 
@@ -281,8 +579,9 @@ std::vector<Detection> TFLiteDetector::motionDetection(uint16_t* frame, int widt
 void TFLiteDetector::getModelInfo(char* buffer, size_t bufferSize) {
   if (initialized) {
     snprintf(buffer, bufferSize, 
-            "Model: Loaded, Input: %dx%dx%d, Arena: %d KB",
-            inputWidth, inputHeight, inputChannels, tensorArenaSize / 1024);
+            "Model: Loaded, Input: %dx%dx%d, Arena: %d/%d KB used, Preprocess: %lu us",
+            inputWidth, inputHeight, inputChannels, arenaUsed / 1024, tensorArenaSize / 1024,
+            lastPreprocessTime);
   } else {
     snprintf(buffer, bufferSize, "Model: Not loaded (using motion detection fallback)");
   }
@@ -11,6 +11,19 @@
 #include <Arduino.h>
 #include <vector>
 
+// Build with TensorFlow Lite for Microcontrollers (set to 0 to build
+// without the library; detect() then uses the motion fallback)
+#ifndef TFLITE_ENABLED
+#define TFLITE_ENABLED 1
+#endif
+
+// TFLite types (headers only needed in tflite_detector.cpp)
+namespace tflite {
+  class MicroInterpreter;
+  struct Model;
+}
+struct TfLiteTensor;
+
 // Detection result structure
 struct Detection {
   float x;          // Bounding box top-left X (normalized 0-1)
@@ -24,15 +37,13 @@ struct Detection {
 /**
  * TFLite Detector Class
  * 
- * Note: This is a placeholder for TFLite integration.
- * Full implementation requires TensorFlow Lite for Microcontrollers library.
+ * The model is read from LittleFS into PSRAM once, the tensor arena is
+ * allocated once and the interpreter is reused for every frame.
  * 
- * To integrate:
- * 1. Include tensorflow/lite/micro headers
- * 2. Load model data from SPIFFS or embedded array
- * 3. Initialize interpreter with appropriate tensor arena
- * 4. Implement input preprocessing (resize, normalize)
- * 5. Run inference and parse output tensors
+ * Supported model outputs:
+ * - Classifier (person_detection style): [1, 2] {no person, person}
+ *   or [1, 1] person score - reported as one full-frame detection
+ * - SSD with TFLite_Detection_PostProcess: boxes, classes, scores, count
  */
 class TFLiteDetector {
 public:
@@ -48,6 +59,9 @@ public:
   // Run detection on RGB888 frame
   std::vector<Detection> detectRGB(uint8_t* frame, int width, int height);
   
+  // Run detection on 8-bit grayscale frame
+  std::vector<Detection> detectGray(uint8_t* frame, int width, int height);
+  
   // Check if model is loaded
   bool isInitialized() { return initialized; }
   
@@ -57,15 +71,37 @@ public:
   // Get last inference time
   unsigned long getLastInferenceTime() { return lastInferenceTime; }
   
+  // Get last preprocessing time (microseconds, part of inference time)
+  unsigned long getLastPreprocessTime() { return lastPreprocessTime; }
+  
+  // Arena bytes actually used by AllocateTensors()
+  size_t getArenaUsed() { return arenaUsed; }
+  
+  // Model input size
+  int getInputWidth() { return inputWidth; }
+  int getInputHeight() { return inputHeight; }
+  int getInputChannels() { return inputChannels; }
+  
+  // Set minimum confidence (default 0.5)
+  void setThreshold(float threshold) { detectionThreshold = threshold; }
+  
 private:
   bool initialized;
   unsigned long lastInferenceTime;
+  unsigned long lastPreprocessTime;
   
-  // TFLite components (placeholders - implement with actual TFLite library)
-  void* interpreter;        // TfLiteInterpreter pointer
-  void* model;              // TfLiteModel pointer
-  uint8_t* tensorArena;     // Memory arena for tensors
+  // TFLite components
+  tflite::MicroInterpreter* interpreter;
+  const tflite::Model* model;
+  uint8_t* modelData;       // Flatbuffer (PSRAM, loaded once)
+  size_t modelSize;
+  uint8_t* tensorArena;     // Memory arena for tensors (PSRAM, allocated once)
   size_t tensorArenaSize;
+  size_t arenaUsed;
+  TfLiteTensor* input;
+  uint8_t* inputBytes;      // Quantized input data (nullptr for float models)
+  uint8_t inputQuant[256];  // Pixel value -> input byte, from the tensor's scale / zero point
+  bool inputFloat;          // Float32 input (the only type writeInputPixel may touch)
   
   // Model parameters
   int inputWidth;
@@ -78,6 +114,9 @@ private:
   bool allocateTensors();
   void preprocessFrame(uint16_t* frame, int width, int height);
   void preprocessFrameRGB(uint8_t* frame, int width, int height);
+  void preprocessFrameGray(uint8_t* frame, int width, int height);
+  void writeInputPixel(int index, uint8_t r, uint8_t g, uint8_t b);
+  bool runInference();
   std::vector<Detection> parseOutputTensors();
   
   // Fallback: simple motion detection if TFLite fails
@@ -5,83 +5,69 @@
  */
 
 #include "utils.h"
+#include "jpeg_decoder.h"
 #include <WiFi.h>
 
-// Note: For JPEG decoding, you'll need to install a JPEG library
-// Recommended: "ESP32_JPEG" library or "jpegdec" library
-// For now, providing placeholder with Arduino-compatible approach
+// Shared decoder for the allocating helpers below. Hot paths should keep
+// their own JpegDecoder and decode into a preallocated buffer instead.
+static JpegDecoder sharedDecoder;
+
+static void* allocFrameBuffer(size_t size) {
+  void* buffer = psramFound() ? ps_malloc(size) : nullptr;
+  if (!buffer) {
+    buffer = malloc(size);
+  }
+  return buffer;
+}
 
 /**
- * Decode JPEG to RGB565 frame
- * 
- * Note: This requires a JPEG decoder library like:
- * - ESP32_JPEG by Bodmer
- * - JPEGDEC library
- * Install via Arduino Library Manager
+ * Decode a full JPEG into a newly allocated frame (caller frees)
  */
-bool decodeJPEG(uint8_t* jpegData, size_t jpegSize, uint16_t** rgbFrame, int* width, int* height) {
-  // Placeholder implementation
-  // For actual implementation, use a JPEG decoder library:
-  
-  /*
-  Example using JPEGDEC library:
-  
-  #include <JPEGDEC.h>
-  
-  JPEGDEC jpeg;
-  
-  // Open JPEG from memory
-  if (jpeg.openRAM(jpegData, jpegSize, nullptr)) {
-    *width = jpeg.getWidth();
-    *height = jpeg.getHeight();
-    
-    // Allocate RGB565 buffer
-    *rgbFrame = (uint16_t*)malloc((*width) * (*height) * sizeof(uint16_t));
-    if (*rgbFrame == nullptr) {
-      return false;
-    }
-    
-    // Decode to RGB565
-    jpeg.setPixelType(RGB565_BIG_ENDIAN);
-    jpeg.decode(0, 0, 0);
-    jpeg.close();
-    
-    return true;
+static bool decodeAllocated(uint8_t* jpegData, size_t jpegSize, JpegPixelFormat format,
+                            uint8_t** frame, int* width, int* height) {
+  *frame = nullptr;
+
+  int w = 0;
+  int h = 0;
+  if (!sharedDecoder.readInfo(jpegData, jpegSize, &w, &h)) {
+    Serial.printf("⚠ JPEG decode failed (%s)\n", sharedDecoder.getError());
+    return false;
   }
   
-  return false;
-  */
-  
-  // For now, return false and log
-  Serial.println("⚠ JPEG decoding not implemented - install JPEGDEC library");
-  Serial.println("   Library: JPEGDEC by Larry Bank");
-  Serial.println("   Arduino Library Manager: Search for 'JPEGDEC'");
+  size_t size = (size_t)w * h * JpegDecoder::bytesPerPixel(format);
+  uint8_t* buffer = (uint8_t*)allocFrameBuffer(size);
+  if (!buffer) {
+    Serial.println("ERROR: Failed to allocate JPEG frame buffer");
+    return false;
+  }
   
-  // Create dummy frame for testing (320x240 black screen)
-  *width = 320;
-  *height = 240;
-  *rgbFrame = (uint16_t*)malloc((*width) * (*height) * sizeof(uint16_t));
-  if (*rgbFrame) {
-    memset(*rgbFrame, 0, (*width) * (*height) * sizeof(uint16_t));
-    return true;
+  if (!sharedDecoder.decode(jpegData, jpegSize, JPEG_SCALE_FULL, format, buffer, size, width, height)) {
+    Serial.printf("⚠ JPEG decode failed (%s)\n", sharedDecoder.getError());
+    free(buffer);
+    return false;
   }
   
-  return false;
+  *frame = buffer;
+  return true;
+}
+
+/**
+ * Decode JPEG to RGB565 frame (allocates the result; prefer JpegDecoder::decode
+ * into a caller buffer, optionally scaled or grayscale)
+ */
+bool decodeJPEG(uint8_t* jpegData, size_t jpegSize, uint16_t** rgbFrame, int* width, int* height) {
+  return decodeAllocated(jpegData, jpegSize, JPEG_RGB565, (uint8_t**)rgbFrame, width, height);
 }
 
 /**
- * Decode JPEG to RGB888 frame
+ * Decode JPEG to RGB888 frame (allocates the result)
  */
 bool decodeJPEGToRGB888(uint8_t* jpegData, size_t jpegSize, uint8_t** rgbFrame, int* width, int* height) {
-  // Similar to RGB565 version but output RGB888
-  // Use JPEGDEC library with RGB888 format
-  
-  Serial.println("⚠ JPEG decoding to RGB888 not implemented");
-  return false;
+  return decodeAllocated(jpegData, jpegSize, JPEG_RGB888, rgbFrame, width, height);
 }
 
 /**
- * Resize frame using nearest neighbor
+ * Resize frame using nearest neighbor (allocates the result; prefer resizeFrameInto)
  */
 uint16_t* resizeFrame(uint16_t* frame, int srcWidth, int srcHeight, int dstWidth, int dstHeight) {
   if (srcWidth == dstWidth && srcHeight == dstHeight) {
@@ -95,27 +81,39 @@ uint16_t* resizeFrame(uint16_t* frame, int srcWidth, int srcHeight, int dstWidth
     return nullptr;
   }
   
-  float xRatio = (float)srcWidth / dstWidth;
-  float yRatio = (float)srcHeight / dstHeight;
+  resizeFrameInto(frame, srcWidth, srcHeight, resized, dstWidth, dstHeight);
+  return resized;
+}
+
+/**
+ * Resize frame into a caller buffer using nearest neighbor (16.16 fixed point)
+ */
+void resizeFrameInto(const uint16_t* src, int srcWidth, int srcHeight,
+                     uint16_t* dst, int dstWidth, int dstHeight) {
+  uint32_t xStep = ((uint32_t)srcWidth << 16) / dstWidth;
+  uint32_t yStep = ((uint32_t)srcHeight << 16) / dstHeight;
+  uint32_t srcY = 0;
   
-  for (int y = 0; y < dstHeight; y++) {
-    for (int x = 0; x < dstWidth; x++) {
-      int srcX = (int)(x * xRatio);
-      int srcY = (int)(y * yRatio);
-      resized[y * dstWidth + x] = frame[srcY * srcWidth + srcX];
+  for (int y = 0; y < dstHeight; y++, srcY += yStep) {
+    const uint16_t* row = src + (srcY >> 16) * srcWidth;
+    uint32_t srcX = 0;
+    for (int x = 0; x < dstWidth; x++, srcX += xStep) {
+      *dst++ = row[srcX >> 16];
     }
   }
-  
-  return resized;
 }
 
 /**
  * Convert RGB565 to RGB888
  */
 void convertRGB565toRGB888(uint16_t* rgb565, uint8_t* rgb888, int width, int height) {
-  for (int i = 0; i < width * height; i++) {
+  int count = width * height;
+  for (int i = 0; i < count; i++) {
     uint16_t pixel = rgb565[i];
-    rgb565to888(pixel, &rgb888[i * 3], &rgb888[i * 3 + 1], &rgb888[i * 3 + 2]);
+    rgb888[0] = (pixel >> 8) & 0xF8;
+    rgb888[1] = (pixel >> 3) & 0xFC;
+    rgb888[2] = (pixel << 3) & 0xF8;
+    rgb888 += 3;
   }
 }
 
@@ -123,9 +121,197 @@ void convertRGB565toRGB888(uint16_t* rgb565, uint8_t* rgb888, int width, int hei
  * Convert RGB888 to RGB565
  */
 void convertRGB888toRGB565(uint8_t* rgb888, uint16_t* rgb565, int width, int height) {
-  for (int i = 0; i < width * height; i++) {
-    rgb565[i] = rgb888to565(rgb888[i * 3], rgb888[i * 3 + 1], rgb888[i * 3 + 2]);
+  int count = width * height;
+  for (int i = 0; i < count; i++) {
+    rgb565[i] = ((rgb888[0] & 0xF8) << 8) | ((rgb888[1] & 0xFC) << 3) | (rgb888[2] >> 3);
+    rgb888 += 3;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Fused preprocessing kernels
+//
+// One pass per output pixel: fetch the four source neighbours, convert,
+// blend with 8-bit fixed point weights and store the quantized byte.
+// Column sample positions are computed once per call, rows on the fly.
+// ---------------------------------------------------------------------------
+
+/**
+ * Bilinear sample position along one axis
+ */
+struct AxisSample {
+  uint16_t index0;
+  uint16_t index1;
+  uint16_t weight;    // Weight of index1 (0-256)
+};
+
+static inline AxisSample axisSample(int32_t pos, int srcSize) {
+  AxisSample sample;
+  if (pos < 0) {
+    pos = 0;
+  }
+  sample.index0 = pos >> 16;
+  sample.weight = (pos >> 8) & 0xFF;
+  if (sample.index0 >= srcSize - 1) {
+    sample.index0 = srcSize - 1;
+    sample.weight = 0;
+  }
+  sample.index1 = min(sample.index0 + 1, srcSize - 1);
+  return sample;
+}
+
+// Pixel centres line up: src = (dst + 0.5) * ratio - 0.5, in 16.16
+static inline int32_t axisStart(int32_t step) {
+  return step / 2 - 0x8000;
+}
+
+static inline int blend(int a, int b, int weight) {
+  return a + (((b - a) * weight) >> 8);
+}
+
+static inline uint8_t lumaOf(int r, int g, int b) {
+  return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+struct RGB565Pixels {
+  const uint16_t* data;
+  int width;
+  
+  inline void load(int x, int y, int* rgb) const {
+    uint16_t pixel = data[y * width + x];
+    rgb[0] = (pixel >> 8) & 0xF8;
+    rgb[1] = (pixel >> 3) & 0xFC;
+    rgb[2] = (pixel << 3) & 0xF8;
+  }
+  inline int loadLuma(int x, int y) const {
+    int rgb[3];
+    load(x, y, rgb);
+    return lumaOf(rgb[0], rgb[1], rgb[2]);
+  }
+};
+
+struct RGB888Pixels {
+  const uint8_t* data;
+  int width;
+  
+  inline void load(int x, int y, int* rgb) const {
+    const uint8_t* pixel = data + (y * width + x) * 3;
+    rgb[0] = pixel[0];
+    rgb[1] = pixel[1];
+    rgb[2] = pixel[2];
+  }
+  inline int loadLuma(int x, int y) const {
+    const uint8_t* pixel = data + (y * width + x) * 3;
+    return lumaOf(pixel[0], pixel[1], pixel[2]);
+  }
+};
+
+struct GrayPixels {
+  const uint8_t* data;
+  int width;
+  
+  inline void load(int x, int y, int* rgb) const {
+    rgb[0] = rgb[1] = rgb[2] = data[y * width + x];
+  }
+  inline int loadLuma(int x, int y) const {
+    return data[y * width + x];
+  }
+};
+
+template <typename Pixels>
+static bool resizeQuantize(const Pixels& src, int srcWidth, int srcHeight,
+                           uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable) {
+  if (!src.data || !dst || !quantTable || srcWidth < 1 || srcHeight < 1 || dstWidth < 1 || dstHeight < 1 ||
+      dstWidth > PREPROCESS_MAX_WIDTH || (channels != 1 && channels != 3)) {
+    return false;
+  }
+  
+  AxisSample columns[PREPROCESS_MAX_WIDTH];
+  int32_t xStep = ((int32_t)srcWidth << 16) / dstWidth;
+  int32_t xPos = axisStart(xStep);
+  for (int x = 0; x < dstWidth; x++, xPos += xStep) {
+    columns[x] = axisSample(xPos, srcWidth);
+  }
+  
+  int32_t yStep = ((int32_t)srcHeight << 16) / dstHeight;
+  int32_t yPos = axisStart(yStep);
+  
+  for (int y = 0; y < dstHeight; y++, yPos += yStep) {
+    AxisSample row = axisSample(yPos, srcHeight);
+    
+    if (channels == 1) {
+      for (int x = 0; x < dstWidth; x++) {
+        const AxisSample& col = columns[x];
+        int top = blend(src.loadLuma(col.index0, row.index0), src.loadLuma(col.index1, row.index0), col.weight);
+        int bottom = blend(src.loadLuma(col.index0, row.index1), src.loadLuma(col.index1, row.index1), col.weight);
+        *dst++ = quantTable[blend(top, bottom, row.weight)];
+      }
+      continue;
+    }
+    
+    for (int x = 0; x < dstWidth; x++) {
+      const AxisSample& col = columns[x];
+      int p00[3], p01[3], p10[3], p11[3];
+      src.load(col.index0, row.index0, p00);
+      src.load(col.index1, row.index0, p01);
+      src.load(col.index0, row.index1, p10);
+      src.load(col.index1, row.index1, p11);
+      
+      for (int c = 0; c < 3; c++) {
+        int top = blend(p00[c], p01[c], col.weight);
+        int bottom = blend(p10[c], p11[c], col.weight);
+        *dst++ = quantTable[blend(top, bottom, row.weight)];
+      }
+    }
+  }
+  
+  return true;
+}
+
+bool resizeQuantizeRGB565(const uint16_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable) {
+  RGB565Pixels pixels = {src, srcWidth};
+  return resizeQuantize(pixels, srcWidth, srcHeight, dst, dstWidth, dstHeight, channels, quantTable);
+}
+
+bool resizeQuantizeRGB888(const uint8_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable) {
+  RGB888Pixels pixels = {src, srcWidth};
+  return resizeQuantize(pixels, srcWidth, srcHeight, dst, dstWidth, dstHeight, channels, quantTable);
+}
+
+bool resizeQuantizeGray(const uint8_t* src, int srcWidth, int srcHeight,
+                        uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable) {
+  GrayPixels pixels = {src, srcWidth};
+  return resizeQuantize(pixels, srcWidth, srcHeight, dst, dstWidth, dstHeight, channels, quantTable);
+}
+
+bool buildInputQuantTable(float scale, int32_t zeroPoint, bool signedOutput, uint8_t* table) {
+  if (!table || !(scale > 0.0f) || !isfinite(scale)) {
+    return false;
+  }
+  
+  // Real values the tensor can represent
+  const int qMin = signedOutput ? -128 : 0;
+  const int qMax = signedOutput ? 127 : 255;
+  float low = (qMin - zeroPoint) * scale;
+  float high = (qMax - zeroPoint) * scale;
+  
+  // Models normalize pixels to [0, 1] or [-1, 1]; the range must cover it
+  // (to within a step or two) without wasting much resolution
+  float normLow = low < -0.5f ? -1.0f : 0.0f;
+  float span = 1.0f - normLow;
+  if (low > normLow + scale || high < 1.0f - 1.5f * scale || (high - low) > span * 1.25f) {
+    return false;
+  }
+  
+  for (int v = 0; v < 256; v++) {
+    float real = normLow + v * span / 255.0f;
+    int q = (int)lroundf(real / scale) + zeroPoint;
+    q = constrain(q, qMin, qMax);
+    table[v] = (uint8_t)q;   // int8 two's complement for signed tensors
   }
+  return true;
 }
 
 /**
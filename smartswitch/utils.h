@@ -18,6 +18,29 @@ uint16_t* resizeFrame(uint16_t* frame, int srcWidth, int srcHeight, int dstWidth
 void convertRGB565toRGB888(uint16_t* rgb565, uint8_t* rgb888, int width, int height);
 void convertRGB888toRGB565(uint8_t* rgb888, uint16_t* rgb565, int width, int height);
 
+// Preprocessing kernels (caller-owned buffers, no allocation)
+#define PREPROCESS_MAX_WIDTH 640    // Widest destination row the kernels support
+
+// Nearest-neighbour resize into dst
+void resizeFrameInto(const uint16_t* src, int srcWidth, int srcHeight,
+                     uint16_t* dst, int dstWidth, int dstHeight);
+                     
+// Fused bilinear resize + color conversion + quantization in one pass.
+// Writes dstWidth x dstHeight x channels (1 = luma, 3 = RGB) bytes, each
+// 0..255 value mapped through quantTable (see buildInputQuantTable).
+bool resizeQuantizeRGB565(const uint16_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable);
+bool resizeQuantizeRGB888(const uint8_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable);
+bool resizeQuantizeGray(const uint8_t* src, int srcWidth, int srcHeight,
+                        uint8_t* dst, int dstWidth, int dstHeight, int channels, const uint8_t* quantTable);
+                        
+// 256-entry pixel -> tensor byte table for a quantized input tensor:
+// q = clamp(round(real / scale) + zeroPoint), real = v / 255 for models
+// whose quantized range is [0, 1], or v / 127.5 - 1 for [-1, 1] models.
+// False when scale / zeroPoint describe neither range.
+bool buildInputQuantTable(float scale, int32_t zeroPoint, bool signedOutput, uint8_t* table);
+
 // Color conversion helpers
 uint16_t rgb888to565(uint8_t r, uint8_t g, uint8_t b);
 void rgb565to888(uint16_t rgb565, uint8_t* r, uint8_t* g, uint8_t* b);
@@ -9,6 +9,9 @@
 #include <LittleFS.h>
 #include <HTTPClient.h>
 #include "config.h"
+#include "metrics.h"
+
+static const char* const linkStateNames[] = {"idle", "connecting", "connected", "retrying"};
 
 WebServerManager::WebServerManager() {
   server = nullptr;
@@ -17,8 +20,26 @@ WebServerManager::WebServerManager() {
   config = nullptr;
   zoneManager = nullptr;
   detector = nullptr;
-  lastBroadcast = 0;
+  memset(streams, 0, sizeof(streams));
+  streamCount = 0;
+  memset(viewers, 0, sizeof(viewers));
+  viewerLock = nullptr;
+  jsonDoc = nullptr;
+  jsonLock = nullptr;
+  framesSent = 0;
+  framesDropped = 0;
+  viewerEvictions = 0;
   apMode = false;
+  memset(&pushed, 0, sizeof(pushed));
+  memset(pushed.cameraState, 0xFF, sizeof(pushed.cameraState));
+  pendingChanges = 0;
+  lastStatsPush = 0;
+  lastSystemPush = 0;
+  frameMux = portMUX_INITIALIZER_UNLOCKED;
+  testState = TEST_IDLE;
+  testURL[0] = '\0';
+  testCode = -1;
+  testFinishedAt = 0;
 }
 
 WebServerManager::~WebServerManager() {
@@ -32,13 +53,30 @@ WebServerManager::~WebServerManager() {
     dnsServer->stop();
     delete dnsServer;
   }
+  if (viewerLock) {
+    vSemaphoreDelete(viewerLock);
+  }
+  if (jsonDoc) {
+    delete jsonDoc;
+  }
+  if (jsonLock) {
+    vSemaphoreDelete(jsonLock);
+  }
 }
 
-void WebServerManager::begin(Config* cfg, ZoneManager* zoneMgr, TFLiteDetector* det, MJPEGStream* stream) {
+void WebServerManager::begin(Config* cfg, ZoneManager* zoneMgr, TFLiteDetector* det,
+                             MJPEGStream** cameraStreams, int cameraCount) {
   config = cfg;
   zoneManager = zoneMgr;
   detector = det;
-  mjpegStream = stream;
+  streamCount = constrain(cameraCount, 0, MAX_CAMERAS);
+  for (int i = 0; i < streamCount; i++) {
+    streams[i] = cameraStreams[i];
+  }
+  
+  // First push fills the state cache
+  pendingChanges = ZONE_CHANGED_LIST | ZONE_CHANGED_RELAYS;
+  lastSystemPush = millis() - WS_SYSTEM_INTERVAL;
   apMode = false;
   
   Serial.println("Creating web server...");
@@ -50,6 +88,13 @@ void WebServerManager::begin(Config* cfg, ZoneManager* zoneMgr, TFLiteDetector*
   Serial.println("Creating WebSocket...");
   yield();
   
+  viewerLock = xSemaphoreCreateMutex();
+  
+  // One JSON document for every response, allocated once so large
+  // replies do not fragment the heap
+  jsonDoc = new PooledJsonDocument(WEB_JSON_DOC_SIZE);
+  jsonLock = xSemaphoreCreateMutex();
+  
   // Create WebSocket
   ws = new AsyncWebSocket("/ws");
   ws->onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client,
@@ -114,6 +159,12 @@ void WebServerManager::setupRoutes() {
   // Serve static files
   server->serveStatic("/", LittleFS, "/");
   
+  // API: Export configuration to config.json/zones.json (registered before
+  // /api/config, which would otherwise match it as a sub-path)
+  server->on("/api/config/export", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    handleExportConfig(request);
+  });
+  
   // API: Get configuration
   server->on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
     handleGetConfig(request);
@@ -125,7 +176,7 @@ void WebServerManager::setupRoutes() {
     [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
       handleSaveConfig(request, data, len);
     });
-  
+    
   // API: Get zones
   server->on("/api/zones", HTTP_GET, [this](AsyncWebServerRequest* request) {
     handleGetZones(request);
@@ -137,14 +188,14 @@ void WebServerManager::setupRoutes() {
     [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
       handleAddZone(request, data, len);
     });
-  
+    
   // API: Update zone
   server->on("/api/zones/update", HTTP_POST, [](AsyncWebServerRequest* request) {},
     nullptr,
     [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
       handleUpdateZone(request, data, len);
     });
-  
+    
   // API: Delete zone
   server->on("/api/zones/delete", HTTP_DELETE, [this](AsyncWebServerRequest* request) {
     handleDeleteZone(request);
@@ -170,6 +221,11 @@ void WebServerManager::setupRoutes() {
     handleGetStatistics(request);
   });
   
+  // API: Pipeline latency histograms and counters (Prometheus text format)
+  server->on("/api/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    handleGetMetrics(request);
+  });
+  
   // API: Reset statistics
   server->on("/api/statistics/reset", HTTP_POST, [this](AsyncWebServerRequest* request) {
     handleResetStatistics(request);
@@ -214,11 +270,335 @@ void WebServerManager::setupRoutes() {
 void WebServerManager::handleClient() {
   // Cleanup WebSocket clients
   ws->cleanupClients();
+  
+  // Probe RTT and close viewers that stopped draining or answering pings
+  unsigned long now = millis();
+  xSemaphoreTake(viewerLock, portMAX_DELAY);
+  for (AsyncWebSocketClient* client : ws->getClients()) {
+    WsViewer* viewer = findViewer(client->id());
+    if (!viewer || client->status() != WS_CONNECTED) {
+      continue;
+    }
+    
+    bool stalled = viewer->stalledSince && now - viewer->stalledSince > WS_STALL_TIMEOUT;
+    bool silent = now - viewer->lastPongAt > WS_STALL_TIMEOUT;
+    if (stalled || silent) {
+      Serial.printf("⚠ WebSocket client #%u stalled (rtt %u ms, %u dropped) - closing\n",
+                    client->id(), viewer->rtt, viewer->framesDropped);
+      viewer->clientId = 0;
+      viewerEvictions++;
+      client->close();
+      continue;
+    }
+    
+    if (now - viewer->lastPingAt >= WS_PING_INTERVAL) {
+      viewer->lastPingAt = now;
+      client->ping();
+    }
+  }
+  xSemaphoreGive(viewerLock);
+  
+  pushStateChanges();
+}
+
+/**
+ * Push what changed since the last delta to every viewer, then the cached
+ * state to viewers that just connected or asked to resync. Deltas carry
+ * absolute values numbered by "v"; a viewer that sees a gap (the socket
+ * drops text messages when a client's queue is full) sends {"resync":true}.
+ */
+void WebServerManager::pushStateChanges() {
+  unsigned long now = millis();
+  pendingChanges |= zoneManager->takeChanges();
+  
+  if (pendingChanges & ZONE_CHANGED_LIST) {
+    // New zone list first, then the state of every zone again
+    if (ws->count() > 0) {
+      // Runs on the loop task, beside zone edits: zone names are held by
+      // pointer, so config->zones must stay put until they are serialized
+      JsonObject doc = lockJsonDoc();
+      zoneManager->lock();
+      buildZones(doc);
+      xSemaphoreTake(viewerLock, portMAX_DELAY);
+      textJsonDoc(nullptr, 0);
+      xSemaphoreGive(viewerLock);
+      zoneManager->unlock();
+      unlockJsonDoc();
+    }
+    pushed.zoneCount = 0;
+    pendingChanges = (pendingChanges & ~ZONE_CHANGED_LIST) | ZONE_CHANGED_ACTIVE | ZONE_CHANGED_STATS;
+    lastStatsPush = now - WS_STATS_INTERVAL;
+  }
+  
+  // Relay and zone transitions go out at once, counters and system info are rate limited
+  uint32_t due = pendingChanges & (ZONE_CHANGED_RELAYS | ZONE_CHANGED_ACTIVE);
+  if ((pendingChanges & ZONE_CHANGED_STATS) && now - lastStatsPush >= WS_STATS_INTERVAL) {
+    due |= ZONE_CHANGED_STATS;
+    lastStatsPush = now;
+  }
+  bool systemDue = now - lastSystemPush >= WS_SYSTEM_INTERVAL;
+  if (systemDue) {
+    lastSystemPush = now;
+  }
+  pendingChanges &= ~due;
+  
+  bool camerasChanged = false;
+  for (int c = 0; c < streamCount; c++) {
+    camerasChanged |= streams[c]->getLinkState() != pushed.cameraState[c];
+  }
+  
+  if (due || systemDue || camerasChanged) {
+    JsonObject root = lockJsonDoc();
+    root["type"] = "state";
+    zoneManager->lock();
+    bool changed = buildStateDelta(root, due, systemDue);
+    zoneManager->unlock();
+    if (changed) {
+      root["v"] = ++pushed.version;
+      if (ws->count() > 0) {
+        xSemaphoreTake(viewerLock, portMAX_DELAY);
+        textJsonDoc(nullptr, 0);
+        xSemaphoreGive(viewerLock);
+      }
+    }
+    unlockJsonDoc();
+  }
+  
+  // Full state for viewers that have none
+  AsyncWebSocketClient* pending[WS_MAX_VIEWERS];
+  int pendingCount = 0;
+  JsonObject root = lockJsonDoc();
+  xSemaphoreTake(viewerLock, portMAX_DELAY);
+  for (AsyncWebSocketClient* client : ws->getClients()) {
+    WsViewer* viewer = findViewer(client->id());
+    if (viewer && viewer->needsState && client->status() == WS_CONNECTED && pendingCount < WS_MAX_VIEWERS) {
+      viewer->needsState = false;
+      pending[pendingCount++] = client;
+    }
+  }
+  
+  if (pendingCount > 0) {
+    buildFullState(root);
+    textJsonDoc(pending, pendingCount);
+  }
+  xSemaphoreGive(viewerLock);
+  unlockJsonDoc();
+}
+
+/**
+ * Add the fields that differ from the cache to root and update the cache;
+ * false if nothing changed
+ */
+bool WebServerManager::buildStateDelta(JsonObject root, uint32_t due, bool systemDue) {
+  bool changed = false;
+  
+  if (due & ZONE_CHANGED_RELAYS) {
+    JsonArray list;
+    int count = zoneManager->getRelayCount();
+    int previousPin[MAX_RELAYS];
+    memcpy(previousPin, pushed.relayPin, sizeof(previousPin));
+    for (int i = 0; i < count; i++) {
+      int pin = zoneManager->getRelayPin(i);
+      bool active = zoneManager->getRelayState(pin);
+      if (i < pushed.relayCount && pushed.relayPin[i] == pin && pushed.relayActive[i] == active) {
+        continue;
+      }
+      if (list.isNull()) {
+        list = root.createNestedArray("relays");
+      }
+      JsonObject obj = list.createNestedObject();
+      obj["pin"] = pin;
+      obj["active"] = active;
+      pushed.relayPin[i] = pin;
+      pushed.relayActive[i] = active;
+    }
+    
+    // Pins dropped from the relay table (no zone uses them any more)
+    JsonArray removed;
+    for (int i = 0; i < pushed.relayCount; i++) {
+      if (i < count && pushed.relayPin[i] == previousPin[i]) {
+        continue;
+      }
+      bool kept = false;
+      for (int j = 0; j < count && !kept; j++) {
+        kept = pushed.relayPin[j] == previousPin[i];
+      }
+      if (!kept) {
+        if (removed.isNull()) {
+          removed = root.createNestedArray("relaysRemoved");
+        }
+        removed.add(previousPin[i]);
+      }
+    }
+    pushed.relayCount = count;
+    changed |= !list.isNull() || !removed.isNull();
+  }
+  
+  int zoneCount = min((int)config->zones.size(), zoneManager->getZoneCount());
+  if (due & ZONE_CHANGED_ACTIVE) {
+    JsonArray list;
+    for (int i = 0; i < zoneCount; i++) {
+      int id = config->zones[i].id;
+      bool active = zoneManager->isZoneActiveAt(i);
+      if (i < pushed.zoneCount && pushed.zoneId[i] == id && pushed.zoneActive[i] == active) {
+        continue;
+      }
+      if (list.isNull()) {
+        list = root.createNestedArray("zones");
+      }
+      JsonObject obj = list.createNestedObject();
+      obj["id"] = id;
+      obj["active"] = active;
+      pushed.zoneId[i] = id;
+      pushed.zoneActive[i] = active;
+    }
+    changed |= !list.isNull();
+  }
+  
+  if (due & ZONE_CHANGED_STATS) {
+    JsonObject stats = root.createNestedObject("stats");
+    pushed.totalDetections = zoneManager->getTotalDetections();
+    stats["totalDetections"] = pushed.totalDetections;
+    JsonArray list = stats.createNestedArray("zones");
+    for (int i = 0; i < zoneCount; i++) {
+      int id = config->zones[i].id;
+      int detections = zoneManager->getZoneDetectionCountAt(i);
+      if (i < pushed.zoneCount && pushed.zoneId[i] == id && pushed.zoneDetections[i] == detections) {
+        continue;
+      }
+      JsonObject obj = list.createNestedObject();
+      obj["id"] = id;
+      obj["detections"] = detections;
+      pushed.zoneId[i] = id;
+      pushed.zoneDetections[i] = detections;
+    }
+    changed = true;
+  }
+  
+  // Zone entries are complete once both halves were refreshed
+  if ((due & (ZONE_CHANGED_ACTIVE | ZONE_CHANGED_STATS)) == (ZONE_CHANGED_ACTIVE | ZONE_CHANGED_STATS)) {
+    pushed.zoneCount = zoneCount;
+  }
+  
+  JsonArray cameras;
+  for (int c = 0; c < streamCount; c++) {
+    uint8_t state = streams[c]->getLinkState();
+    if (state == pushed.cameraState[c]) {
+      continue;
+    }
+    if (cameras.isNull()) {
+      cameras = root.createNestedArray("cameras");
+    }
+    JsonObject obj = cameras.createNestedObject();
+    obj["camera"] = c;
+    obj["connected"] = state == LINK_CONNECTED;
+    obj["state"] = linkStateNames[state];
+    pushed.cameraState[c] = state;
+  }
+  changed |= !cameras.isNull();
+  
+  if (systemDue) {
+    JsonObject system;
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t freePsram = ESP.getFreePsram();
+    int wifiRSSI = WiFi.RSSI();
+    unsigned long lastInferenceTime = detector ? detector->getLastInferenceTime() : 0;
+    if (freeHeap != pushed.freeHeap || freePsram != pushed.freePsram ||
+        wifiRSSI != pushed.wifiRSSI || lastInferenceTime != pushed.lastInferenceTime) {
+      system = root.createNestedObject("system");
+    }
+    if (freeHeap != pushed.freeHeap) {
+      system["freeHeap"] = pushed.freeHeap = freeHeap;
+    }
+    if (freePsram != pushed.freePsram) {
+      system["freePsram"] = pushed.freePsram = freePsram;
+    }
+    if (wifiRSSI != pushed.wifiRSSI) {
+      system["wifiRSSI"] = pushed.wifiRSSI = wifiRSSI;
+    }
+    if (lastInferenceTime != pushed.lastInferenceTime) {
+      system["lastInferenceTime"] = pushed.lastInferenceTime = lastInferenceTime;
+    }
+    changed |= !system.isNull();
+  }
+  
+  return changed;
+}
+
+/**
+ * Cached state as one message with the version of the last delta
+ */
+void WebServerManager::buildFullState(JsonObject root) {
+  root["type"] = "state";
+  root["v"] = pushed.version;
+  root["full"] = true;
+  
+  JsonArray relayList = root.createNestedArray("relays");
+  for (int i = 0; i < pushed.relayCount; i++) {
+    JsonObject obj = relayList.createNestedObject();
+    obj["pin"] = pushed.relayPin[i];
+    obj["active"] = pushed.relayActive[i];
+  }
+  
+  JsonArray zoneList = root.createNestedArray("zones");
+  JsonObject stats = root.createNestedObject("stats");
+  stats["totalDetections"] = pushed.totalDetections;
+  JsonArray statList = stats.createNestedArray("zones");
+  for (int i = 0; i < pushed.zoneCount; i++) {
+    JsonObject obj = zoneList.createNestedObject();
+    obj["id"] = pushed.zoneId[i];
+    obj["active"] = pushed.zoneActive[i];
+    obj = statList.createNestedObject();
+    obj["id"] = pushed.zoneId[i];
+    obj["detections"] = pushed.zoneDetections[i];
+  }
+  
+  JsonArray cameras = root.createNestedArray("cameras");
+  for (int c = 0; c < streamCount; c++) {
+    if (pushed.cameraState[c] > LINK_BACKOFF) {
+      continue;
+    }
+    JsonObject obj = cameras.createNestedObject();
+    obj["camera"] = c;
+    obj["connected"] = pushed.cameraState[c] == LINK_CONNECTED;
+    obj["state"] = linkStateNames[pushed.cameraState[c]];
+  }
+  
+  JsonObject system = root.createNestedObject("system");
+  system["freeHeap"] = pushed.freeHeap;
+  system["freePsram"] = pushed.freePsram;
+  system["wifiRSSI"] = pushed.wifiRSSI;
+  system["lastInferenceTime"] = pushed.lastInferenceTime;
+}
+
+WsViewer* WebServerManager::findViewer(uint32_t clientId) {
+  for (int i = 0; i < WS_MAX_VIEWERS; i++) {
+    if (viewers[i].clientId == clientId) {
+      return &viewers[i];
+    }
+  }
+  return nullptr;
+}
+
+bool WebServerManager::addViewer(uint32_t clientId) {
+  WsViewer* viewer = findViewer(0);
+  if (!viewer) {
+    return false;
+  }
+  
+  unsigned long now = millis();
+  memset(viewer, 0, sizeof(WsViewer));
+  viewer->clientId = clientId;
+  viewer->frameInterval = WS_MIN_FRAME_INTERVAL;
+  viewer->lastPingAt = now;
+  viewer->lastPongAt = now;
+  viewer->needsState = true;
+  return true;
 }
 
 void WebServerManager::handleGetConfig(AsyncWebServerRequest* request) {
-  String json = serializeConfig();
-  request->send(200, "application/json", json);
+  buildConfig(lockJsonDoc());
+  sendJsonDoc(request);
 }
 
 void WebServerManager::handleSaveConfig(AsyncWebServerRequest* request, uint8_t* data, size_t len) {
@@ -231,12 +611,41 @@ void WebServerManager::handleSaveConfig(AsyncWebServerRequest* request, uint8_t*
     return;
   }
   
-  // Update config
+  // Update config (cctvIP/cctvPort/streamPath address the first camera)
   if (doc.containsKey("cctvIP")) {
-    strlcpy(config->cctvIP, doc["cctvIP"], MAX_IP_LENGTH);
+    strlcpy(config->cameras[0].ip, doc["cctvIP"], MAX_IP_LENGTH);
   }
   if (doc.containsKey("cctvPort")) {
-    config->cctvPort = doc["cctvPort"];
+    config->cameras[0].port = doc["cctvPort"];
+  }
+  if (doc.containsKey("streamPath")) {
+    strlcpy(config->cameras[0].path, doc["streamPath"] | "", 64);
+  }
+  if (doc.containsKey("cameras")) {
+    JsonArray camerasArray = doc["cameras"].as<JsonArray>();
+    int count = 0;
+    for (JsonObject cameraObj : camerasArray) {
+      if (count >= MAX_CAMERAS) {
+        break;
+      }
+      CameraSource& camera = config->cameras[count];
+      if (count++ >= config->numCameras) {
+        // New camera: fields left out get the usual defaults
+        camera.ip[0] = '\0';
+        camera.port = 81;
+        strlcpy(camera.path, "/stream", 64);
+        camera.weight = 1;
+      }
+      if (cameraObj.containsKey("ip")) {
+        strlcpy(camera.ip, cameraObj["ip"] | "", MAX_IP_LENGTH);
+      }
+      if (cameraObj.containsKey("path")) {
+        strlcpy(camera.path, cameraObj["path"] | "", 64);
+      }
+      camera.port = cameraObj["port"] | camera.port;
+      camera.weight = constrain(cameraObj["weight"] | camera.weight, 1, CAMERA_MAX_WEIGHT);
+    }
+    config->numCameras = max(count, 1);
   }
   if (doc.containsKey("detectionThreshold")) {
     config->detectionThreshold = doc["detectionThreshold"];
@@ -244,21 +653,51 @@ void WebServerManager::handleSaveConfig(AsyncWebServerRequest* request, uint8_t*
   if (doc.containsKey("globalTimeout")) {
     config->globalTimeout = doc["globalTimeout"];
   }
+  if (doc.containsKey("confirmFrames")) {
+    config->confirmFrames = doc["confirmFrames"];
+  }
+  if (doc.containsKey("confirmWindow")) {
+    config->confirmWindow = doc["confirmWindow"];
+  }
+  if (doc.containsKey("occupancySmoothing")) {
+    config->occupancySmoothing = doc["occupancySmoothing"];
+  }
+  if (doc.containsKey("pipeline")) {
+    config->pipeline = pipelineFromString(doc["pipeline"] | "cascade");
+  }
+  if (doc.containsKey("roiInference")) {
+    config->roiInference = doc["roiInference"];
+  }
   if (doc.containsKey("autoRelayControl")) {
     config->autoRelayControl = doc["autoRelayControl"];
   }
+  if (doc.containsKey("powerSave")) {
+    config->powerSave = doc["powerSave"];
+  }
   
-  // Save to SPIFFS
+  // Save to SPIFFS (streams and frame slots for added cameras are set up at boot)
   if (saveConfigToSPIFFS(config)) {
-    request->send(200, "application/json", "{\"success\":true}");
+    if (config->numCameras != streamCount) {
+      request->send(200, "application/json", "{\"success\":true,\"restartRequired\":true}");
+    } else {
+      request->send(200, "application/json", "{\"success\":true}");
+    }
   } else {
     request->send(500, "application/json", "{\"error\":\"Failed to save\"}");
   }
 }
 
+void WebServerManager::handleExportConfig(AsyncWebServerRequest* request) {
+  if (exportConfigToJSON(config)) {
+    request->send(200, "application/json", "{\"success\":true}");
+  } else {
+    request->send(500, "application/json", "{\"error\":\"Failed to export configuration\"}");
+  }
+}
+
 void WebServerManager::handleGetZones(AsyncWebServerRequest* request) {
-  String json = serializeZones();
-  request->send(200, "application/json", json);
+  buildZones(lockJsonDoc());
+  sendJsonDoc(request);
 }
 
 void WebServerManager::handleAddZone(AsyncWebServerRequest* request, uint8_t* data, size_t len) {
@@ -308,8 +747,8 @@ void WebServerManager::handleDeleteZone(AsyncWebServerRequest* request) {
 }
 
 void WebServerManager::handleGetRelayStates(AsyncWebServerRequest* request) {
-  String json = serializeRelayStates();
-  request->send(200, "application/json", json);
+  buildRelayStates(lockJsonDoc());
+  sendJsonDoc(request);
 }
 
 void WebServerManager::handleSetRelay(AsyncWebServerRequest* request) {
@@ -336,8 +775,14 @@ void WebServerManager::handleEmergencyStop(AsyncWebServerRequest* request) {
 }
 
 void WebServerManager::handleGetStatistics(AsyncWebServerRequest* request) {
-  String json = serializeStatistics();
-  request->send(200, "application/json", json);
+  buildStatistics(lockJsonDoc());
+  sendJsonDoc(request);
+}
+
+void WebServerManager::handleGetMetrics(AsyncWebServerRequest* request) {
+  AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+  metrics.writePrometheus(*response);
+  request->send(response);
 }
 
 void WebServerManager::handleResetStatistics(AsyncWebServerRequest* request) {
@@ -346,42 +791,72 @@ void WebServerManager::handleResetStatistics(AsyncWebServerRequest* request) {
 }
 
 void WebServerManager::handleGetSystemInfo(AsyncWebServerRequest* request) {
-  String json = serializeSystemInfo();
-  request->send(200, "application/json", json);
+  buildSystemInfo(lockJsonDoc());
+  sendJsonDoc(request);
 }
 
 void WebServerManager::handleTestConnection(AsyncWebServerRequest* request) {
-  // Test connection to CCTV stream
+  // Test connection to CCTV stream without blocking the AsyncTCP task:
+  // the first call starts a test task, later calls poll for its result
+  if (testState == TEST_RUNNING) {
+    request->send(200, "application/json", "{\"success\":false,\"pending\":true,\"message\":\"Testing connection\"}");
+    return;
+  }
   
-  // Yield to prevent watchdog timeout
-  yield();
+  if (testState == TEST_DONE && millis() - testFinishedAt < CONNECTION_TEST_RESULT_TTL) {
+    int httpCode = testCode;
+    testState = TEST_IDLE;
+    
+    if (httpCode == HTTP_CODE_OK) {
+      request->send(200, "application/json", "{\"success\":true,\"message\":\"Connection successful\"}");
+    } else {
+      AsyncResponseStream* response = request->beginResponseStream("application/json", 128);
+      if (httpCode == -1) {
+        response->printf("{\"success\":false,\"message\":\"Connection failed - Camera unreachable\",\"code\":%d}", httpCode);
+      } else {
+        response->printf("{\"success\":false,\"message\":\"Connection failed - HTTP code: %d\",\"code\":%d}", httpCode, httpCode);
+      }
+      request->send(response);
+    }
+    return;
+  }
   
-  String url = "http://";
-  url += config->cctvIP;
-  url += ":";
-  url += String(config->cctvPort);
-  url += config->streamPath;
+  int camera = getCameraParam(request);
+  if (camera < 0 || camera >= config->numCameras) {
+    request->send(400, "application/json", "{\"success\":false,\"message\":\"Unknown camera\"}");
+    return;
+  }
   
-  Serial.printf("Testing connection to: %s\n", url.c_str());
+  const CameraSource& source = config->cameras[camera];
+  snprintf(testURL, sizeof(testURL), "http://%s:%d%s", source.ip, source.port, source.path);
+  testState = TEST_RUNNING;
+  if (xTaskCreate(connectionTestTask, "ConnTest", CONNECTION_TEST_STACK, this, 1, nullptr) != pdPASS) {
+    testState = TEST_IDLE;
+    request->send(200, "application/json", "{\"success\":false,\"message\":\"Cannot start connection test\"}");
+    return;
+  }
+  request->send(200, "application/json", "{\"success\":false,\"pending\":true,\"message\":\"Testing connection\"}");
+}
+
+/**
+ * One-shot task: blocking GET against the stream URL, result left for polling
+ */
+void WebServerManager::connectionTestTask(void* param) {
+  WebServerManager* self = (WebServerManager*)param;
+  Serial.printf("Testing connection to: %s\n", self->testURL);
   
   HTTPClient http;
   WiFiClient client;
   
-  // Use shorter timeout to prevent watchdog
+  // Short timeouts, the UI is waiting for the answer
   http.setTimeout(3000); // 3 seconds max
   http.setConnectTimeout(2000); // 2 seconds to connect
   
-  bool success = false;
   int httpCode = -1;
-  
-  if (http.begin(client, url)) {
-    // Yield during request
-    yield();
-    
+  if (http.begin(client, self->testURL)) {
     httpCode = http.GET();
     
     if (httpCode == HTTP_CODE_OK) {
-      success = true;
       Serial.println("✓ CCTV connection test successful");
     } else {
       Serial.printf("✗ CCTV connection test failed: %d\n", httpCode);
@@ -394,68 +869,119 @@ void WebServerManager::handleTestConnection(AsyncWebServerRequest* request) {
   
   client.stop();
   
-  // Yield after operation
-  yield();
-  
-  if (success) {
-    request->send(200, "application/json", "{\"success\":true,\"message\":\"Connection successful\"}");
-  } else {
-    String json = "{\"success\":false,\"message\":\"Connection failed";
-    if (httpCode == -1) {
-      json += " - Camera unreachable";
-    } else {
-      json += " - HTTP code: " + String(httpCode);
-    }
-    json += "\",\"code\":" + String(httpCode) + "}";
-    request->send(200, "application/json", json);
-  }
+  self->testCode = httpCode;
+  self->testFinishedAt = millis();
+  self->testState = TEST_DONE;
+  vTaskDelete(nullptr);
 }
 
-void WebServerManager::broadcastFrame(uint8_t* jpegData, size_t jpegSize, const std::vector<Detection>& detections) {
-  // Rate limit broadcasts to avoid overwhelming clients
-  if (millis() - lastBroadcast < 100) { // Max 10 FPS
+void WebServerManager::broadcastFrame(const FrameLease& frame, const std::vector<Detection>& detections,
+                                      int camera) {
+  if (camera < 0 || camera >= MAX_CAMERAS) {
     return;
   }
-  lastBroadcast = millis();
   
-  // Send via WebSocket (binary frame)
-  // Format: [type:1byte][jpegSize:4bytes][jpeg][numDetections:2bytes][detections]
-  // This is a simplified version - for production, use proper framing
+  // Hold the newest frame for snapshot requests (previous lease is dropped)
+  portENTER_CRITICAL(&frameMux);
+  latestFrames[camera] = frame;
+  portEXIT_CRITICAL(&frameMux);
+  
+  if (ws->count() == 0) {
+    return;
+  }
   
-  if (ws->count() > 0) {
-    // For now, just send detection count
-    StaticJsonDocument<256> doc;
-    doc["type"] = "detections";
-    doc["count"] = detections.size();
+  // Each viewer gets frames at its own rate: a full queue backs the
+  // interval off by half, a drained queue speeds it up again in small
+  // steps, never faster than one frame per round trip
+  unsigned long now = millis();
+  AsyncWebSocketClient* due[WS_MAX_VIEWERS];
+  int dueCount = 0;
+  
+  xSemaphoreTake(viewerLock, portMAX_DELAY);
+  for (AsyncWebSocketClient* client : ws->getClients()) {
+    WsViewer* viewer = findViewer(client->id());
+    if (!viewer || client->status() != WS_CONNECTED || dueCount >= WS_MAX_VIEWERS ||
+        viewer->camera != camera) {
+      continue;
+    }
     
-    JsonArray dets = doc.createNestedArray("detections");
-    for (const Detection& det : detections) {
-      JsonObject obj = dets.createNestedObject();
-      obj["x"] = det.x;
-      obj["y"] = det.y;
-      obj["width"] = det.width;
-      obj["height"] = det.height;
-      obj["confidence"] = det.confidence;
+    if (now - viewer->lastFrameAt < viewer->frameInterval) {
+      viewer->framesSkipped++;
+      continue;
     }
     
-    String json;
-    serializeJson(doc, json);
-    ws->textAll(json);
+    size_t queued = client->queueLen();
+    if (queued >= WS_CLIENT_QUEUE_LIMIT) {
+      viewer->framesDropped++;
+      framesDropped++;
+      metrics.count(COUNTER_WS_FRAMES_DROPPED);
+      viewer->frameInterval = min(viewer->frameInterval * 3 / 2, WS_MAX_FRAME_INTERVAL);
+      if (!viewer->stalledSince) {
+        viewer->stalledSince = now;
+      }
+      continue;
+    }
+    
+    int floorInterval = max(WS_MIN_FRAME_INTERVAL, viewer->rtt / WS_CLIENT_QUEUE_LIMIT);
+    if (queued == 0 && viewer->frameInterval > floorInterval) {
+      viewer->frameInterval = max(viewer->frameInterval - WS_INTERVAL_STEP, floorInterval);
+    }
+    viewer->stalledSince = 0;
+    viewer->lastFrameAt = now;
+    viewer->framesSent++;
+    due[dueCount++] = client;
   }
-}
-
-void WebServerManager::broadcastRelayStates() {
-  if (ws->count() > 0) {
-    String json = serializeRelayStates();
-    ws->textAll(json);
+  
+  // Nobody is due - skip the copy entirely
+  if (dueCount == 0) {
+    xSemaphoreGive(viewerLock);
+    return;
+  }
+  
+  AsyncWebSocketMessageBuffer* buffer = buildFrameMessage(frame, detections);
+  if (buffer) {
+    // One buffer shared by every due client; each send only takes a reference
+    buffer->lock();
+    for (int i = 0; i < dueCount; i++) {
+      due[i]->binary(buffer);
+    }
+    buffer->unlock();
+    ws->_cleanBuffers();  // Frees the buffer once no client holds it
+    framesSent += dueCount;
   }
+  xSemaphoreGive(viewerLock);
 }
 
-void WebServerManager::broadcastStatistics() {
-  if (ws->count() > 0) {
-    String json = serializeStatistics();
-    ws->textAll(json);
+AsyncWebSocketMessageBuffer* WebServerManager::buildFrameMessage(const FrameLease& frame,
+                                                                 const std::vector<Detection>& detections) {
+  uint32_t jpegSize = frame.size();
+  uint16_t count = min(detections.size(), (size_t)WS_MAX_FRAME_DETECTIONS);
+  size_t length = 1 + sizeof(jpegSize) + jpegSize + sizeof(count) + count * WS_DETECTION_BYTES;
+  
+  AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer(length);
+  if (!buffer || !buffer->get()) {
+    Serial.println("⚠ WebSocket frame buffer allocation failed");
+    return nullptr;
+  }
+  
+  // ESP32 is little-endian, so fields are copied as-is
+  uint8_t* p = buffer->get();
+  *p++ = WS_MSG_FRAME;
+  memcpy(p, &jpegSize, sizeof(jpegSize));
+  p += sizeof(jpegSize);
+  memcpy(p, frame.data(), jpegSize);
+  p += jpegSize;
+  memcpy(p, &count, sizeof(count));
+  p += sizeof(count);
+  
+  for (uint16_t i = 0; i < count; i++) {
+    const Detection& det = detections[i];
+    float values[5] = {det.x, det.y, det.width, det.height, det.confidence};
+    memcpy(p, values, WS_DETECTION_BYTES);
+    p += WS_DETECTION_BYTES;
   }
+  
+  return buffer;
 }
 
 void WebServerManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
@@ -463,36 +989,147 @@ void WebServerManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketCl
   if (type == WS_EVT_CONNECT) {
     Serial.printf("WebSocket client #%u connected\n", client->id());
     
-    // Send initial state
-    client->text(serializeZones());
+    xSemaphoreTake(viewerLock, portMAX_DELAY);
+    bool added = addViewer(client->id());
+    xSemaphoreGive(viewerLock);
+    if (!added) {
+      Serial.printf("⚠ WebSocket client #%u rejected - %d viewers connected\n", client->id(), WS_MAX_VIEWERS);
+      client->close();
+      return;
+    }
+    
+    // Send the zone list; the full state follows from handleClient()
+    buildZones(lockJsonDoc());
+    xSemaphoreTake(viewerLock, portMAX_DELAY);
+    textJsonDoc(&client, 1);
+    xSemaphoreGive(viewerLock);
+    unlockJsonDoc();
     
   } else if (type == WS_EVT_DISCONNECT) {
     Serial.printf("WebSocket client #%u disconnected\n", client->id());
     
+    xSemaphoreTake(viewerLock, portMAX_DELAY);
+    WsViewer* viewer = findViewer(client->id());
+    if (viewer) {
+      viewer->clientId = 0;
+    }
+    xSemaphoreGive(viewerLock);
+    
+  } else if (type == WS_EVT_PONG) {
+    xSemaphoreTake(viewerLock, portMAX_DELAY);
+    WsViewer* viewer = findViewer(client->id());
+    if (viewer) {
+      viewer->lastPongAt = millis();
+      viewer->rtt = min(viewer->lastPongAt - viewer->lastPingAt, (unsigned long)UINT16_MAX);
+    }
+    xSemaphoreGive(viewerLock);
+    
   } else if (type == WS_EVT_DATA) {
-    // Handle incoming WebSocket messages if needed
-    Serial.printf("WebSocket data from client #%u\n", client->id());
+    // Viewers pick the camera they watch with {"camera":N} and ask for
+    // the full state after a missed delta with {"resync":true}
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    StaticJsonDocument<64> doc;
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT ||
+        deserializeJson(doc, data, len) || (!doc.containsKey("camera") && !doc.containsKey("resync"))) {
+      Serial.printf("WebSocket data from client #%u ignored\n", client->id());
+      return;
+    }
+    
+    int camera = doc["camera"] | -1;
+    xSemaphoreTake(viewerLock, portMAX_DELAY);
+    WsViewer* viewer = findViewer(client->id());
+    if (viewer && camera >= 0 && camera < streamCount) {
+      viewer->camera = camera;
+      viewer->lastFrameAt = 0;  // Next frame of the new camera goes out at once
+    }
+    if (viewer && (doc["resync"] | false)) {
+      viewer->needsState = true;
+    }
+    xSemaphoreGive(viewerLock);
+  }
+}
+
+/**
+ * Take the shared JSON document and return its cleared root object.
+ * Lock order: jsonLock before viewerLock.
+ */
+JsonObject WebServerManager::lockJsonDoc() {
+  xSemaphoreTake(jsonLock, portMAX_DELAY);
+  jsonDoc->clear();
+  return jsonDoc->to<JsonObject>();
+}
+
+void WebServerManager::unlockJsonDoc() {
+  xSemaphoreGive(jsonLock);
+}
+
+/**
+ * Serialize the locked document straight into a response buffer sized by
+ * measureJson (no String copies), release the document and send
+ */
+void WebServerManager::sendJsonDoc(AsyncWebServerRequest* request) {
+  if (jsonDoc->overflowed()) {
+    Serial.println("⚠ JSON response truncated - document capacity too small");
   }
+  AsyncResponseStream* response = request->beginResponseStream("application/json", measureJson(*jsonDoc) + 1);
+  serializeJson(*jsonDoc, *response);
+  unlockJsonDoc();
+  request->send(response);
 }
 
-String WebServerManager::serializeConfig() {
-  StaticJsonDocument<1024> doc;
+/**
+ * Send the locked document as one text message to the given clients, or to
+ * every client if clients is nullptr (call with viewerLock held too)
+ */
+void WebServerManager::textJsonDoc(AsyncWebSocketClient** clients, int count) {
+  size_t length = measureJson(*jsonDoc);
+  AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer(length);
+  if (!buffer || !buffer->get()) {
+    Serial.println("⚠ WebSocket message buffer allocation failed");
+    return;
+  }
+  serializeJson(*jsonDoc, (char*)buffer->get(), length + 1);
   
-  doc["cctvIP"] = config->cctvIP;
-  doc["cctvPort"] = config->cctvPort;
-  doc["streamPath"] = config->streamPath;
+  if (!clients) {
+    ws->textAll(buffer);
+    return;
+  }
+  buffer->lock();
+  for (int i = 0; i < count; i++) {
+    clients[i]->text(buffer);
+  }
+  buffer->unlock();
+  ws->_cleanBuffers();
+}
+
+void WebServerManager::buildConfig(JsonObject doc) {
+  doc["cctvIP"] = config->cameras[0].ip;
+  doc["cctvPort"] = config->cameras[0].port;
+  doc["streamPath"] = config->cameras[0].path;
+  JsonArray cameras = doc.createNestedArray("cameras");
+  for (int i = 0; i < config->numCameras; i++) {
+    const CameraSource& camera = config->cameras[i];
+    JsonObject obj = cameras.createNestedObject();
+    obj["ip"] = camera.ip;
+    obj["port"] = camera.port;
+    obj["path"] = camera.path;
+    obj["weight"] = camera.weight;
+  }
+  doc["maxCameras"] = MAX_CAMERAS;
+  doc["runningCameras"] = streamCount;
   doc["detectionThreshold"] = config->detectionThreshold;
   doc["globalTimeout"] = config->globalTimeout;
+  doc["confirmFrames"] = config->confirmFrames;
+  doc["confirmWindow"] = config->confirmWindow;
+  doc["occupancySmoothing"] = config->occupancySmoothing;
+  doc["pipeline"] = pipelineToString(config->pipeline);
+  doc["roiInference"] = config->roiInference;
   doc["relayActiveHigh"] = config->relayActiveHigh;
   doc["autoRelayControl"] = config->autoRelayControl;
-  
-  String json;
-  serializeJson(doc, json);
-  return json;
+  doc["powerSave"] = config->powerSave;
 }
 
-String WebServerManager::serializeZones() {
-  DynamicJsonDocument doc(4096);
+void WebServerManager::buildZones(JsonObject doc) {
   JsonArray array = doc.createNestedArray("zones");
   
   for (const Zone& zone : config->zones) {
@@ -504,54 +1141,28 @@ String WebServerManager::serializeZones() {
     obj["width"] = zone.width;
     obj["height"] = zone.height;
     obj["timeout"] = zone.timeout;
-    obj["active"] = zone.active;
+    obj["camera"] = zone.camera;
+    obj["active"] = zoneManager->isZoneActive(zone.id);
     
     JsonArray pins = obj.createNestedArray("relayPins");
     for (int i = 0; i < zone.numRelays; i++) {
       pins.add(zone.relayPins[i]);
     }
   }
-  
-  String json;
-  serializeJson(doc, json);
-  return json;
 }
 
-String WebServerManager::serializeRelayStates() {
-  StaticJsonDocument<512> doc;
+void WebServerManager::buildRelayStates(JsonObject doc) {
   JsonArray array = doc.createNestedArray("relays");
   
-  // Get all unique relay pins
-  std::vector<int> pins;
-  for (const Zone& zone : config->zones) {
-    for (int i = 0; i < zone.numRelays; i++) {
-      bool found = false;
-      for (int pin : pins) {
-        if (pin == zone.relayPins[i]) {
-          found = true;
-          break;
-        }
-      }
-      if (!found) {
-        pins.push_back(zone.relayPins[i]);
-      }
-    }
-  }
-  
-  for (int pin : pins) {
+  for (int i = 0; i < zoneManager->getRelayCount(); i++) {
+    int pin = zoneManager->getRelayPin(i);
     JsonObject obj = array.createNestedObject();
     obj["pin"] = pin;
     obj["active"] = zoneManager->getRelayState(pin);
   }
-  
-  String json;
-  serializeJson(doc, json);
-  return json;
 }
 
-String WebServerManager::serializeStatistics() {
-  StaticJsonDocument<1024> doc;
-  
+void WebServerManager::buildStatistics(JsonObject doc) {
   doc["totalDetections"] = zoneManager->getTotalDetections();
   
   JsonArray zones = doc.createNestedArray("zones");
@@ -562,14 +1173,29 @@ String WebServerManager::serializeStatistics() {
     obj["detections"] = zoneManager->getZoneDetectionCount(zone.id);
   }
   
-  String json;
-  serializeJson(doc, json);
-  return json;
+  doc["wsFramesSent"] = framesSent;
+  doc["wsFramesDropped"] = framesDropped;
+  doc["wsEvictions"] = viewerEvictions;
+  
+  JsonArray viewerList = doc.createNestedArray("viewers");
+  xSemaphoreTake(viewerLock, portMAX_DELAY);
+  for (const WsViewer& viewer : viewers) {
+    if (viewer.clientId == 0) {
+      continue;
+    }
+    JsonObject obj = viewerList.createNestedObject();
+    obj["id"] = viewer.clientId;
+    obj["targetFps"] = 1000.0 / viewer.frameInterval;
+    obj["rtt"] = viewer.rtt;
+    obj["sent"] = viewer.framesSent;
+    obj["skipped"] = viewer.framesSkipped;
+    obj["dropped"] = viewer.framesDropped;
+    obj["stalled"] = viewer.stalledSince != 0;
+  }
+  xSemaphoreGive(viewerLock);
 }
 
-String WebServerManager::serializeSystemInfo() {
-  StaticJsonDocument<1024> doc;
-  
+void WebServerManager::buildSystemInfo(JsonObject doc) {
   doc["chipModel"] = ESP.getChipModel();
   doc["cpuFreq"] = ESP.getCpuFreqMHz();
   doc["freeHeap"] = ESP.getFreeHeap();
@@ -583,14 +1209,11 @@ String WebServerManager::serializeSystemInfo() {
     detector->getModelInfo(modelInfo, sizeof(modelInfo));
     doc["modelInfo"] = modelInfo;
     doc["lastInferenceTime"] = detector->getLastInferenceTime();
+    doc["arenaUsed"] = detector->getArenaUsed();
   } else {
     doc["modelInfo"] = "Simple Motion Detection";
     doc["lastInferenceTime"] = 0;
   }
-  
-  String json;
-  serializeJson(doc, json);
-  return json;
 }
 
 bool WebServerManager::parseZoneJSON(const char* json, Zone* zone) {
@@ -608,8 +1231,10 @@ bool WebServerManager::parseZoneJSON(const char* json, Zone* zone) {
   zone->width = doc["width"] | 100;
   zone->height = doc["height"] | 100;
   zone->timeout = doc["timeout"] | 5;
-  zone->active = false;
-  zone->lastDetectionTime = 0;
+  zone->camera = doc["camera"] | 0;
+  if (zone->camera < 0 || zone->camera >= config->numCameras) {
+    return false;
+  }
   
   JsonArray pins = doc["relayPins"];
   zone->numRelays = 0;
@@ -622,47 +1247,124 @@ bool WebServerManager::parseZoneJSON(const char* json, Zone* zone) {
   return true;
 }
 
+/**
+ * Camera index from the "camera" parameter (query or form)
+ */
+int WebServerManager::getCameraParam(AsyncWebServerRequest* request) {
+  if (!request->hasParam("camera")) {
+    return 0;
+  }
+  String value = request->getParam("camera")->value();
+  int camera = value.toInt();
+  if (camera < 0 || camera >= MAX_CAMERAS || (camera == 0 && value != "0")) {
+    return -1;
+  }
+  return camera;
+}
+
 void WebServerManager::handleStartCamera(AsyncWebServerRequest* request) {
   // Yield before starting
   yield();
   
-  Serial.println("Starting camera connection from web UI...");
+  int camera = getCameraParam(request);
+  if (camera < 0 || camera >= config->numCameras) {
+    request->send(400, "application/json", "{\"success\":false,\"message\":\"Unknown camera\"}");
+    return;
+  }
+  if (camera >= streamCount) {
+    request->send(200, "application/json", "{\"success\":false,\"message\":\"Restart the switch to enable this camera\"}");
+    return;
+  }
+  
+  Serial.printf("Starting camera %d connection from web UI...\n", camera + 1);
+  MJPEGStream* stream = streams[camera];
   
-  if (mjpegStream->isConnected()) {
+  if (stream->isConnected()) {
     request->send(200, "application/json", "{\"success\":true,\"message\":\"Camera already connected\"}");
     return;
   }
   
-  // Attempt to connect
-  bool success = mjpegStream->begin(config->cctvIP, config->cctvPort, config->streamPath);
-  
-  yield();
+  // The ingest task connects (and keeps reconnecting); poll /api/camera/status
+  const CameraSource& source = config->cameras[camera];
+  bool success = stream->begin(source.ip, source.port, source.path);
   
   if (success) {
-    Serial.println("✓ Camera connected successfully");
-    request->send(200, "application/json", "{\"success\":true,\"message\":\"Camera connected successfully\"}");
+    request->send(200, "application/json", "{\"success\":true,\"pending\":true,\"message\":\"Connecting to camera\"}");
   } else {
-    Serial.println("✗ Failed to connect to camera");
-    request->send(200, "application/json", "{\"success\":false,\"message\":\"Failed to connect to camera\"}");
+    Serial.println("✗ Failed to start camera connection");
+    request->send(200, "application/json", "{\"success\":false,\"message\":\"Invalid camera address\"}");
   }
 }
 
 void WebServerManager::handleStopCamera(AsyncWebServerRequest* request) {
-  Serial.println("Stopping camera connection from web UI...");
+  int camera = getCameraParam(request);
+  if (camera < 0 || camera >= streamCount) {
+    request->send(400, "application/json", "{\"success\":false,\"message\":\"Unknown camera\"}");
+    return;
+  }
   
-  mjpegStream->disconnect();
+  Serial.printf("Stopping camera %d connection from web UI...\n", camera + 1);
+  
+  streams[camera]->requestDisconnect();
   
   request->send(200, "application/json", "{\"success\":true,\"message\":\"Camera disconnected\"}");
 }
 
+void WebServerManager::handleCameraSnapshot(AsyncWebServerRequest* request) {
+  int camera = getCameraParam(request);
+  if (camera < 0) {
+    request->send(400, "application/json", "{\"error\":\"Unknown camera\"}");
+    return;
+  }
+  
+  portENTER_CRITICAL(&frameMux);
+  FrameLease frame = latestFrames[camera];
+  portEXIT_CRITICAL(&frameMux);
+  
+  if (!frame.valid()) {
+    request->send(503, "application/json", "{\"error\":\"No frame available\"}");
+    return;
+  }
+  
+  // Stream straight out of the pooled slot; the lease lives as long as the response
+  AsyncWebServerResponse* response = request->beginResponse("image/jpeg", frame.size(),
+    [frame](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      size_t chunk = min(maxLen, frame.size() - index);
+      memcpy(buffer, frame.data() + index, chunk);
+      return chunk;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
 void WebServerManager::handleCameraStatus(AsyncWebServerRequest* request) {
-  StaticJsonDocument<256> doc;
+  int camera = getCameraParam(request);
+  if (camera < 0 || camera >= config->numCameras) {
+    request->send(400, "application/json", "{\"error\":\"Unknown camera\"}");
+    return;
+  }
   
-  doc["connected"] = mjpegStream->isConnected();
-  doc["frameCount"] = mjpegStream->getFrameCount();
-  doc["avgFPS"] = mjpegStream->getAverageFPS();
+  JsonObject doc = lockJsonDoc();
+  doc["camera"] = camera;
+  doc["cameras"] = config->numCameras;
+  doc["weight"] = config->cameras[camera].weight;
+  if (camera >= streamCount) {
+    // Added since boot, starts after a restart
+    doc["connected"] = false;
+    doc["state"] = "idle";
+    doc["restartRequired"] = true;
+  } else {
+    MJPEGStream* stream = streams[camera];
+    doc["connected"] = stream->isConnected();
+    doc["state"] = linkStateNames[stream->getLinkState()];
+    doc["failures"] = stream->getConnectFailures();
+    doc["retryIn"] = stream->getRetryIn();
+    doc["frameCount"] = stream->getFrameCount();
+    doc["avgFPS"] = stream->getAverageFPS();
+    doc["droppedFrames"] = stream->getDroppedFrames();
+    doc["framing"] = stream->isSnapshotPolling() ? "snapshot" :
+                     (stream->isLengthFraming() ? "content-length" : "boundary");
+  }
   
-  String json;
-  serializeJson(doc, json);
-  request->send(200, "application/json", json);
+  sendJsonDoc(request);
 }
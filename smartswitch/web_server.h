@@ -11,11 +11,110 @@
 #include <Arduino.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncWebSocket.h>
+#include <ArduinoJson.h>
 #include <DNSServer.h>
 #include "config.h"
 #include "zone_manager.h"
 #include "tflite_detector.h"
 #include "mjpeg_stream.h"
+#include "frame_pool.h"
+#include "freertos/semphr.h"
+
+// Binary live-frame message (little-endian):
+// [type:1][jpegSize:4][jpeg][numDetections:2][numDetections x (x, y, width, height, confidence : float32)]
+#define WS_MSG_FRAME 0x01
+#define WS_DETECTION_BYTES (5 * sizeof(float))
+#define WS_MAX_FRAME_DETECTIONS 64  // Detections carried per frame message
+#define WS_CLIENT_QUEUE_LIMIT 2     // Queued messages before frames are dropped for a client
+
+// Per-viewer rate control
+#define WS_MAX_VIEWERS 8            // Matches AsyncWebSocket's default client limit
+#define WS_MIN_FRAME_INTERVAL 100   // Fastest rate for any viewer (ms, 10 fps)
+#define WS_MAX_FRAME_INTERVAL 2000  // Slowest rate before a viewer counts as stalled (ms)
+#define WS_INTERVAL_STEP 10         // Interval decrease after each frame the viewer drained (ms)
+#define WS_PING_INTERVAL 2000       // RTT probe period (ms)
+#define WS_STALL_TIMEOUT 10000      // Full queue or missing pong this long = evict (ms)
+
+// State push: relay, zone, statistics, camera and system changes go out
+// as numbered JSON deltas ({"type":"state","v":N,...}) instead of being polled
+#define WS_STATS_INTERVAL 1000      // Detection counters are pushed at most this often (ms)
+#define WS_SYSTEM_INTERVAL 10000    // Heap / RSSI refresh (ms)
+#define WS_STATE_JSON_SIZE (JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(2) + \
+                            JSON_ARRAY_SIZE(MAX_RELAYS) + MAX_RELAYS * JSON_OBJECT_SIZE(2) + \
+                            2 * (JSON_ARRAY_SIZE(MAX_ZONES) + MAX_ZONES * JSON_OBJECT_SIZE(2)) + \
+                            JSON_ARRAY_SIZE(MAX_CAMERAS) + MAX_CAMERAS * JSON_OBJECT_SIZE(3) + 256)
+                            
+// JSON response documents (ArduinoJson pool bytes). Zone names are stored
+// by pointer; WEB_JSON_STRING_SLACK covers strings the document copies
+// (camera addresses, model info). Config, relay, system and camera status
+// replies are far smaller than these.
+#define ZONES_JSON_SIZE (JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(MAX_ZONES) + \
+                         MAX_ZONES * (JSON_OBJECT_SIZE(10) + JSON_ARRAY_SIZE(MAX_RELAYS_PER_ZONE)))
+#define STATS_JSON_SIZE (JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(MAX_ZONES) + MAX_ZONES * JSON_OBJECT_SIZE(3) + \
+                         JSON_ARRAY_SIZE(WS_MAX_VIEWERS) + WS_MAX_VIEWERS * JSON_OBJECT_SIZE(7))
+#define WEB_JSON_STRING_SLACK 512
+#define WEB_JSON_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define WEB_JSON_DOC_SIZE (WEB_JSON_MAX(WEB_JSON_MAX(ZONES_JSON_SIZE, STATS_JSON_SIZE), WS_STATE_JSON_SIZE) + \
+                           WEB_JSON_STRING_SLACK)
+                           
+// Camera connection test (runs on its own task, the UI polls for the result)
+#define CONNECTION_TEST_STACK 4096
+#define CONNECTION_TEST_RESULT_TTL 10000  // Unread result older than this is discarded (ms)
+
+enum ConnectionTestState {
+  TEST_IDLE,
+  TEST_RUNNING,
+  TEST_DONE
+};
+
+/**
+ * Allocator for the shared response document (PSRAM when present)
+ */
+struct JsonPoolAllocator {
+  void* allocate(size_t size) { return psramFound() ? ps_malloc(size) : malloc(size); }
+  void deallocate(void* ptr) { free(ptr); }
+  void* reallocate(void* ptr, size_t size) { return psramFound() ? ps_realloc(ptr, size) : realloc(ptr, size); }
+};
+typedef BasicJsonDocument<JsonPoolAllocator> PooledJsonDocument;
+
+/**
+ * Rate control state of one WebSocket viewer
+ */
+struct WsViewer {
+  uint32_t clientId;            // 0 = free slot
+  uint16_t frameInterval;       // Current target ms between frames
+  uint16_t rtt;                 // Last ping round trip (ms)
+  uint8_t camera;               // Camera whose frames the viewer gets ({"camera":N} message)
+  unsigned long lastFrameAt;
+  unsigned long lastPingAt;
+  unsigned long lastPongAt;
+  unsigned long stalledSince;   // First consecutive full-queue frame (0 = draining)
+  uint32_t framesSent;
+  uint32_t framesSkipped;       // Held back by the viewer's target rate
+  uint32_t framesDropped;       // Queue still full when a frame was due
+  bool needsState;              // Full state due (new viewer or {"resync":true})
+};
+
+/**
+ * State last pushed to the viewers; deltas carry what differs from it and
+ * a viewer that (re)syncs gets this copy, so it never runs ahead of them
+ */
+struct WsStateCache {
+  uint32_t version;             // "v" of the last delta
+  int relayCount;
+  int relayPin[MAX_RELAYS];
+  bool relayActive[MAX_RELAYS];
+  int zoneCount;                // Leading zones whose entries are valid
+  int zoneId[MAX_ZONES];
+  bool zoneActive[MAX_ZONES];
+  int zoneDetections[MAX_ZONES];
+  int totalDetections;
+  uint8_t cameraState[MAX_CAMERAS];   // StreamLinkState, 0xFF = not pushed yet
+  uint32_t freeHeap;
+  uint32_t freePsram;
+  int wifiRSSI;
+  unsigned long lastInferenceTime;
+};
 
 /**
  * Web Server Manager Class
@@ -25,20 +124,20 @@ public:
   WebServerManager();
   ~WebServerManager();
   
-  // Initialize server with configuration
-  void begin(Config* config, ZoneManager* zoneMgr, TFLiteDetector* detector, MJPEGStream* stream);
-  
-  // Handle client requests (call in loop)
+  // Initialize server with configuration (one stream per running camera)
+  void begin(Config* config, ZoneManager* zoneMgr, TFLiteDetector* detector,
+             MJPEGStream** streams, int streamCount);
+             
+  // Handle client requests, viewer pings and eviction, push state
+  // changes to the viewers (call in loop)
   void handleClient();
   
-  // Broadcast frame to WebSocket clients
-  void broadcastFrame(uint8_t* jpegData, size_t jpegSize, const std::vector<Detection>& detections);
+  // Broadcast a camera's frame to the WebSocket clients watching it
+  // (keeps a lease on the latest frame of each camera)
+  void broadcastFrame(const FrameLease& frame, const std::vector<Detection>& detections, int camera = 0);
   
-  // Broadcast relay states
-  void broadcastRelayStates();
-  
-  // Broadcast statistics
-  void broadcastStatistics();
+  // Connected WebSocket viewers
+  int getViewerCount() { return ws ? ws->count() : 0; }
   
   // Camera control
   void handleStartCamera(AsyncWebServerRequest* request);
@@ -54,11 +153,38 @@ private:
   Config* config;
   ZoneManager* zoneManager;
   TFLiteDetector* detector;
-  MJPEGStream* mjpegStream;
+  MJPEGStream* streams[MAX_CAMERAS];
+  int streamCount;
   
-  unsigned long lastBroadcast;
+  // WebSocket viewers (shared by the processing and AsyncTCP tasks)
+  WsViewer viewers[WS_MAX_VIEWERS];
+  SemaphoreHandle_t viewerLock;
+  uint32_t framesSent;        // Frame messages queued to clients
+  uint32_t framesDropped;     // Frames skipped for clients with a full queue
+  uint32_t viewerEvictions;   // Viewers closed for stalling
   bool apMode;
   
+  // Shared response document (serializers fill it under jsonLock)
+  PooledJsonDocument* jsonDoc;
+  SemaphoreHandle_t jsonLock;
+  
+  // State push (loop task only)
+  WsStateCache pushed;
+  uint32_t pendingChanges;    // ZONE_CHANGED_* taken but not pushed yet
+  unsigned long lastStatsPush;
+  unsigned long lastSystemPush;
+  
+  // Latest frame per camera, shared with the snapshot endpoint (AsyncTCP task)
+  FrameLease latestFrames[MAX_CAMERAS];
+  portMUX_TYPE frameMux;
+  
+  // Camera connection test (written by the test task, read by the AsyncTCP task)
+  volatile ConnectionTestState testState;
+  char testURL[MJPEG_URL_MAX_LENGTH];
+  int testCode;
+  unsigned long testFinishedAt;
+  static void connectionTestTask(void* param);
+  
   // Setup routes
   void setupRoutes();
   void setupWebSocketHandlers();
@@ -66,6 +192,7 @@ private:
   // API endpoint handlers
   void handleGetConfig(AsyncWebServerRequest* request);
   void handleSaveConfig(AsyncWebServerRequest* request, uint8_t* data, size_t len);
+  void handleExportConfig(AsyncWebServerRequest* request);
   void handleGetZones(AsyncWebServerRequest* request);
   void handleAddZone(AsyncWebServerRequest* request, uint8_t* data, size_t len);
   void handleUpdateZone(AsyncWebServerRequest* request, uint8_t* data, size_t len);
@@ -74,6 +201,7 @@ private:
   void handleSetRelay(AsyncWebServerRequest* request);
   void handleEmergencyStop(AsyncWebServerRequest* request);
   void handleGetStatistics(AsyncWebServerRequest* request);
+  void handleGetMetrics(AsyncWebServerRequest* request);
   void handleResetStatistics(AsyncWebServerRequest* request);
   void handleGetSystemInfo(AsyncWebServerRequest* request);
   void handleTestConnection(AsyncWebServerRequest* request);
@@ -81,13 +209,36 @@ private:
   // WebSocket handlers
   void onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                        AwsEventType type, void* arg, uint8_t* data, size_t len);
+                       
+  // Viewer table helpers (call with viewerLock held)
+  WsViewer* findViewer(uint32_t clientId);
+  bool addViewer(uint32_t clientId);
+  
+  // Push changed state as one delta, then the full state to viewers that need it
+  void pushStateChanges();
+  bool buildStateDelta(JsonObject root, uint32_t due, bool systemDue);
+  void buildFullState(JsonObject root);
+  
+  // Build the binary frame message once for all clients (nullptr on failure)
+  AsyncWebSocketMessageBuffer* buildFrameMessage(const FrameLease& frame, const std::vector<Detection>& detections);
+  
+  // Camera selected by the "camera" request parameter (0 if absent, -1 if unknown)
+  int getCameraParam(AsyncWebServerRequest* request);
+  
+  // Shared document: lockJsonDoc() returns the cleared root; sendJsonDoc()
+  // serializes it into the response and unlocks, textJsonDoc() sends it
+  // over the WebSocket (viewerLock held) and unlockJsonDoc() releases it
+  JsonObject lockJsonDoc();
+  void unlockJsonDoc();
+  void sendJsonDoc(AsyncWebServerRequest* request);
+  void textJsonDoc(AsyncWebSocketClient** clients, int count);
   
-  // Helper methods
-  String serializeConfig();
-  String serializeZones();
-  String serializeRelayStates();
-  String serializeStatistics();
-  String serializeSystemInfo();
+  // Helper methods (fill the locked document)
+  void buildConfig(JsonObject doc);
+  void buildZones(JsonObject doc);
+  void buildRelayStates(JsonObject doc);
+  void buildStatistics(JsonObject doc);
+  void buildSystemInfo(JsonObject doc);
   bool parseZoneJSON(const char* json, Zone* zone);
 };
 
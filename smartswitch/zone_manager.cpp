@@ -6,9 +6,24 @@
 
 #include "zone_manager.h"
 
+/**
+ * Holds the zone mutex for the rest of the scope
+ */
+struct ZoneLock {
+  ZoneManager* manager;
+  ZoneLock(ZoneManager* m) { manager = m; manager->lock(); }
+  ~ZoneLock() { manager->unlock(); }
+};
+
 ZoneManager::ZoneManager() {
   config = nullptr;
+  mutex = nullptr;
   totalDetections = 0;
+  changes = 0;
+  indexWidth = ZONE_CANVAS_WIDTH;
+  indexHeight = ZONE_CANVAS_HEIGHT;
+  zones.count = 0;
+  relays.count = 0;
 }
 
 ZoneManager::~ZoneManager() {
@@ -16,287 +31,586 @@ ZoneManager::~ZoneManager() {
 
 void ZoneManager::begin(Config* cfg) {
   config = cfg;
+  mutex = xSemaphoreCreateMutex();
   
-  // Initialize relay states for all configured zones
-  for (Zone& zone : config->zones) {
-    for (int i = 0; i < zone.numRelays; i++) {
-      initializeRelayState(zone.relayPins[i]);
-    }
+  if (config->zones.size() > MAX_ZONES) {
+    Serial.printf("⚠ %d zones configured, only the first %d are used\n", config->zones.size(), MAX_ZONES);
+    config->zones.resize(MAX_ZONES);
   }
   
-  // Initialize zone detection counts
-  zoneDetectionCounts.resize(config->zones.size(), 0);
+  // Rasterize zones and initialize relay states for all configured zones
+  for (size_t i = 0; i < config->zones.size(); i++) {
+    resetZoneSlot(i);
+  }
+  rebuildIndex(indexWidth, indexHeight);
   
-  Serial.printf("Zone manager initialized with %d zones\n", config->zones.size());
+  Serial.printf("Zone manager initialized with %d zones, %d relays\n", zones.count, relays.count);
 }
 
-void ZoneManager::update(const std::vector<Detection>& detections, int frameWidth, int frameHeight) {
+void ZoneManager::update(const std::vector<Detection>& detections, int frameWidth, int frameHeight, int camera) {
+  ZoneLock guard(this);
+  if (frameWidth != indexWidth || frameHeight != indexHeight) {
+    rebuildIndex(frameWidth, frameHeight);
+  }
+  
+  // Rasterize detections once (normalized coordinates)
+  GridRect detectionCells[ZONE_MAX_DETECTIONS];
+  int detectionCount = min((int)detections.size(), ZONE_MAX_DETECTIONS);
+  for (int d = 0; d < detectionCount; d++) {
+    const Detection& det = detections[d];
+    detectionCells[d] = toGrid(det.x, det.y, det.x + det.width, det.y + det.height);
+  }
+  
+  // Temporal filter settings (may change at runtime through the web API)
+  int window = constrain(config->confirmWindow, 1, ZONE_MAX_CONFIRM_WINDOW);
+  int confirmFrames = constrain(config->confirmFrames, 1, window);
+  uint16_t windowMask = (uint16_t)((1u << window) - 1);
+  float smoothing = constrain(config->occupancySmoothing, 0.01f, 1.0f);
+  
   // Update each zone based on detections
-  for (size_t i = 0; i < config->zones.size(); i++) {
-    Zone& zone = config->zones[i];
+  unsigned long now = millis();
+  int hits = 0;
+  for (int i = 0; i < zones.count; i++) {
+    if (!onCamera(i, camera)) {
+      continue;
+    }
+    const GridRect& zoneCells = zones.cells[i];
     bool detected = false;
     
-    // Check if any detection overlaps with this zone
-    for (const Detection& detection : detections) {
-      if (checkOverlap(detection, zone, frameWidth, frameHeight)) {
+    // Check if any detection shares a grid cell with this zone
+    for (int d = 0; d < detectionCount; d++) {
+      if (gridOverlap(detectionCells[d], zoneCells)) {
         detected = true;
-        zoneDetectionCounts[i]++;
+        zones.detectionCount[i]++;
         totalDetections++;
+        hits++;
         break;
       }
     }
     
     // Update zone state and relays
-    updateZoneState(&zone, detected);
+    updateZoneState(i, detected, now, windowMask, confirmFrames, smoothing);
+  }
+  
+  if (hits > 0) {
+    raiseChange(ZONE_CHANGED_STATS);
   }
 }
 
-bool ZoneManager::checkOverlap(const Detection& detection, const Zone& zone, int frameWidth, int frameHeight) {
-  // Convert normalized detection coordinates to pixel coordinates
-  int detX = (int)(detection.x * frameWidth);
-  int detY = (int)(detection.y * frameHeight);
-  int detWidth = (int)(detection.width * frameWidth);
-  int detHeight = (int)(detection.height * frameHeight);
-  
-  // Check rectangle overlap
-  bool overlap = (detX < zone.x + zone.width &&
-                  detX + detWidth > zone.x &&
-                  detY < zone.y + zone.height &&
-                  detY + detHeight > zone.y);
+void ZoneManager::checkTimeouts(int camera) {
+  ZoneLock guard(this);
+  unsigned long now = millis();
+  for (int i = 0; i < zones.count; i++) {
+    if (zones.active[i] && onCamera(i, camera) && now - zones.lastDetectionTime[i] >= zones.timeoutMs[i]) {
+      const Zone& zone = config->zones[i];
+      Serial.printf("⊗ Zone %d (%s) DEACTIVATED (timeout, no frames)\n", zone.id, zone.name);
+      releaseZoneRelays(i);
+      
+      // Presence must be confirmed again by new frames
+      zones.history[i] = 0;
+      zones.occupancy[i] = 0;
+    }
+  }
+}
+
+void ZoneManager::releaseCamera(int camera) {
+  ZoneLock guard(this);
+  for (int i = 0; i < zones.count; i++) {
+    if (!onCamera(i, camera)) {
+      continue;
+    }
+    if (zones.active[i]) {
+      const Zone& zone = config->zones[i];
+      Serial.printf("⊗ Zone %d (%s) DEACTIVATED (camera %d stopped)\n", zone.id, zone.name, camera + 1);
+      releaseZoneRelays(i);
+    }
+    zones.history[i] = 0;
+    zones.occupancy[i] = 0;
+  }
+}
+
+/**
+ * Map a normalized rectangle to the grid cells it covers
+ */
+GridRect ZoneManager::toGrid(float x0, float y0, float x1, float y1) {
+  int colStart = constrain((int)(x0 * ZONE_GRID_COLS), 0, ZONE_GRID_COLS - 1);
+  int rowStart = constrain((int)(y0 * ZONE_GRID_ROWS), 0, ZONE_GRID_ROWS - 1);
+  int colEnd = constrain((int)ceilf(x1 * ZONE_GRID_COLS) - 1, colStart, ZONE_GRID_COLS - 1);
+  int rowEnd = constrain((int)ceilf(y1 * ZONE_GRID_ROWS) - 1, rowStart, ZONE_GRID_ROWS - 1);
   
-  return overlap;
+  int span = colEnd - colStart + 1;
+  GridRect rect;
+  rect.rowStart = rowStart;
+  rect.rowEnd = rowEnd;
+  rect.columns = (span >= 32 ? 0xFFFFFFFFu : ((1u << span) - 1)) << colStart;
+  return rect;
 }
 
-void ZoneManager::updateZoneState(Zone* zone, bool detected) {
-  unsigned long currentTime = millis();
+bool ZoneManager::gridOverlap(const GridRect& a, const GridRect& b) {
+  return (a.columns & b.columns) != 0 && a.rowStart <= b.rowEnd && b.rowStart <= a.rowEnd;
+}
+
+/**
+ * Recompute the per-zone geometry, timeout and relay mask from config->zones
+ * (runtime state in the table is kept). The relay table is rebuilt from the
+ * remaining zones: pins still in use keep their state, pins no zone uses
+ * any more are switched off and dropped.
+ */
+void ZoneManager::rebuildIndex(int canvasWidth, int canvasHeight) {
+  indexWidth = canvasWidth;
+  indexHeight = canvasHeight;
+  zones.count = config->zones.size();
   
-  if (detected) {
-    // Person detected in zone
-    if (!zone->active) {
-      Serial.printf("✓ Zone %d (%s) ACTIVATED\n", zone->id, zone->name);
-      zone->active = true;
-    }
-    zone->lastDetectionTime = currentTime;
+  RelayTable previous = relays;
+  relays.count = 0;
+  
+  float scaleX = 1.0 / max(canvasWidth, 1);
+  float scaleY = 1.0 / max(canvasHeight, 1);
+  
+  for (int i = 0; i < zones.count; i++) {
+    const Zone& zone = config->zones[i];
     
-    // Activate relays for this zone
-    updateRelayForZone(*zone);
+    zones.cells[i] = toGrid(zone.x * scaleX, zone.y * scaleY,
+                            (zone.x + zone.width) * scaleX, (zone.y + zone.height) * scaleY);
+    zones.timeoutMs[i] = (unsigned long)zone.timeout * 1000;
+    zones.camera[i] = constrain(zone.camera, 0, MAX_CAMERAS - 1);
+    zones.relayMask[i] = 0;
+    for (int r = 0; r < zone.numRelays; r++) {
+      int slot = initializeRelayState(zone.relayPins[r], previous);
+      if (slot < 0) {
+        Serial.printf("⚠ Zone %d: relay GPIO %d ignored (max %d relays)\n", zone.id, zone.relayPins[r], MAX_RELAYS);
+        continue;
+      }
+      zones.relayMask[i] |= 1 << slot;
+    }
+  }
+  
+  // Active zones hold a reference on each of their relays
+  for (int i = 0; i < zones.count; i++) {
+    if (!zones.active[i]) {
+      continue;
+    }
+    for (uint16_t m = zones.relayMask[i]; m; m &= m - 1) {
+      relays.activeZones[__builtin_ctz(m)]++;
+    }
+  }
+  
+  bool changed = relays.count != previous.count;
+  for (int i = 0; i < previous.count; i++) {
+    int pin = previous.pin[i];
+    if (findRelay(pin) >= 0) {
+      changed |= relays.pin[i] != pin;
+      continue;
+    }
     
-  } else {
-    // No person detected
-    if (zone->active) {
-      // Check timeout
-      unsigned long elapsed = currentTime - zone->lastDetectionTime;
-      if (elapsed >= (unsigned long)(zone->timeout * 1000)) {
-        // Timeout expired, deactivate zone
-        Serial.printf("⊗ Zone %d (%s) DEACTIVATED (timeout)\n", zone->id, zone->name);
-        zone->active = false;
-        
-        // Deactivate relays for this zone
-        for (int i = 0; i < zone->numRelays; i++) {
-          // Check if this relay is used by any other active zone
-          bool usedByOtherZone = false;
-          for (const Zone& otherZone : config->zones) {
-            if (otherZone.id != zone->id && otherZone.active) {
-              for (int j = 0; j < otherZone.numRelays; j++) {
-                if (otherZone.relayPins[j] == zone->relayPins[i]) {
-                  usedByOtherZone = true;
-                  break;
-                }
-              }
-            }
-            if (usedByOtherZone) break;
-          }
-          
-          if (!usedByOtherZone) {
-            deactivateRelay(zone->relayPins[i]);
-          }
-        }
+    // Still an output, held at the off level
+    setRelayPinState(pin, false);
+    Serial.printf("  → Relay GPIO %d released (no zone uses it)\n", pin);
+    changed = true;
+  }
+  if (changed) {
+    raiseChange(ZONE_CHANGED_RELAYS);
+  }
+}
+
+void ZoneManager::resetZoneSlot(int zoneIdx) {
+  zones.active[zoneIdx] = false;
+  zones.lastDetectionTime[zoneIdx] = 0;
+  zones.history[zoneIdx] = 0;
+  zones.occupancy[zoneIdx] = 0;
+  zones.detectionCount[zoneIdx] = 0;
+}
+
+/**
+ * Close the gap left by a removed zone so the table stays parallel to config->zones
+ */
+void ZoneManager::removeZoneSlot(int zoneIdx) {
+  int tail = zones.count - zoneIdx - 1;
+  memmove(&zones.active[zoneIdx], &zones.active[zoneIdx + 1], tail * sizeof(zones.active[0]));
+  memmove(&zones.lastDetectionTime[zoneIdx], &zones.lastDetectionTime[zoneIdx + 1], tail * sizeof(zones.lastDetectionTime[0]));
+  memmove(&zones.history[zoneIdx], &zones.history[zoneIdx + 1], tail * sizeof(zones.history[0]));
+  memmove(&zones.occupancy[zoneIdx], &zones.occupancy[zoneIdx + 1], tail * sizeof(zones.occupancy[0]));
+  memmove(&zones.detectionCount[zoneIdx], &zones.detectionCount[zoneIdx + 1], tail * sizeof(zones.detectionCount[0]));
+  zones.count--;
+}
+
+/**
+ * Filter hits over recent frames; relays only switch on confirmed transitions
+ */
+void ZoneManager::updateZoneState(int zoneIdx, bool detected, unsigned long now,
+                                  uint16_t windowMask, int confirmFrames, float smoothing) {
+  uint16_t history = ((zones.history[zoneIdx] << 1) | (detected ? 1 : 0)) & windowMask;
+  zones.history[zoneIdx] = history;
+  zones.occupancy[zoneIdx] += smoothing * ((detected ? 1.0f : 0.0f) - zones.occupancy[zoneIdx]);
+  
+  if (!zones.active[zoneIdx]) {
+    // Activate once enough recent frames confirm presence
+    if (__builtin_popcount(history) >= confirmFrames) {
+      const Zone& zone = config->zones[zoneIdx];
+      Serial.printf("✓ Zone %d (%s) ACTIVATED\n", zone.id, zone.name);
+      zones.active[zoneIdx] = true;
+      zones.lastDetectionTime[zoneIdx] = now;
+      raiseChange(ZONE_CHANGED_ACTIVE);
+      
+      // Take a reference on each relay while the zone is active
+      for (uint16_t m = zones.relayMask[zoneIdx]; m; m &= m - 1) {
+        int slot = __builtin_ctz(m);
+        relays.activeZones[slot]++;
+        setRelay(slot, true);
       }
     }
+    return;
+  }
+  
+  // Occupied: hold the zone; otherwise let the timeout run
+  if (zones.occupancy[zoneIdx] >= ZONE_OCCUPANCY_HOLD) {
+    zones.lastDetectionTime[zoneIdx] = now;
+    return;
+  }
+  
+  unsigned long elapsed = now - zones.lastDetectionTime[zoneIdx];
+  if (elapsed >= zones.timeoutMs[zoneIdx]) {
+    // Timeout expired, deactivate zone
+    const Zone& zone = config->zones[zoneIdx];
+    Serial.printf("⊗ Zone %d (%s) DEACTIVATED (timeout)\n", zone.id, zone.name);
+    releaseZoneRelays(zoneIdx);
   }
 }
 
-void ZoneManager::updateRelayForZone(const Zone& zone) {
-  for (int i = 0; i < zone.numRelays; i++) {
-    activateRelay(zone.relayPins[i]);
+/**
+ * Deactivate a zone: drop its relay references and switch off
+ * relays no other active zone still holds
+ */
+void ZoneManager::releaseZoneRelays(int zoneIdx) {
+  if (!zones.active[zoneIdx]) {
+    return;
+  }
+  zones.active[zoneIdx] = false;
+  raiseChange(ZONE_CHANGED_ACTIVE);
+  
+  for (uint16_t m = zones.relayMask[zoneIdx]; m; m &= m - 1) {
+    int slot = __builtin_ctz(m);
+    if (relays.activeZones[slot] > 0 && --relays.activeZones[slot] == 0) {
+      setRelay(slot, false);
+    }
   }
 }
 
 void ZoneManager::activateRelay(int pin) {
-  RelayState* state = getRelayStatePtr(pin);
-  if (state) {
-    if (!state->active) {
-      setRelayPinState(pin, true);
-      state->active = true;
-      state->lastActivationTime = millis();
-      state->activationCount++;
-      Serial.printf("  → Relay GPIO %d ON\n", pin);
-    }
+  ZoneLock guard(this);
+  int slot = findRelay(pin);
+  if (slot >= 0) {
+    setRelay(slot, true);
   }
 }
 
 void ZoneManager::deactivateRelay(int pin) {
-  RelayState* state = getRelayStatePtr(pin);
-  if (state) {
-    if (state->active) {
-      setRelayPinState(pin, false);
-      state->active = false;
-      Serial.printf("  → Relay GPIO %d OFF\n", pin);
-    }
+  ZoneLock guard(this);
+  int slot = findRelay(pin);
+  if (slot >= 0) {
+    setRelay(slot, false);
   }
 }
 
 void ZoneManager::toggleRelay(int pin) {
-  RelayState* state = getRelayStatePtr(pin);
-  if (state) {
-    if (state->active) {
-      deactivateRelay(pin);
-    } else {
-      activateRelay(pin);
-    }
+  ZoneLock guard(this);
+  int slot = findRelay(pin);
+  if (slot >= 0) {
+    setRelay(slot, !relays.active[slot]);
   }
 }
 
+void ZoneManager::setRelay(int slot, bool active) {
+  if (relays.active[slot] == active) {
+    return;
+  }
+  
+  int pin = relays.pin[slot];
+  setRelayPinState(pin, active);
+  relays.active[slot] = active;
+  if (active) {
+    relays.lastActivationTime[slot] = millis();
+    relays.activationCount[slot]++;
+  }
+  raiseChange(ZONE_CHANGED_RELAYS);
+  Serial.printf("  → Relay GPIO %d %s\n", pin, active ? "ON" : "OFF");
+}
+
 void ZoneManager::disableAllRelays() {
+  ZoneLock guard(this);
   Serial.println("⚠ EMERGENCY STOP - Disabling all relays!");
   
-  for (RelayState& state : relayStates) {
-    setRelayPinState(state.pin, false);
-    state.active = false;
+  for (int i = 0; i < relays.count; i++) {
+    setRelayPinState(relays.pin[i], false);
+    relays.active[i] = false;
+    relays.activeZones[i] = 0;
   }
   
-  // Deactivate all zones
-  for (Zone& zone : config->zones) {
-    zone.active = false;
+  // Deactivate all zones; presence must be confirmed again
+  for (int i = 0; i < zones.count; i++) {
+    zones.active[i] = false;
+    zones.history[i] = 0;
+    zones.occupancy[i] = 0;
   }
+  raiseChange(ZONE_CHANGED_RELAYS | ZONE_CHANGED_ACTIVE);
 }
 
 bool ZoneManager::addZone(const Zone& zone) {
+  ZoneLock guard(this);
   if (config->zones.size() >= MAX_ZONES) {
     Serial.println("ERROR: Maximum zones reached");
     return false;
   }
+  if (!relaysFit(zone, -1)) {
+    Serial.println("ERROR: Maximum relays reached");
+    return false;
+  }
   
   config->zones.push_back(zone);
-  zoneDetectionCounts.push_back(0);
+  resetZoneSlot(config->zones.size() - 1);
   
-  // Initialize relay states for new zone
-  for (int i = 0; i < zone.numRelays; i++) {
-    initializeRelayState(zone.relayPins[i]);
-  }
+  // Initializes relay states for the new zone too
+  rebuildIndex(indexWidth, indexHeight);
+  raiseChange(ZONE_CHANGED_LIST);
   
   Serial.printf("✓ Zone %d added\n", zone.id);
   return true;
 }
 
 bool ZoneManager::removeZone(int zoneId) {
-  for (size_t i = 0; i < config->zones.size(); i++) {
-    if (config->zones[i].id == zoneId) {
-      // Deactivate zone first
-      Zone& zone = config->zones[i];
-      if (zone.active) {
-        zone.active = false;
-        for (int j = 0; j < zone.numRelays; j++) {
-          deactivateRelay(zone.relayPins[j]);
-        }
-      }
-      
-      config->zones.erase(config->zones.begin() + i);
-      zoneDetectionCounts.erase(zoneDetectionCounts.begin() + i);
-      Serial.printf("✓ Zone %d removed\n", zoneId);
-      return true;
-    }
+  ZoneLock guard(this);
+  int i = findZone(zoneId);
+  if (i < 0) {
+    Serial.printf("ERROR: Zone %d not found\n", zoneId);
+    return false;
   }
   
-  Serial.printf("ERROR: Zone %d not found\n", zoneId);
-  return false;
+  // Deactivate zone first (shared relays stay on for other zones)
+  releaseZoneRelays(i);
+  
+  config->zones.erase(config->zones.begin() + i);
+  removeZoneSlot(i);
+  rebuildIndex(indexWidth, indexHeight);
+  raiseChange(ZONE_CHANGED_LIST);
+  Serial.printf("✓ Zone %d removed\n", zoneId);
+  return true;
 }
 
 bool ZoneManager::updateZone(int zoneId, const Zone& zone) {
-  for (size_t i = 0; i < config->zones.size(); i++) {
-    if (config->zones[i].id == zoneId) {
-      config->zones[i] = zone;
-      Serial.printf("✓ Zone %d updated\n", zoneId);
-      return true;
-    }
+  ZoneLock guard(this);
+  int i = findZone(zoneId);
+  if (i < 0) {
+    Serial.printf("ERROR: Zone %d not found\n", zoneId);
+    return false;
+  }
+  if (!relaysFit(zone, i)) {
+    Serial.println("ERROR: Maximum relays reached");
+    return false;
   }
   
-  Serial.printf("ERROR: Zone %d not found\n", zoneId);
-  return false;
+  // Release relays held under the old definition; the zone
+  // re-activates on the next frame if still occupied
+  releaseZoneRelays(i);
+  config->zones[i] = zone;
+  zones.lastDetectionTime[i] = 0;
+  zones.history[i] = 0;
+  zones.occupancy[i] = 0;
+  rebuildIndex(indexWidth, indexHeight);
+  raiseChange(ZONE_CHANGED_LIST);
+  Serial.printf("✓ Zone %d updated\n", zoneId);
+  return true;
 }
 
 Zone* ZoneManager::getZone(int zoneId) {
-  for (Zone& zone : config->zones) {
-    if (zone.id == zoneId) {
-      return &zone;
-    }
-  }
-  return nullptr;
+  int i = findZone(zoneId);
+  return i >= 0 ? &config->zones[i] : nullptr;
 }
 
 std::vector<Zone>* ZoneManager::getZones() {
   return &(config->zones);
 }
 
+bool ZoneManager::isZoneActive(int zoneId) {
+  int i = findZone(zoneId);
+  return i >= 0 ? zones.active[i] : false;
+}
+
+int ZoneManager::getActiveZoneCount(int camera) {
+  int count = 0;
+  for (int i = 0; i < zones.count; i++) {
+    count += zones.active[i] && onCamera(i, camera) ? 1 : 0;
+  }
+  return count;
+}
+
+int ZoneManager::getZoneCount(int camera) {
+  int count = 0;
+  for (int i = 0; i < zones.count; i++) {
+    count += onCamera(i, camera) ? 1 : 0;
+  }
+  return count;
+}
+
+bool ZoneManager::getCandidateRegion(const std::vector<Detection>& hints, bool allZones, ZoneRegion* region,
+                                     int camera) {
+  ZoneLock guard(this);
+  GridRect hintCells[ZONE_MAX_DETECTIONS];
+  int hintCount = min((int)hints.size(), ZONE_MAX_DETECTIONS);
+  for (int d = 0; d < hintCount; d++) {
+    const Detection& det = hints[d];
+    hintCells[d] = toGrid(det.x, det.y, det.x + det.width, det.y + det.height);
+  }
+  
+  float x0 = indexWidth;
+  float y0 = indexHeight;
+  float x1 = 0;
+  float y1 = 0;
+  for (int i = 0; i < zones.count; i++) {
+    if (!onCamera(i, camera)) {
+      continue;
+    }
+    bool candidate = allZones || zones.active[i];
+    for (int d = 0; d < hintCount && !candidate; d++) {
+      candidate = gridOverlap(hintCells[d], zones.cells[i]);
+    }
+    if (!candidate) {
+      continue;
+    }
+    
+    const Zone& zone = config->zones[i];
+    x0 = min(x0, (float)zone.x);
+    y0 = min(y0, (float)zone.y);
+    x1 = max(x1, (float)(zone.x + zone.width));
+    y1 = max(y1, (float)(zone.y + zone.height));
+  }
+  
+  // Zone coordinates -> normalized frame coordinates
+  x0 = constrain(x0 / indexWidth, 0.0f, 1.0f);
+  y0 = constrain(y0 / indexHeight, 0.0f, 1.0f);
+  x1 = constrain(x1 / indexWidth, 0.0f, 1.0f);
+  y1 = constrain(y1 / indexHeight, 0.0f, 1.0f);
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+  
+  region->x = x0;
+  region->y = y0;
+  region->width = x1 - x0;
+  region->height = y1 - y0;
+  return true;
+}
+
 bool ZoneManager::getRelayState(int pin) {
-  RelayState* state = getRelayStatePtr(pin);
-  return state ? state->active : false;
+  int slot = findRelay(pin);
+  return slot >= 0 ? relays.active[slot] : false;
 }
 
 void ZoneManager::getActiveRelays(bool* states, int count) {
-  for (int i = 0; i < count && i < (int)relayStates.size(); i++) {
-    states[i] = relayStates[i].active;
+  for (int i = 0; i < count && i < relays.count; i++) {
+    states[i] = relays.active[i];
   }
 }
 
 int ZoneManager::getZoneDetectionCount(int zoneId) {
-  for (size_t i = 0; i < config->zones.size(); i++) {
-    if (config->zones[i].id == zoneId) {
-      return zoneDetectionCounts[i];
-    }
-  }
-  return 0;
+  int i = findZone(zoneId);
+  return i >= 0 ? zones.detectionCount[i] : 0;
 }
 
 void ZoneManager::resetStatistics() {
+  ZoneLock guard(this);
   totalDetections = 0;
-  for (size_t i = 0; i < zoneDetectionCounts.size(); i++) {
-    zoneDetectionCounts[i] = 0;
+  for (int i = 0; i < zones.count; i++) {
+    zones.detectionCount[i] = 0;
   }
-  for (RelayState& state : relayStates) {
-    state.activationCount = 0;
+  for (int i = 0; i < relays.count; i++) {
+    relays.activationCount[i] = 0;
   }
+  raiseChange(ZONE_CHANGED_STATS);
   Serial.println("Statistics reset");
 }
 
-void ZoneManager::initializeRelayState(int pin) {
-  // Check if already initialized
-  for (const RelayState& state : relayStates) {
-    if (state.pin == pin) {
-      return; // Already initialized
+/**
+ * Check that the distinct pins of every zone, with zone in place of the
+ * one at replacedIdx (-1 to add it), fit in the relay table
+ */
+bool ZoneManager::relaysFit(const Zone& zone, int replacedIdx) {
+  int pins[MAX_RELAYS];
+  int count = 0;
+  for (int i = 0; i <= zones.count; i++) {
+    if (i == replacedIdx) {
+      continue;
+    }
+    const Zone& z = i < zones.count ? config->zones[i] : zone;
+    for (int r = 0; r < z.numRelays; r++) {
+      bool seen = false;
+      for (int j = 0; j < count && !seen; j++) {
+        seen = pins[j] == z.relayPins[r];
+      }
+      if (seen) {
+        continue;
+      }
+      if (count >= MAX_RELAYS) {
+        return false;
+      }
+      pins[count++] = z.relayPins[r];
     }
   }
+  return true;
+}
+
+/**
+ * Assign a relay slot for a pin if new, carrying over its state from the
+ * previous table; returns the slot (-1 if the table is full)
+ */
+int ZoneManager::initializeRelayState(int pin, const RelayTable& previous) {
+  // Check if already initialized
+  int slot = findRelay(pin);
+  if (slot >= 0) {
+    return slot;
+  }
+  if (relays.count >= MAX_RELAYS) {
+    return -1;
+  }
   
-  RelayState state;
-  state.pin = pin;
-  state.active = false;
-  state.lastActivationTime = 0;
-  state.activationCount = 0;
+  slot = relays.count++;
+  relays.pin[slot] = pin;
+  relays.activeZones[slot] = 0;   // Recounted by rebuildIndex
   
-  relayStates.push_back(state);
+  for (int i = 0; i < previous.count; i++) {
+    if (previous.pin[i] == pin) {
+      relays.active[slot] = previous.active[i];
+      relays.lastActivationTime[slot] = previous.lastActivationTime[i];
+      relays.activationCount[slot] = previous.activationCount[i];
+      return slot;
+    }
+  }
+  relays.active[slot] = false;
+  relays.lastActivationTime[slot] = 0;
+  relays.activationCount[slot] = 0;
   
   // Initialize GPIO
   pinMode(pin, OUTPUT);
   digitalWrite(pin, config->relayActiveHigh ? LOW : HIGH);
+  
+  return slot;
 }
 
-ZoneManager::RelayState* ZoneManager::getRelayStatePtr(int pin) {
-  for (RelayState& state : relayStates) {
-    if (state.pin == pin) {
-      return &state;
+int ZoneManager::findRelay(int pin) {
+  for (int i = 0; i < relays.count; i++) {
+    if (relays.pin[i] == pin) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int ZoneManager::findZone(int zoneId) {
+  for (int i = 0; i < zones.count; i++) {
+    if (config->zones[i].id == zoneId) {
+      return i;
     }
   }
-  return nullptr;
+  return -1;
 }
 
 void ZoneManager::setRelayPinState(int pin, bool active) {
@@ -10,11 +10,59 @@
 
 #include <Arduino.h>
 #include <vector>
+#include "freertos/semphr.h"
 #include "config.h"
 #include "tflite_detector.h"
 
+// Coarse detection grid for overlap tests (one bit per column per row;
+// 20x20 px cells on the 640x480 zone canvas)
+#define ZONE_GRID_COLS 32
+#define ZONE_GRID_ROWS 24
+#define ZONE_MAX_DETECTIONS 32   // Detections tested per update (rest ignored)
+
+// Temporal filter: a zone activates once confirmFrames of the last
+// confirmWindow frames hit it, and its timeout only starts counting once
+// the smoothed occupancy score falls below ZONE_OCCUPANCY_HOLD
+#define ZONE_MAX_CONFIRM_WINDOW 16
+#define ZONE_OCCUPANCY_HOLD 0.25
+
+// Camera argument that selects the zones of every camera
+#define ZONE_ALL_CAMERAS -1
+
+// Change events raised for push updates (see takeChanges)
+#define ZONE_CHANGED_RELAYS 0x01   // A relay switched
+#define ZONE_CHANGED_ACTIVE 0x02   // A zone activated or deactivated
+#define ZONE_CHANGED_LIST 0x04     // Zones added, edited or removed
+#define ZONE_CHANGED_STATS 0x08    // Detection counters moved
+
+static_assert(MAX_RELAYS <= 16, "Zone relay masks are 16 bits");
+static_assert(MAX_ZONES <= 255, "Relay zone refcounts are 8 bits");
+
+/**
+ * Rectangle rasterized onto the detection grid
+ */
+struct GridRect {
+  uint8_t rowStart;
+  uint8_t rowEnd;       // Inclusive
+  uint32_t columns;     // Bit per covered column
+};
+
+/**
+ * Normalized (0-1) frame rectangle
+ */
+struct ZoneRegion {
+  float x;
+  float y;
+  float width;
+  float height;
+};
+
 /**
  * Zone Manager Class
+ * 
+ * Zone edits and manual relay control arrive on the web server task while
+ * frames are processed on another; both sides hold one mutex, so an edit
+ * lands between two frames.
  */
 class ZoneManager {
 public:
@@ -24,8 +72,18 @@ public:
   // Initialize with configuration
   void begin(Config* config);
   
-  // Update relay states based on detections
-  void update(const std::vector<Detection>& detections, int frameWidth, int frameHeight);
+  // Update relay states based on detections in a frame from one camera
+  // (only that camera's zones are tested)
+  void update(const std::vector<Detection>& detections, int frameWidth, int frameHeight,
+              int camera = ZONE_ALL_CAMERAS);
+              
+  // Run zone timeouts without a frame (camera link down); the timeout
+  // counts from the last frame that saw the zone occupied
+  void checkTimeouts(int camera = ZONE_ALL_CAMERAS);
+  
+  // Deactivate every zone of a camera that stopped delivering frames;
+  // relays still held by zones of other cameras stay on
+  void releaseCamera(int camera);
   
   // Manual relay control
   void activateRelay(int pin);
@@ -42,37 +100,95 @@ public:
   Zone* getZone(int zoneId);
   std::vector<Zone>* getZones();
   
+  // Runtime zone state
+  bool isZoneActive(int zoneId);
+  int getActiveZoneCount(int camera = ZONE_ALL_CAMERAS);
+  int getZoneCount(int camera = ZONE_ALL_CAMERAS);
+  
+  // Runtime state by table index (parallel to config->zones)
+  bool isZoneActiveAt(int zoneIdx) { return zones.active[zoneIdx]; }
+  int getZoneDetectionCountAt(int zoneIdx) { return zones.detectionCount[zoneIdx]; }
+  
+  // Bounding box of the camera's zones worth running a detector on: active
+  // zones, zones touched by a hint detection, or every zone if allZones;
+  // false if there is none
+  bool getCandidateRegion(const std::vector<Detection>& hints, bool allZones, ZoneRegion* region,
+                          int camera = ZONE_ALL_CAMERAS);
+                          
   // Get relay states
   bool getRelayState(int pin);
   void getActiveRelays(bool* states, int count);
+  int getRelayCount() { return relays.count; }
+  int getRelayPin(int slot) { return relays.pin[slot]; }
   
   // Statistics
   int getTotalDetections() { return totalDetections; }
   int getZoneDetectionCount(int zoneId);
   void resetStatistics();
   
+  // Hold zone state steady while reading config->zones together with the
+  // runtime getters from a task other than the web server's
+  void lock() { xSemaphoreTake(mutex, portMAX_DELAY); }
+  void unlock() { xSemaphoreGive(mutex); }
+  
+  // ZONE_CHANGED_* flags raised since the last call (safe from another task)
+  uint32_t takeChanges() { return __atomic_exchange_n(&changes, 0, __ATOMIC_ACQ_REL); }
+  
 private:
   Config* config;
+  SemaphoreHandle_t mutex;   // Guards the zone and relay tables and config->zones
   
-  // Relay state tracking
-  struct RelayState {
-    int pin;
-    bool active;
-    unsigned long lastActivationTime;
-    int activationCount;
+  // Hot per-frame zone state as parallel arrays indexed like config->zones
+  // (names and other settings stay in the Zone records)
+  struct ZoneTable {
+    GridRect cells[MAX_ZONES];                // Grid cells the zone touches
+    uint16_t relayMask[MAX_ZONES];            // Bit per relay slot
+    uint8_t camera[MAX_ZONES];                // Camera the zone is drawn on
+    unsigned long timeoutMs[MAX_ZONES];
+    unsigned long lastDetectionTime[MAX_ZONES];   // Last frame occupancy was held
+    uint16_t history[MAX_ZONES];              // Hit bit per recent frame (bit 0 = newest)
+    float occupancy[MAX_ZONES];               // Exponentially smoothed hit rate
+    bool active[MAX_ZONES];
+    int detectionCount[MAX_ZONES];
+    int count;
   };
-  std::vector<RelayState> relayStates;
+  ZoneTable zones;
+  int indexWidth;       // Canvas size the cells were computed for
+  int indexHeight;
+  
+  // Relay state; one slot per distinct pin of the current zones
+  struct RelayTable {
+    int pin[MAX_RELAYS];
+    bool active[MAX_RELAYS];
+    uint8_t activeZones[MAX_RELAYS];          // Active zones holding the relay on
+    unsigned long lastActivationTime[MAX_RELAYS];
+    int activationCount[MAX_RELAYS];
+    int count;
+  };
+  RelayTable relays;
   
   // Statistics
   int totalDetections;
-  std::vector<int> zoneDetectionCounts;
+  
+  // Pending change events
+  uint32_t changes;
+  void raiseChange(uint32_t flags) { __atomic_fetch_or(&changes, flags, __ATOMIC_RELEASE); }
   
   // Private methods
-  bool checkOverlap(const Detection& detection, const Zone& zone, int frameWidth, int frameHeight);
-  void updateZoneState(Zone* zone, bool detected);
-  void updateRelayForZone(const Zone& zone);
-  void initializeRelayState(int pin);
-  RelayState* getRelayStatePtr(int pin);
+  static GridRect toGrid(float x0, float y0, float x1, float y1);
+  static bool gridOverlap(const GridRect& a, const GridRect& b);
+  void rebuildIndex(int canvasWidth, int canvasHeight);
+  void resetZoneSlot(int zoneIdx);
+  void removeZoneSlot(int zoneIdx);
+  void updateZoneState(int zoneIdx, bool detected, unsigned long now,
+                       uint16_t windowMask, int confirmFrames, float smoothing);
+  void releaseZoneRelays(int zoneIdx);
+  bool relaysFit(const Zone& zone, int replacedIdx);
+  int initializeRelayState(int pin, const RelayTable& previous);
+  int findRelay(int pin);
+  int findZone(int zoneId);
+  bool onCamera(int zoneIdx, int camera) { return camera == ZONE_ALL_CAMERAS || zones.camera[zoneIdx] == camera; }
+  void setRelay(int slot, bool active);
   void setRelayPinState(int pin, bool active);
 };
 